@@ -0,0 +1,778 @@
+/*
+NOTES
+    log_error() (2_2 / 2_4 / 2_6 / 7_9) and printer() (9_2 / 9_3) format into a stack buffer and write() it on the
+    calling thread: every log line is a vsnprintf() plus a syscall (~1-2 us) in the middle of the work.
+
+    Here the calling thread only stores the raw record, and a background thread does the rest:
+
+    - Producer (any thread, LOG() macro): the format pointer, a timestamp and up to LOG_ARGS_MAX arguments with their
+      types go into one 64 byte slot of the thread's own ring. No formatting, no lock, no syscall.
+    - One ring per thread, created on the thread's first LOG(). A ring has exactly one producer (its thread) and one
+      consumer (the flusher), so head / tail only need acquire / release ordering, no compare-and-swap.
+      head and tail sit on separate cache lines, the producer keeps a copy of head and only re-reads the shared one
+      when its copy says the ring is full.
+    - Flusher thread: every LOG_FLUSH_INTERVAL_US it takes what's in all the rings, merges them by timestamp,
+      formats the lines into LOG_CHUNKS chunks and writes them with one writev().
+
+    The format is applied later, on another thread, so:
+    - %s arguments are stored as pointers: string literals, strerror() results, anything that lives long enough.
+      (Copying them would make the slot variable size.)
+    - The argument types are taken at the call site with _Generic, the flusher formats every conversion with the type
+      it stored (an int given to %lu still prints right, also on 32 bit ARM where the varargs slots differ).
+    - Full ring: LOG_FULL_DROP counts the record as dropped and returns (the hot path never waits),
+      LOG_FULL_WAIT yields until the flusher made room (nothing lost, used by the benchmark).
+
+    Rings are never freed while the logger runs (a thread that exits may still have records in its ring),
+    log_shutdown() drains and frees all of them. Every logger has a generation number, a thread keeps the one of its
+    ring and registers again when a new logger runs, instead of writing into a freed ring.
+    At most LOG_THREADS_MAX threads get a ring, LOG() from any thread after that is ignored.
+
+    Scope: this is a standalone example like the others, log_error() / printer() of the earlier examples stay as they
+    are (each of those is a single main.c whose point is the plain write() path). log_error() below shows the same
+    call going through the rings.
+
+    Benchmark: N threads log M lines each, once with the log_error() way (vsnprintf + write per line) and once
+    through the rings. ns_per_call is the time the producing thread spends per line.
+
+    Usage: ./main <output_file> [threads] [lines_per_thread]
+*/
+
+/* ----- Libraries ---- */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>    // sched_yield()
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>  // writev()
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* ----- Settings through defines ---- */
+
+#define LOG_ARGS_MAX 5
+#define LOG_RING_SLOTS 4096 // power of 2, 256K per thread
+#define LOG_THREADS_MAX 64
+#define LOG_CHUNK_SIZE (16 * 1024)
+#define LOG_CHUNKS 16 // IOV of one writev()
+#define LOG_LINE_MAX 512
+#define LOG_FLUSH_INTERVAL_US 1000
+#define CACHE_LINE 64
+
+#define FILE_MODES (O_WRONLY | O_CREAT | O_TRUNC)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+#define BENCH_THREADS_DEFAULT 4
+#define BENCH_LINES_DEFAULT 200000
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_SPEC = 32 // one conversion spec, "%-08.3lld"
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3
+} LOG_LEVELS;
+
+typedef enum
+{
+    LOG_FULL_DROP = 0,
+    LOG_FULL_WAIT = 1
+} LOG_FULL_POLICIES;
+
+typedef enum
+{
+    LOG_ARG_I64 = 0,
+    LOG_ARG_U64 = 1,
+    LOG_ARG_F64 = 2,
+    LOG_ARG_STR = 3,
+    LOG_ARG_PTR = 4
+} LOG_ARG_TYPES;
+
+/* ----- Globals and Shared Variables ---- */
+
+typedef union
+{
+    int64_t i;
+    uint64_t u;
+    double f;
+    const char *s;
+    const void *p;
+} log_value_t;
+
+typedef struct
+{
+    log_value_t value;
+    uint8_t type;
+} log_arg_t;
+
+typedef struct
+{
+    uint64_t t_ns;
+    const char *format;
+    log_value_t values[LOG_ARGS_MAX];
+    uint8_t types[LOG_ARGS_MAX];
+    uint8_t n_args;
+    uint8_t level;
+} log_record_t; // 64 bytes, one cache line on x86 and the Cortex-A53
+
+typedef struct
+{
+    _Alignas(CACHE_LINE) size_t tail; // producer writes, flusher reads
+    size_t head_cache;                // producer's last look at head
+    size_t dropped;
+    int thread_index;
+
+    _Alignas(CACHE_LINE) size_t head; // flusher writes, producer reads
+
+    _Alignas(CACHE_LINE) log_record_t slots[LOG_RING_SLOTS];
+} log_ring_t;
+
+typedef struct
+{
+    int fd;
+    LOG_FULL_POLICIES full_policy;
+    uint64_t t_start_ns;
+    int stop;
+    pthread_t flusher;
+    unsigned generation; // tells a thread's ring of an earlier logger from one of this logger
+
+    log_ring_t *rings[LOG_THREADS_MAX];
+    size_t n_rings; // slots handed out, a slot may still be NULL for a moment
+
+    char chunks[LOG_CHUNKS][LOG_CHUNK_SIZE];
+    size_t chunk_used[LOG_CHUNKS];
+    int chunk_current;
+
+    size_t lines_written;
+    size_t writev_calls;
+} logger_t;
+
+typedef struct
+{
+    int id;
+    int use_rings;
+    size_t lines;
+    double ns_per_call;
+} bench_thread_t;
+
+static logger_t *g_logger = NULL;
+static unsigned g_generation = 0;
+static __thread log_ring_t *tls_ring = NULL;
+static __thread unsigned tls_generation = 0;
+static int g_bench_fd = -1;
+
+/* ----- Macro Functions ---- */
+
+#define CHECK_ERR(ret)                              \
+    do                                              \
+    {                                               \
+        if (ret != 0)                               \
+        {                                           \
+            fprintf(stderr, "%s\n", strerror(ret)); \
+            exit(EXIT_FAILURE);                     \
+        }                                           \
+    } while (0)
+
+#define load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// The type of every argument is picked at the call site, the flusher formats with it
+#define LOG_ARG(x) _Generic((x),                                                        \
+    char *: log_arg_str, const char *: log_arg_str,                                     \
+    float: log_arg_f64, double: log_arg_f64,                                            \
+    unsigned char: log_arg_u64, unsigned short: log_arg_u64, unsigned int: log_arg_u64, \
+    unsigned long: log_arg_u64, unsigned long long: log_arg_u64,                        \
+    void *: log_arg_ptr, const void *: log_arg_ptr,                                     \
+    default: log_arg_i64)(x)
+
+#define LOG_COUNT(...) LOG_COUNT_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define LOG_COUNT_(_0, _1, _2, _3, _4, _5, N, ...) N
+
+#define LOG_MAP_0()
+#define LOG_MAP_1(a) LOG_ARG(a)
+#define LOG_MAP_2(a, ...) LOG_ARG(a), LOG_MAP_1(__VA_ARGS__)
+#define LOG_MAP_3(a, ...) LOG_ARG(a), LOG_MAP_2(__VA_ARGS__)
+#define LOG_MAP_4(a, ...) LOG_ARG(a), LOG_MAP_3(__VA_ARGS__)
+#define LOG_MAP_5(a, ...) LOG_ARG(a), LOG_MAP_4(__VA_ARGS__)
+#define LOG_MAP_(n, ...) LOG_MAP_##n(__VA_ARGS__)
+#define LOG_MAP(n, ...) LOG_MAP_(n, __VA_ARGS__)
+
+// LOG(LOG_LEVEL_INFO, "worker %d done in %.3f s", id, seconds); the format must be a literal (it's read later)
+#define LOG(level, format, ...)                                                       \
+    log_push((level), (format), LOG_COUNT(__VA_ARGS__),                               \
+             (const log_arg_t[LOG_ARGS_MAX + 1]){LOG_MAP(LOG_COUNT(__VA_ARGS__), ##__VA_ARGS__)})
+
+/* ----- Function Prototypes ---- */
+
+static int log_init(logger_t *logger, int fd, LOG_FULL_POLICIES full_policy);
+static void log_shutdown(logger_t *logger);
+static inline void log_push(LOG_LEVELS level, const char *format, int n_args, const log_arg_t *args);
+static log_ring_t *log_register_thread(logger_t *logger);
+static void log_error(const char *msg_prefix);
+
+static void *flusher_handler(void *arg);
+static size_t flush_round(logger_t *logger);
+static void flush_chunks(logger_t *logger);
+static void emit_record(logger_t *logger, const log_record_t *rec, int thread_index);
+static int format_record(const log_record_t *rec, int thread_index, uint64_t t_start_ns, char *dst, size_t cap);
+static int format_value(char *dst, size_t cap, const char *spec, size_t spec_len, char conversion, uint8_t type, log_value_t value);
+
+static void *bench_handler(void *arg);
+static void log_direct(int fd, const char *format, ...);
+
+static inline uint64_t now_ns(void);
+
+static inline log_arg_t log_arg_i64(int64_t v) { return (log_arg_t){.value.i = v, .type = LOG_ARG_I64}; }
+static inline log_arg_t log_arg_u64(uint64_t v) { return (log_arg_t){.value.u = v, .type = LOG_ARG_U64}; }
+static inline log_arg_t log_arg_f64(double v) { return (log_arg_t){.value.f = v, .type = LOG_ARG_F64}; }
+static inline log_arg_t log_arg_str(const char *v) { return (log_arg_t){.value.s = v, .type = LOG_ARG_STR}; }
+static inline log_arg_t log_arg_ptr(const void *v) { return (log_arg_t){.value.p = v, .type = LOG_ARG_PTR}; }
+
+/* ----- Main Function ---- */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <output_file> [threads] [lines_per_thread]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const int n_threads = (argc > 2) ? atoi(argv[2]) : BENCH_THREADS_DEFAULT;
+    const size_t n_lines = (argc > 3) ? strtoul(argv[3], NULL, 10) : BENCH_LINES_DEFAULT;
+    if (n_threads < 1 || n_threads >= LOG_THREADS_MAX)
+    {
+        fprintf(stderr, "Threads must be between 1 and %d\n", LOG_THREADS_MAX - 1);
+        return EXIT_FAILURE;
+    }
+
+    printf("path,threads,lines,seconds,ns_per_call,syscalls\n");
+
+    for (int use_rings = 0; use_rings <= 1; use_rings++)
+    {
+        int fd = open(argv[1], FILE_MODES, FILE_PERMISSIONS);
+        if (fd == -1)
+        {
+            perror("open");
+            return EXIT_FAILURE;
+        }
+
+        logger_t *logger = NULL;
+        if (use_rings)
+        {
+            logger = malloc(sizeof(logger_t)); // 256K of chunks, not for the stack
+            if (logger == NULL || log_init(logger, fd, LOG_FULL_WAIT) != 0)
+            {
+                fprintf(stderr, "Cannot start the logger\n");
+                return EXIT_FAILURE;
+            }
+        }
+        g_bench_fd = fd;
+
+        pthread_t t[LOG_THREADS_MAX];
+        bench_thread_t t_data[LOG_THREADS_MAX];
+        const uint64_t t_start = now_ns();
+        for (int i = 0; i < n_threads; i++)
+        {
+            t_data[i] = (bench_thread_t){.id = i, .use_rings = use_rings, .lines = n_lines};
+            CHECK_ERR(pthread_create(&t[i], NULL, bench_handler, &t_data[i]));
+        }
+
+        double ns_per_call = 0;
+        for (int i = 0; i < n_threads; i++)
+        {
+            CHECK_ERR(pthread_join(t[i], NULL));
+            ns_per_call += t_data[i].ns_per_call / n_threads;
+        }
+
+        size_t syscalls = (size_t)n_threads * n_lines;
+        if (use_rings)
+        {
+            log_shutdown(logger); // wall time includes the drain, the lines are in the file after this
+            syscalls = logger->writev_calls;
+            free(logger);
+        }
+        const double seconds = (double)(now_ns() - t_start) * 1e-9;
+        close(fd);
+
+        printf("%s,%d,%zu,%.4f,%.1f,%zu\n", use_rings ? "ring" : "direct", n_threads, (size_t)n_threads * n_lines, seconds, ns_per_call, syscalls);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* ----- Function Implementations ---- */
+
+static int log_init(logger_t *logger, int fd, LOG_FULL_POLICIES full_policy)
+{
+    memset(logger, 0, sizeof(*logger));
+    logger->fd = fd;
+    logger->full_policy = full_policy;
+    logger->t_start_ns = now_ns();
+    logger->generation = ++g_generation; // never 0, a thread that never logged doesn't match by accident
+
+    store_release(&g_logger, logger);
+    int rc = pthread_create(&logger->flusher, NULL, flusher_handler, logger);
+    if (rc != 0)
+    {
+        store_release(&g_logger, (logger_t *)NULL);
+    }
+    return rc;
+}
+
+static void log_shutdown(logger_t *logger)
+{
+    // Producers must be done: their next LOG() would go to a ring that is about to be freed
+    store_release(&logger->stop, 1);
+    CHECK_ERR(pthread_join(logger->flusher, NULL));
+    store_release(&g_logger, (logger_t *)NULL);
+
+    const size_t n = load_acquire(&logger->n_rings);
+    for (size_t i = 0; i < n && i < LOG_THREADS_MAX; i++)
+    {
+        log_ring_t *ring = load_acquire(&logger->rings[i]);
+        if (ring != NULL && __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) > 0)
+        {
+            fprintf(stderr, "logger: T%d dropped %zu lines (ring full)\n", ring->thread_index, ring->dropped);
+        }
+        free(ring);
+    }
+    tls_ring = NULL; // other threads notice through the generation on their next LOG()
+}
+
+static inline void log_push(LOG_LEVELS level, const char *format, int n_args, const log_arg_t *args)
+{
+    logger_t *logger = load_acquire(&g_logger);
+    if (__builtin_expect(logger == NULL, 0))
+    {
+        return; // no logger (yet, or any more)
+    }
+
+    // First LOG() of this thread, or its ring belonged to a logger that was shut down (and freed it)
+    log_ring_t *ring = tls_ring;
+    if (__builtin_expect(ring == NULL || tls_generation != logger->generation, 0))
+    {
+        ring = tls_ring = log_register_thread(logger);
+        tls_generation = logger->generation;
+        if (ring == NULL)
+        {
+            return; // out of ring slots, tried again on the next LOG()
+        }
+    }
+
+    const size_t tail = ring->tail; // only this thread writes it
+    if (tail - ring->head_cache == LOG_RING_SLOTS)
+    {
+        ring->head_cache = load_acquire(&ring->head);
+        while (tail - ring->head_cache == LOG_RING_SLOTS)
+        {
+            if (logger->full_policy == LOG_FULL_DROP)
+            {
+                __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+                return;
+            }
+            sched_yield(); // let the flusher run, matters on a single core
+            ring->head_cache = load_acquire(&ring->head);
+        }
+    }
+
+    log_record_t *rec = &ring->slots[tail & (LOG_RING_SLOTS - 1)];
+    rec->t_ns = now_ns();
+    rec->format = format;
+    rec->level = (uint8_t)level;
+    rec->n_args = (uint8_t)((n_args < LOG_ARGS_MAX) ? n_args : LOG_ARGS_MAX);
+    for (int i = 0; i < rec->n_args; i++)
+    {
+        rec->values[i] = args[i].value;
+        rec->types[i] = args[i].type;
+    }
+
+    // The slot is complete before the flusher can see the new tail
+    store_release(&ring->tail, tail + 1);
+}
+
+static log_ring_t *log_register_thread(logger_t *logger)
+{
+    // Compare-and-swap instead of fetch_add: past LOG_THREADS_MAX n_rings stays at the cap, however many
+    // unregistered threads keep calling LOG()
+    size_t index = __atomic_load_n(&logger->n_rings, __ATOMIC_RELAXED);
+    do
+    {
+        if (index >= LOG_THREADS_MAX)
+        {
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&logger->n_rings, &index, index + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    log_ring_t *ring = aligned_alloc(CACHE_LINE, sizeof(log_ring_t));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(*ring)); // also faults the pages in now, not on the first lap of LOG() calls
+    ring->thread_index = (int)index;
+
+    store_release(&logger->rings[index], ring);
+    return ring;
+}
+
+static void log_error(const char *msg_prefix)
+{
+    // Same call as the log_error() of the other examples, errno is read here, not on the flusher
+    LOG(LOG_LEVEL_ERROR, "%s: %s", msg_prefix, strerror(errno));
+}
+
+static void *flusher_handler(void *arg)
+{
+    logger_t *logger = arg;
+    const struct timespec interval = {.tv_sec = 0, .tv_nsec = LOG_FLUSH_INTERVAL_US * 1000L};
+
+    for (;;)
+    {
+        const int stop = load_acquire(&logger->stop);
+        const size_t lines = flush_round(logger);
+        if (stop && lines == 0)
+        {
+            break; // stop was seen before this round, so the round took everything that was logged
+        }
+        if (lines == 0)
+        {
+            nanosleep(&interval, NULL);
+        }
+    }
+    return NULL;
+}
+
+static size_t flush_round(logger_t *logger)
+{
+    // Snapshot of every ring, then a k-way merge by timestamp (the number of threads is small, a scan is enough)
+    log_ring_t *rings[LOG_THREADS_MAX];
+    size_t heads[LOG_THREADS_MAX];
+    size_t tails[LOG_THREADS_MAX];
+    size_t n = load_acquire(&logger->n_rings);
+    n = (n < LOG_THREADS_MAX) ? n : LOG_THREADS_MAX;
+
+    size_t lines = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        rings[i] = load_acquire(&logger->rings[i]);
+        heads[i] = tails[i] = 0;
+        if (rings[i] != NULL)
+        {
+            heads[i] = rings[i]->head;
+            tails[i] = load_acquire(&rings[i]->tail);
+        }
+    }
+
+    for (;;)
+    {
+        size_t best = n;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (heads[i] != tails[i] &&
+                (best == n || rings[i]->slots[heads[i] & (LOG_RING_SLOTS - 1)].t_ns < rings[best]->slots[heads[best] & (LOG_RING_SLOTS - 1)].t_ns))
+            {
+                best = i;
+            }
+        }
+        if (best == n)
+        {
+            break;
+        }
+
+        emit_record(logger, &rings[best]->slots[heads[best] & (LOG_RING_SLOTS - 1)], rings[best]->thread_index);
+        heads[best]++;
+        lines++;
+
+        // Give the slots back in batches, not per line: fewer writes to the cache line the producer polls
+        if ((heads[best] & 63) == 0)
+        {
+            store_release(&rings[best]->head, heads[best]);
+        }
+    }
+
+    flush_chunks(logger);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (rings[i] != NULL)
+        {
+            store_release(&rings[i]->head, heads[i]); // a slot is free once its line is formatted
+        }
+    }
+    logger->lines_written += lines;
+    return lines;
+}
+
+static void emit_record(logger_t *logger, const log_record_t *rec, int thread_index)
+{
+    // A line never spans two chunks, a chunk is closed when the longest line might not fit anymore
+    if (LOG_CHUNK_SIZE - logger->chunk_used[logger->chunk_current] < LOG_LINE_MAX)
+    {
+        if (++logger->chunk_current == LOG_CHUNKS)
+        {
+            flush_chunks(logger);
+        }
+    }
+
+    char *dst = logger->chunks[logger->chunk_current] + logger->chunk_used[logger->chunk_current];
+    int len = format_record(rec, thread_index, logger->t_start_ns, dst, LOG_LINE_MAX);
+    logger->chunk_used[logger->chunk_current] += (size_t)len;
+}
+
+static void flush_chunks(logger_t *logger)
+{
+    struct iovec iov[LOG_CHUNKS];
+    int count = 0;
+    for (int i = 0; i < LOG_CHUNKS && i <= logger->chunk_current; i++)
+    {
+        if (logger->chunk_used[i] > 0)
+        {
+            iov[count].iov_base = logger->chunks[i];
+            iov[count].iov_len = logger->chunk_used[i];
+            count++;
+        }
+    }
+
+    int first = 0;
+    while (first < count)
+    {
+        ssize_t written = writev(logger->fd, &iov[first], count - first);
+        logger->writev_calls++;
+        if (written == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("logger: writev"); // the logger can't log its own failure, stderr directly
+            break;
+        }
+
+        // Partial write: skip what went out
+        size_t left = (size_t)written;
+        while (first < count && left >= iov[first].iov_len)
+        {
+            left -= iov[first].iov_len;
+            first++;
+        }
+        if (left > 0)
+        {
+            iov[first].iov_base = (char *)iov[first].iov_base + left;
+            iov[first].iov_len -= left;
+        }
+    }
+
+    memset(logger->chunk_used, 0, sizeof(logger->chunk_used));
+    logger->chunk_current = 0;
+}
+
+static int format_record(const log_record_t *rec, int thread_index, uint64_t t_start_ns, char *dst, size_t cap)
+{
+    static const char LEVEL_CHARS[] = {'D', 'I', 'W', 'E'};
+
+    const uint64_t t_rel = rec->t_ns - t_start_ns;
+    int len = snprintf(dst, cap, "[%5llu.%06llu] T%d %c ", (unsigned long long)(t_rel / 1000000000ULL),
+                       (unsigned long long)(t_rel / 1000ULL % 1000000ULL), thread_index, LEVEL_CHARS[rec->level & 3]);
+    size_t used = (len > 0) ? (size_t)len : 0;
+
+    // Walk the format: text is copied, every conversion is printed with the type stored for its argument
+    int arg = 0;
+    const char *p = rec->format;
+    while (*p != '\0' && used + 1 < cap)
+    {
+        if (*p != '%')
+        {
+            dst[used++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            dst[used++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion, the length is dropped, the stored type decides it
+        const char *spec_start = p++;
+        while (*p != '\0' && strchr("-+ #0", *p) != NULL)
+        {
+            p++;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            p++;
+        }
+        if (*p == '.')
+        {
+            p++;
+            while (*p >= '0' && *p <= '9')
+            {
+                p++;
+            }
+        }
+        const size_t spec_len = (size_t)(p - spec_start);
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL)
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        const char conversion = *p++;
+        log_value_t value = {0};
+        uint8_t type = LOG_ARG_STR;
+        if (arg < rec->n_args)
+        {
+            value = rec->values[arg];
+            type = rec->types[arg];
+        }
+        else
+        {
+            value.s = "(missing)";
+        }
+        arg++;
+
+        len = format_value(dst + used, cap - used, spec_start, spec_len, conversion, type, value);
+        if (len > 0)
+        {
+            used += ((size_t)len < cap - used) ? (size_t)len : cap - used - 1;
+        }
+    }
+
+    if (used + 1 >= cap)
+    {
+        used = cap - 2; // capped line, still ends with '\n'
+    }
+    dst[used++] = '\n';
+    return (int)used;
+}
+
+static int format_value(char *dst, size_t cap, const char *spec, size_t spec_len, char conversion, uint8_t type, log_value_t value)
+{
+    // spec without its length modifier + the one that matches how the value is passed below
+    char fmt[SIZE_BUF_SPEC] = {'\0'};
+    if (spec_len > SIZE_BUF_SPEC - 4)
+    {
+        spec_len = SIZE_BUF_SPEC - 4;
+    }
+    memcpy(fmt, spec, spec_len);
+
+    switch (conversion)
+    {
+    case 'd':
+    case 'i':
+        memcpy(fmt + spec_len, "ll", 2);
+        fmt[spec_len + 2] = conversion;
+        return snprintf(dst, cap, fmt, (type == LOG_ARG_F64) ? (long long)value.f : (long long)value.i);
+
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        memcpy(fmt + spec_len, "ll", 2);
+        fmt[spec_len + 2] = conversion;
+        return snprintf(dst, cap, fmt, (type == LOG_ARG_F64) ? (unsigned long long)value.f : (unsigned long long)value.u);
+
+    case 'c':
+        fmt[spec_len] = 'c';
+        return snprintf(dst, cap, fmt, (int)value.i);
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        fmt[spec_len] = conversion;
+        return snprintf(dst, cap, fmt, (type == LOG_ARG_F64) ? value.f : (type == LOG_ARG_U64) ? (double)value.u : (double)value.i);
+
+    case 's':
+        fmt[spec_len] = 's';
+        return snprintf(dst, cap, fmt, (type == LOG_ARG_STR && value.s != NULL) ? value.s : "(not a string)");
+
+    case 'p':
+        fmt[spec_len] = 'p';
+        return snprintf(dst, cap, fmt, value.p);
+
+    default:
+        return snprintf(dst, cap, "%%%c", conversion); // unknown conversion, shown as is
+    }
+}
+
+static void *bench_handler(void *arg)
+{
+    bench_thread_t *t_data = arg;
+    const uint64_t t_start = now_ns();
+
+    for (size_t i = 0; i < t_data->lines; i++)
+    {
+        if (t_data->use_rings)
+        {
+            LOG(LOG_LEVEL_INFO, "worker %d: item %zu done, value %.3f (%s)", t_data->id, i, (double)i * 0.5, "ok");
+        }
+        else
+        {
+            log_direct(g_bench_fd, "worker %d: item %zu done, value %.3f (%s)", t_data->id, i, (double)i * 0.5, "ok");
+        }
+    }
+
+    if (t_data->use_rings && t_data->id == 0)
+    {
+        errno = ENOENT;
+        log_error("Example error line"); // same call sites as before work unchanged
+    }
+
+    t_data->ns_per_call = (double)(now_ns() - t_start) / (double)(t_data->lines ? t_data->lines : 1);
+    return NULL;
+}
+
+static void log_direct(int fd, const char *format, ...)
+{
+    // The printer() / log_error() way: format on the calling thread, one write() per line
+    char buf[SIZE_BUF_LOG] = {'\0'};
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf) - 1, format, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG - 2)
+        {
+            len = SIZE_BUF_LOG - 2;
+        }
+        buf[len++] = '\n';
+        (void)write(fd, buf, len);
+    }
+}
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts); // vDSO, no syscall
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
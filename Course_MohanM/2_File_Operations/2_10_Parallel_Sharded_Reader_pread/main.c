@@ -0,0 +1,475 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+In 2_4 lseek() and read() work on the file offset, which is stored in the open file description: every thread
+(and every process after fork()) using that fd moves the same offset, so they have to take turns.
+pread() takes the offset as an argument and leaves the file offset alone, so N threads can read N parts of the
+same fd at the same time without any locking.
+
+The file is cut into one byte range (shard) per thread. A cut at size * i / n usually lands inside a record,
+so every cut is moved forward to the next record start:
+- lines (default) : just after the next '\n' (a cut right after a '\n' stays where it is)
+- --record <size> : the next multiple of the record size
+A shard owns the records that start inside it, so every record is counted once, by exactly one thread,
+whatever the number of threads. A line longer than a whole shard leaves that shard empty.
+
+Every thread reads its range in blocks and reports:
+- records : lines ('\n' count, + 1 for a last line without '\n') or fixed size records (the last one may be short)
+- checksum: 64 bit FNV-1a over the shard, 8 bytes at a time (the tail byte by byte). It depends on the shard
+            edges, so compare the same file with the same number of threads.
+The total record count does not depend on the thread count, it must equal `wc -l` for lines.
+
+Usage:
+./main <file> [threads] [--record <size>] [--block <size>]
+threads defaults to the number of online CPUs.
+
+Example:
+./main big.log 4
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>    // open(), posix_fadvise()
+#include <unistd.h>   // pread(), close(), sysconf()
+#include <sys/stat.h> // fstat()
+#include <pthread.h>  // pthread_create(), pthread_join()
+#include <stdio.h>    // snprintf()
+#include <stdlib.h>   // malloc(), strtoul()
+#include <string.h>   // strerror(), strcmp(), memchr(), memcpy()
+#include <stdint.h>   // uint64_t
+#include <errno.h>    // errno
+#include <time.h>     // clock_gettime()
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES (O_RDONLY)
+
+#define OPTION_RECORD "--record"
+#define OPTION_BLOCK "--block"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256,
+    SIZE_BUF_REALIGN = 4096 // looking for the next '\n' after a cut
+};
+
+enum READ_SETTINGS
+{
+    BLOCK_SIZE_DEFAULT = 1024 * 1024,
+    BLOCK_SIZE_MIN = 4096,
+    CHECKSUM_WORD = 8, // the block size must be a multiple of it, so the words line up the same in every block
+    THREADS_MAX = 1024,
+    RECORD_NEWLINE = 0
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_READ = -3,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7,
+    ERR_THREAD = -8
+
+} EXIT_TYPES;
+
+typedef struct
+{
+    int index;
+    int fd; // shared by all the shards, only used with pread()
+    off_t start;
+    off_t end; // exclusive
+    size_t block_size;
+    size_t record_size; // RECORD_NEWLINE for lines
+
+    uint64_t records;
+    uint64_t checksum;
+    double seconds;
+    EXIT_TYPES ret;
+} shard_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES find_record_start(int fd, off_t cut, off_t limit, size_t record_size, off_t *start);
+void *scan_shard(void *arg);
+uint64_t checksum_update(uint64_t hash, const uint8_t *buf, size_t len);
+uint64_t count_newlines(const uint8_t *buf, size_t len);
+
+size_t parse_size(const char *text);
+double now_sec(void);
+void log_shard(const shard_t *shard);
+void log_total(int n_threads, off_t bytes, uint64_t records, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <file> [threads] [%s <size>] [%s <size>]\n", argv[0], OPTION_RECORD, OPTION_BLOCK);
+        return ERR_ARGS;
+    }
+
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t record_size = RECORD_NEWLINE;
+    size_t block_size = BLOCK_SIZE_DEFAULT;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_RECORD) == 0 && i + 1 < argc)
+        {
+            record_size = parse_size(argv[++i]);
+        }
+        else if (strcmp(argv[i], OPTION_BLOCK) == 0 && i + 1 < argc)
+        {
+            block_size = parse_size(argv[++i]);
+        }
+        else
+        {
+            n_threads = strtol(argv[i], NULL, 10);
+        }
+    }
+    if (n_threads < 1 || n_threads > THREADS_MAX)
+    {
+        fprintf(stderr, "Threads must be between 1 and %d\n", THREADS_MAX);
+        return ERR_ARGS;
+    }
+    if (block_size < BLOCK_SIZE_MIN || block_size % CHECKSUM_WORD != 0)
+    {
+        fprintf(stderr, "Block size must be a multiple of %d and at least %d bytes\n", CHECKSUM_WORD, BLOCK_SIZE_MIN);
+        return ERR_ARGS;
+    }
+
+    int fd = open(argv[1], FILE_MODES);
+    if (fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the file");
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the file size");
+        close_file_safer(fd);
+        return ERR_FILE_READ;
+    }
+    // Every shard is read front to back, the kernel can read ahead in all of them
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    shard_t *shards = calloc((size_t)n_threads, sizeof(shard_t));
+    pthread_t *threads = malloc((size_t)n_threads * sizeof(pthread_t));
+    if (shards == NULL || threads == NULL)
+    {
+        log_error("Error allocating the shards");
+        free(shards);
+        free(threads);
+        close_file_safer(fd);
+        return ERR_ALLOC;
+    }
+
+    const double t_start = now_sec();
+
+    // Realign every cut. Shard i ends where shard i + 1 starts, so nothing falls between two shards.
+    EXIT_TYPES ret = SUCCESS;
+    off_t prev_start = 0;
+    for (long i = n_threads - 1; i >= 0 && ret == SUCCESS; i--)
+    {
+        shard_t *shard = &shards[i];
+        shard->index = (int)i;
+        shard->fd = fd;
+        shard->block_size = block_size;
+        shard->record_size = record_size;
+        shard->end = (i == n_threads - 1) ? st.st_size : prev_start;
+
+        const off_t cut = (off_t)((double)st.st_size * (double)i / (double)n_threads);
+        ret = find_record_start(fd, cut, shard->end, record_size, &shard->start);
+        prev_start = shard->start;
+    }
+
+    long n_started = 0;
+    for (; n_started < n_threads && ret == SUCCESS; n_started++)
+    {
+        int err = pthread_create(&threads[n_started], NULL, scan_shard, &shards[n_started]);
+        if (err != 0)
+        {
+            errno = err;
+            log_error("Error creating a shard thread");
+            ret = ERR_THREAD;
+            break;
+        }
+    }
+
+    uint64_t records = 0;
+    for (long i = 0; i < n_started; i++)
+    {
+        pthread_join(threads[i], NULL);
+        if (shards[i].ret != SUCCESS && ret == SUCCESS)
+        {
+            ret = shards[i].ret;
+        }
+        records += shards[i].records;
+    }
+    const double seconds = now_sec() - t_start;
+
+    if (ret == SUCCESS)
+    {
+        printf("shard,start,end,bytes,records,checksum,seconds\n");
+        fflush(stdout); // log_shard() writes to the fd directly
+        for (long i = 0; i < n_threads; i++)
+        {
+            log_shard(&shards[i]);
+        }
+        log_total((int)n_threads, st.st_size, records, seconds);
+    }
+
+    free(shards);
+    free(threads);
+    if (close_file_safer(fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES find_record_start(int fd, off_t cut, off_t limit, size_t record_size, off_t *start)
+{
+    if (cut <= 0)
+    {
+        *start = 0;
+        return SUCCESS;
+    }
+    if (cut >= limit)
+    {
+        *start = limit;
+        return SUCCESS;
+    }
+
+    if (record_size != RECORD_NEWLINE)
+    {
+        off_t aligned = (cut + (off_t)record_size - 1) / (off_t)record_size * (off_t)record_size;
+        *start = (aligned < limit) ? aligned : limit;
+        return SUCCESS;
+    }
+
+    // A line starts right after a '\n': look from the byte before the cut, so a cut that is already
+    // on a line start stays there. No '\n' before the limit: the shard is part of the line before it.
+    uint8_t buf[SIZE_BUF_REALIGN];
+    off_t pos = cut - 1;
+    while (pos < limit)
+    {
+        size_t want = ((off_t)sizeof(buf) < limit - pos) ? sizeof(buf) : (size_t)(limit - pos);
+        ssize_t bytes_read = pread(fd, buf, want, pos);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error reading the file");
+            return ERR_FILE_READ;
+        }
+        else if (bytes_read == 0) // file got shorter
+        {
+            break;
+        }
+
+        const uint8_t *newline = memchr(buf, '\n', (size_t)bytes_read);
+        if (newline != NULL)
+        {
+            *start = pos + (newline - buf) + 1;
+            return SUCCESS;
+        }
+        pos += bytes_read;
+    }
+
+    *start = limit;
+    return SUCCESS;
+}
+
+void *scan_shard(void *arg)
+{
+    shard_t *shard = (shard_t *)arg;
+    const double t_start = now_sec();
+
+    shard->checksum = FNV_OFFSET_BASIS;
+    shard->ret = SUCCESS;
+
+    uint8_t *buf = malloc(shard->block_size);
+    if (buf == NULL)
+    {
+        log_error("Error allocating the shard buffer");
+        shard->ret = ERR_ALLOC;
+        return NULL;
+    }
+
+    off_t pos = shard->start;
+    uint8_t last_byte = '\n';
+    while (pos < shard->end)
+    {
+        size_t want = ((off_t)shard->block_size < shard->end - pos) ? shard->block_size : (size_t)(shard->end - pos);
+        ssize_t bytes_read = pread(shard->fd, buf, want, pos);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error reading the shard");
+            shard->ret = ERR_FILE_READ;
+            break;
+        }
+        else if (bytes_read == 0) // file got shorter
+        {
+            break;
+        }
+
+        shard->checksum = checksum_update(shard->checksum, buf, (size_t)bytes_read);
+        if (shard->record_size == RECORD_NEWLINE)
+        {
+            shard->records += count_newlines(buf, (size_t)bytes_read);
+            last_byte = buf[bytes_read - 1];
+        }
+        pos += bytes_read;
+    }
+
+    const uint64_t bytes = (uint64_t)(pos - shard->start);
+    if (shard->record_size == RECORD_NEWLINE)
+    {
+        shard->records += (bytes > 0 && last_byte != '\n'); // last line of the file without '\n'
+    }
+    else
+    {
+        shard->records = (bytes + shard->record_size - 1) / shard->record_size;
+    }
+
+    free(buf);
+    shard->seconds = now_sec() - t_start;
+    return NULL;
+}
+
+uint64_t checksum_update(uint64_t hash, const uint8_t *buf, size_t len)
+{
+    size_t i = 0;
+    for (; i + CHECKSUM_WORD <= len; i += CHECKSUM_WORD)
+    {
+        uint64_t word;
+        memcpy(&word, buf + i, sizeof(word)); // unaligned load, one instruction on x86 / ARMv8
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    for (; i < len; i++) // only in the last block of a shard
+    {
+        hash = (hash ^ buf[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t count_newlines(const uint8_t *buf, size_t len)
+{
+    // No branch in the loop, the compiler turns it into compares + adds on 16 / 32 bytes at a time
+    uint64_t count = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        count += (buf[i] == '\n');
+    }
+    return count;
+}
+
+size_t parse_size(const char *text)
+{
+    char *end = NULL;
+    size_t value = strtoul(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_shard(const shard_t *shard)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%d,%lld,%lld,%lld,%llu,%016llx,%.4f\n",
+                       shard->index, (long long)shard->start, (long long)shard->end, (long long)(shard->end - shard->start),
+                       (unsigned long long)shard->records, (unsigned long long)shard->checksum, shard->seconds);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+void log_total(int n_threads, off_t bytes, uint64_t records, double seconds)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "\nthreads,bytes,records,seconds,gb_per_s\n%d,%lld,%llu,%.4f,%.3f\n",
+                       n_threads, (long long)bytes, (unsigned long long)records, seconds,
+                       (seconds > 0) ? (double)bytes / seconds / 1e9 : 0.0);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
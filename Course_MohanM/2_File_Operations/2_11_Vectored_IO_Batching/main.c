@@ -0,0 +1,570 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+write_to_a_file_and_log_safe() (2_4) and write_to_a_file_safer() (7_9) do one write() per message.
+For a chatty writer (a log line per event) the syscall, not the copy, is the cost: entering the kernel,
+taking the inode lock, updating the file size and times, once per 40 byte line.
+
+batch_writer_t gathers the records and hands them to the kernel together:
+
+- batch_printf()     : formats straight into the writer's arena (no stack buffer + copy), records that follow each
+                       other in the arena become one iovec
+- batch_append_ref() : queues caller memory without copying (a struct iovec entry pointing at it), the memory
+                       must stay valid until a flush returns SUCCESS. With RWF_NOWAIT that may not be the flush
+                       the append triggered: ERR_WOULD_BLOCK from batch_append_ref() means the record is queued
+                       and still referenced
+- one writev() / pwritev2() per flush, up to IOV_BATCH_MAX iovecs, partial writes are resumed where they stopped
+
+A flush happens when
+- the pending bytes reach flush_bytes, or the arena or the iovec array is full
+- the oldest pending record is older than flush_interval (checked on every append, and in batch_poll() for
+  writers that go quiet). The clock is CLOCK_MONOTONIC_COARSE, a vDSO read, no syscall.
+- batch_flush() / batch_close()
+
+pwritev2() flags (Linux 4.6+ / 4.14+):
+- RWF_DSYNC  : this write is O_DSYNC, the data is on the disk when the call returns. Per batch instead of per record,
+               this is where batching saves the most.
+- RWF_NOWAIT : fail with EAGAIN instead of blocking (page cache pages not there, or the file system would have to
+               wait). The records stay pending and batch_flush() returns ERR_WOULD_BLOCK, the caller tries later.
+               If the arena is full there is no later, that flush blocks. Not every file system supports it for
+               writes: on EOPNOTSUPP the flag is dropped.
+Without flags, or without pwritev2(), plain writev() is used.
+
+The offset is always -1 (the current file offset, like write()), so it keeps working with O_APPEND and lseek().
+
+Benchmark: the same records written once with one pwritev2() each (the 2_4 / 7_9 way) and once through the batch writer.
+
+Usage:
+./main <file> [records] [--dsync] [--nowait] [--flush <bytes>] [--interval <ms>]
+
+Example:
+./main out.log 1000000
+./main out.log 20000 --dsync
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE // pwritev2(), RWF_*
+
+#include <fcntl.h>    // open()
+#include <unistd.h>   // write(), close()
+#include <sys/uio.h>  // writev(), pwritev2(), struct iovec
+#include <sys/stat.h> // permission macros
+#include <stdio.h>    // snprintf(), vsnprintf()
+#include <stdlib.h>   // malloc(), strtoul()
+#include <stdarg.h>   // va_list
+#include <string.h>   // strerror(), strcmp()
+#include <stdint.h>   // uint8_t
+#include <errno.h>    // errno
+#include <time.h>     // clock_gettime()
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES (O_WRONLY | O_CREAT | O_TRUNC)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+#define OPTION_DSYNC "--dsync"
+#define OPTION_NOWAIT "--nowait"
+#define OPTION_FLUSH "--flush"
+#define OPTION_INTERVAL "--interval"
+
+#ifndef RWF_DSYNC // old headers: no pwritev2() flags, the writer falls back to writev()
+#define RWF_DSYNC 0
+#endif
+#ifndef RWF_NOWAIT
+#define RWF_NOWAIT 0
+#endif
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256,
+    SIZE_BUF_RECORD = 128 // one benchmark record, the per-write path
+};
+
+enum BATCH_SETTINGS
+{
+    IOV_BATCH_MAX = 1024, // IOV_MAX on Linux, writev() refuses more
+    ARENA_SIZE_DEFAULT = 256 * 1024,
+    FLUSH_BYTES_DEFAULT = 64 * 1024,
+    FLUSH_INTERVAL_MS_DEFAULT = 100,
+    RECORDS_DEFAULT = 1000000
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_WRITE = -4,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7,
+    ERR_WOULD_BLOCK = -8 // RWF_NOWAIT: nothing lost, flush again later
+
+} EXIT_TYPES;
+
+typedef struct
+{
+    int fd;
+    int rwf_flags;
+
+    struct iovec iov[IOV_BATCH_MAX];
+    int iov_first; // entries before it are written (after a partial write)
+    int iov_count;
+
+    char *arena;
+    size_t arena_size;
+    size_t arena_used;
+
+    size_t bytes_pending;
+    size_t flush_bytes;
+    double flush_interval; // seconds
+    double t_oldest;       // when the oldest pending record came in
+
+    size_t n_records;
+    size_t n_syscalls;
+} batch_writer_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES batch_init(batch_writer_t *bw, int fd, size_t arena_size, size_t flush_bytes, unsigned flush_interval_ms, int rwf_flags);
+EXIT_TYPES batch_printf(batch_writer_t *bw, const char *format, ...) __attribute__((format(printf, 2, 3)));
+EXIT_TYPES batch_append_ref(batch_writer_t *bw, const void *data, size_t len);
+EXIT_TYPES batch_poll(batch_writer_t *bw);
+EXIT_TYPES batch_flush(batch_writer_t *bw);
+EXIT_TYPES batch_close(batch_writer_t *bw); // flushes (blocking), frees the arena, the fd stays open
+
+EXIT_TYPES batch_flush_flags(batch_writer_t *bw, int rwf_flags);
+EXIT_TYPES batch_check_thresholds(batch_writer_t *bw); // ERR_WOULD_BLOCK: the record is queued, not written yet
+ssize_t write_vector(int fd, const struct iovec *iov, int count, int rwf_flags);
+
+EXIT_TYPES bench_per_record(int fd, size_t n_records, int rwf_flags, size_t *n_syscalls);
+EXIT_TYPES bench_batched(int fd, size_t n_records, size_t flush_bytes, unsigned flush_interval_ms, int rwf_flags, size_t *n_syscalls);
+
+size_t parse_size(const char *text);
+double now_sec(void);
+double now_sec_coarse(void);
+void log_result(const char *path_name, size_t records, size_t syscalls, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <file> [records] [%s] [%s] [%s <bytes>] [%s <ms>]\n", argv[0], OPTION_DSYNC, OPTION_NOWAIT, OPTION_FLUSH, OPTION_INTERVAL);
+        return ERR_ARGS;
+    }
+
+    size_t n_records = RECORDS_DEFAULT;
+    size_t flush_bytes = FLUSH_BYTES_DEFAULT;
+    unsigned flush_interval_ms = FLUSH_INTERVAL_MS_DEFAULT;
+    int rwf_flags = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_DSYNC) == 0)
+        {
+            rwf_flags |= RWF_DSYNC;
+        }
+        else if (strcmp(argv[i], OPTION_NOWAIT) == 0)
+        {
+            rwf_flags |= RWF_NOWAIT;
+        }
+        else if (strcmp(argv[i], OPTION_FLUSH) == 0 && i + 1 < argc)
+        {
+            flush_bytes = parse_size(argv[++i]);
+        }
+        else if (strcmp(argv[i], OPTION_INTERVAL) == 0 && i + 1 < argc)
+        {
+            flush_interval_ms = (unsigned)strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            n_records = strtoul(argv[i], NULL, 10);
+        }
+    }
+    if (flush_bytes == 0 || flush_bytes > ARENA_SIZE_DEFAULT)
+    {
+        fprintf(stderr, "Flush threshold must be between 1 and %d bytes\n", ARENA_SIZE_DEFAULT);
+        return ERR_ARGS;
+    }
+
+    printf("path,records,syscalls,seconds,records_per_s\n");
+    fflush(stdout); // log_result() writes to the fd directly
+
+    EXIT_TYPES ret = SUCCESS;
+    for (int batched = 0; batched <= 1 && ret == SUCCESS; batched++)
+    {
+        int fd = open(argv[1], FILE_MODES, FILE_PERMISSIONS);
+        if (fd == ERR_GENERAL_ERROR)
+        {
+            log_error("Error opening the file");
+            return ERR_FILE_OPEN;
+        }
+
+        size_t n_syscalls = 0;
+        const double t_start = now_sec();
+        ret = batched ? bench_batched(fd, n_records, flush_bytes, flush_interval_ms, rwf_flags, &n_syscalls)
+                      : bench_per_record(fd, n_records, rwf_flags, &n_syscalls);
+        const double seconds = now_sec() - t_start;
+
+        if (close_file_safer(fd) != SUCCESS && ret == SUCCESS)
+        {
+            ret = ERR_FILE_CLOSE;
+        }
+        if (ret == SUCCESS)
+        {
+            log_result(batched ? "batched" : "per_record", n_records, n_syscalls, seconds);
+        }
+    }
+
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES batch_init(batch_writer_t *bw, int fd, size_t arena_size, size_t flush_bytes, unsigned flush_interval_ms, int rwf_flags)
+{
+    memset(bw, 0, sizeof(*bw));
+    bw->fd = fd;
+    bw->rwf_flags = rwf_flags;
+    bw->arena_size = arena_size;
+    bw->flush_bytes = flush_bytes;
+    bw->flush_interval = flush_interval_ms / 1000.0;
+
+    bw->arena = malloc(arena_size);
+    if (bw->arena == NULL)
+    {
+        log_error("Error allocating the batch arena");
+        return ERR_ALLOC;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES batch_printf(batch_writer_t *bw, const char *format, ...)
+{
+    for (int attempt = 0;; attempt++)
+    {
+        char *dst = bw->arena + bw->arena_used;
+        const size_t space = bw->arena_size - bw->arena_used;
+
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(dst, space, format, args); // the '\0' it adds is overwritten by the next record
+        va_end(args);
+        if (len < 0)
+        {
+            log_error("Error formatting a record");
+            return ERR_GENERAL_ERROR;
+        }
+
+        if ((size_t)len >= space)
+        {
+            if (attempt == 0 || bw->arena_used > 0)
+            {
+                // Doesn't fit behind the pending records: write them out (blocking, the arena is needed now)
+                EXIT_TYPES ret = batch_flush_flags(bw, bw->rwf_flags & ~RWF_NOWAIT);
+                if (ret != SUCCESS)
+                {
+                    return ret;
+                }
+                continue;
+            }
+            len = (int)space - 1; // bigger than the whole arena: capped, like the SIZE_BUF_* logs
+        }
+
+        // Right behind the previous copied record: same iovec
+        struct iovec *last = (bw->iov_count > bw->iov_first) ? &bw->iov[bw->iov_count - 1] : NULL;
+        if (last != NULL && (char *)last->iov_base + last->iov_len == dst)
+        {
+            last->iov_len += (size_t)len;
+        }
+        else
+        {
+            if (bw->iov_count == IOV_BATCH_MAX)
+            {
+                // The formatted text stays where it is, only the arena position is reset by the flush
+                EXIT_TYPES ret = batch_flush_flags(bw, bw->rwf_flags & ~RWF_NOWAIT);
+                if (ret != SUCCESS)
+                {
+                    return ret;
+                }
+                continue;
+            }
+            bw->iov[bw->iov_count].iov_base = dst;
+            bw->iov[bw->iov_count].iov_len = (size_t)len;
+            bw->iov_count++;
+        }
+
+        bw->arena_used += (size_t)len;
+        if (bw->bytes_pending == 0)
+        {
+            bw->t_oldest = now_sec_coarse();
+        }
+        bw->bytes_pending += (size_t)len;
+        bw->n_records++;
+
+        // The record is a copy in the arena, nothing for the caller to keep: the next append tries again
+        EXIT_TYPES ret = batch_check_thresholds(bw);
+        return (ret == ERR_WOULD_BLOCK) ? SUCCESS : ret;
+    }
+}
+
+EXIT_TYPES batch_append_ref(batch_writer_t *bw, const void *data, size_t len)
+{
+    if (len == 0)
+    {
+        return SUCCESS;
+    }
+    if (bw->iov_count == IOV_BATCH_MAX)
+    {
+        EXIT_TYPES ret = batch_flush_flags(bw, bw->rwf_flags & ~RWF_NOWAIT);
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+    }
+
+    bw->iov[bw->iov_count].iov_base = (void *)data;
+    bw->iov[bw->iov_count].iov_len = len;
+    bw->iov_count++;
+
+    if (bw->bytes_pending == 0)
+    {
+        bw->t_oldest = now_sec_coarse();
+    }
+    bw->bytes_pending += len;
+    bw->n_records++;
+    return batch_check_thresholds(bw); // ERR_WOULD_BLOCK goes back: data is still referenced
+}
+
+EXIT_TYPES batch_poll(batch_writer_t *bw)
+{
+    if (bw->bytes_pending > 0 && now_sec_coarse() - bw->t_oldest >= bw->flush_interval)
+    {
+        return batch_flush(bw);
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES batch_flush(batch_writer_t *bw)
+{
+    return batch_flush_flags(bw, bw->rwf_flags);
+}
+
+EXIT_TYPES batch_close(batch_writer_t *bw)
+{
+    EXIT_TYPES ret = batch_flush_flags(bw, bw->rwf_flags & ~RWF_NOWAIT);
+    free(bw->arena);
+    bw->arena = NULL;
+    return ret;
+}
+
+EXIT_TYPES batch_check_thresholds(batch_writer_t *bw)
+{
+    if (bw->bytes_pending >= bw->flush_bytes || now_sec_coarse() - bw->t_oldest >= bw->flush_interval)
+    {
+        return batch_flush(bw);
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES batch_flush_flags(batch_writer_t *bw, int rwf_flags)
+{
+    while (bw->iov_first < bw->iov_count)
+    {
+        int count = bw->iov_count - bw->iov_first;
+        ssize_t written = write_vector(bw->fd, &bw->iov[bw->iov_first], count, rwf_flags);
+        bw->n_syscalls++;
+        if (written == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN && (rwf_flags & RWF_NOWAIT))
+            {
+                return ERR_WOULD_BLOCK;
+            }
+            if (errno == EOPNOTSUPP && (rwf_flags & RWF_NOWAIT))
+            {
+                // The file system can't do non blocking writes, stop asking
+                bw->rwf_flags &= ~RWF_NOWAIT;
+                rwf_flags &= ~RWF_NOWAIT;
+                continue;
+            }
+            log_error("Error writing the batch");
+            return ERR_FILE_WRITE;
+        }
+
+        // Partial write: skip the iovecs that went out, trim the one it stopped in
+        size_t left = (size_t)written;
+        bw->bytes_pending -= left;
+        while (bw->iov_first < bw->iov_count && left >= bw->iov[bw->iov_first].iov_len)
+        {
+            left -= bw->iov[bw->iov_first].iov_len;
+            bw->iov_first++;
+        }
+        if (left > 0)
+        {
+            bw->iov[bw->iov_first].iov_base = (char *)bw->iov[bw->iov_first].iov_base + left;
+            bw->iov[bw->iov_first].iov_len -= left;
+        }
+    }
+
+    bw->iov_first = 0;
+    bw->iov_count = 0;
+    bw->arena_used = 0;
+    bw->bytes_pending = 0;
+    return SUCCESS;
+}
+
+ssize_t write_vector(int fd, const struct iovec *iov, int count, int rwf_flags)
+{
+#ifdef RWF_HIPRI // pwritev2() came with the first RWF_ flag
+    if (rwf_flags != 0)
+    {
+        return pwritev2(fd, iov, count, -1, rwf_flags); // -1: use and move the file offset, like writev()
+    }
+#else
+    (void)rwf_flags;
+#endif
+    return writev(fd, iov, count);
+}
+
+EXIT_TYPES bench_per_record(int fd, size_t n_records, int rwf_flags, size_t *n_syscalls)
+{
+    // The 2_4 / 7_9 way: snprintf() into a stack buffer, one syscall per record
+    for (size_t i = 0; i < n_records; i++)
+    {
+        char buf[SIZE_BUF_RECORD] = {'\0'};
+        int len = snprintf(buf, sizeof(buf), "record %zu: sensor %zu value %zu\n", i, i % 16, (i * 2654435761u) % 1000);
+        if (len > SIZE_BUF_RECORD)
+        {
+            len = SIZE_BUF_RECORD - 1;
+        }
+
+        struct iovec iov = {.iov_base = buf, .iov_len = (size_t)len};
+        ssize_t written;
+        do
+        {
+            written = write_vector(fd, &iov, 1, rwf_flags & ~RWF_NOWAIT);
+            (*n_syscalls)++;
+        } while (written == ERR_GENERAL_ERROR && errno == EINTR);
+
+        if (written != len)
+        {
+            log_error("Error writing a record");
+            return ERR_FILE_WRITE;
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES bench_batched(int fd, size_t n_records, size_t flush_bytes, unsigned flush_interval_ms, int rwf_flags, size_t *n_syscalls)
+{
+    batch_writer_t *bw = malloc(sizeof(batch_writer_t)); // 16K of iovecs, not for the stack
+    if (bw == NULL)
+    {
+        log_error("Error allocating the batch writer");
+        return ERR_ALLOC;
+    }
+
+    EXIT_TYPES ret = batch_init(bw, fd, ARENA_SIZE_DEFAULT, flush_bytes, flush_interval_ms, rwf_flags);
+    for (size_t i = 0; i < n_records && ret == SUCCESS; i++)
+    {
+        ret = batch_printf(bw, "record %zu: sensor %zu value %zu\n", i, i % 16, (i * 2654435761u) % 1000);
+    }
+
+    EXIT_TYPES ret_close = batch_close(bw);
+    if (ret == SUCCESS)
+    {
+        ret = ret_close;
+    }
+    *n_syscalls = bw->n_syscalls;
+
+    free(bw);
+    return ret;
+}
+
+size_t parse_size(const char *text)
+{
+    char *end = NULL;
+    size_t value = strtoul(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double now_sec_coarse(void)
+{
+    // Updated once per tick (1 - 10 ms), plenty for a flush interval and a few ns to read
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *path_name, size_t records, size_t syscalls, double seconds)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%zu,%zu,%.4f,%.0f\n", path_name, records, syscalls, seconds,
+                       (seconds > 0) ? (double)records / seconds : 0.0);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
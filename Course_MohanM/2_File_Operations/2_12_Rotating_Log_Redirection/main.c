@@ -0,0 +1,642 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+2_6_Dup2_and_Logging_to_File_Easier sends stdout into newFile.log with dup2(). That's all a long running program
+needs too, except the file only grows, and nobody decides how often stdio goes to the kernel or the kernel to the disk.
+
+log_sink_t keeps the dup2() idea and adds:
+
+- Rotation by size (max_bytes) or by age (max_age). app.log is the file being written, app.log.1 the newest old one,
+  ... app.log.<keep>, older ones are removed. The new file is created as app.log.next, the old one gets its .1 name
+  with link() and then app.log.next is rename()d over app.log: whoever opens app.log finds a complete file at any
+  moment, never nothing. Then dup2() moves fd 1 (and 2) to the new file in one step, printf() keeps working and
+  never notices.
+- O_APPEND: every write() goes to the current end, also for children that inherited fd 1 and write at the same time.
+- The stdio buffer of stdout: 0 (unbuffered, one write() per printf()), or a size (full buffering, one write() per
+  buffer). Same-size log lines and a bigger buffer: fewer syscalls, but more lost if the process dies.
+- fsync policy, how long data may stay in the page cache:
+  FSYNC_NEVER     : up to the kernel (dirty page writeback, ~30 s)
+  FSYNC_ON_ROTATE : a rotated file is complete on disk before it gets its .1 name
+  FSYNC_INTERVAL  : fdatasync() at most every interval_ms (and on rotate). fdatasync() and not fsync(): the size
+                    is flushed with it when it changed, only the times are left for later.
+
+Bytes are counted in log_sink_printf(), which every log line should go through (it's vprintf() + the checks).
+Plain printf() calls still end up in the file, they're just not counted: log_sink_poll() takes the real size with
+fstat() and also does the time checks for a program that went quiet.
+
+log_sink_open() must come before the first output on stdout, and once per process: setvbuf() is only defined
+before any other operation on the stream. stdout keeps the sink's buffering after log_sink_close().
+
+Benchmark: the same lines through every policy x stdio buffer combination, one CSV line each (on the original
+stdout, restored at log_sink_close()). Every combination runs in its own fork()ed child, whose stdout stream
+hasn't been touched yet: the parent writes the header with write() and never uses stdio on stdout.
+
+Usage:
+./main <log_file> [lines] [--max <bytes>] [--age <ms>] [--keep <files>] [--interval <ms>] [--stderr]
+
+Example:
+./main /tmp/app.log 1000000 --max 8M
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE // fdatasync(), CLOCK_MONOTONIC_COARSE
+
+#include <fcntl.h>    // open()
+#include <unistd.h>   // dup(), dup2(), link(), fdatasync()
+#include <sys/stat.h> // fstat(), permission macros
+#include <sys/wait.h> // waitpid()
+#include <stdio.h>    // printf(), rename(), setvbuf()
+#include <stdlib.h>   // strtoul()
+#include <stdarg.h>   // va_list
+#include <string.h>   // strerror(), strcmp()
+#include <errno.h>    // errno
+#include <time.h>     // clock_gettime()
+#include <limits.h>   // PATH_MAX
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES (O_WRONLY | O_CREAT | O_APPEND)
+#define FILE_MODES_NEXT (O_WRONLY | O_CREAT | O_TRUNC | O_APPEND)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+#define SUFFIX_NEXT ".next"
+
+#define OPTION_MAX "--max"
+#define OPTION_AGE "--age"
+#define OPTION_KEEP "--keep"
+#define OPTION_INTERVAL "--interval"
+#define OPTION_STDERR "--stderr"
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256,
+    SIZE_BUF_STDIO_MAX = 1024 * 1024
+};
+
+enum SINK_SETTINGS
+{
+    MAX_BYTES_DEFAULT = 4 * 1024 * 1024,
+    KEEP_FILES_DEFAULT = 5,
+    FSYNC_INTERVAL_MS_DEFAULT = 100,
+    LINES_DEFAULT = 1000000
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_WRITE = -4,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ROTATE = -7, // the old file is still in use, nothing lost
+    ERR_SYNC = -8,
+    ERR_REDIRECT = -9
+
+} EXIT_TYPES;
+
+typedef enum
+{
+    FSYNC_NEVER = 0,
+    FSYNC_ON_ROTATE,
+    FSYNC_INTERVAL,
+    FSYNC_POLICY_COUNT
+
+} FSYNC_POLICY;
+
+typedef struct
+{
+    const char *path; // the live file, the old ones are <path>.1 ... <path>.<keep_files>
+    int fd;           // also on fd 1 (and 2), kept to dup2() / sync / close it on rotation
+    int redirect_stderr;
+    int saved_stdout; // the original fd 1 / fd 2, put back by log_sink_close()
+    int saved_stderr;
+
+    size_t max_bytes;     // 0: no size rotation
+    double max_age;       // seconds, 0: no time rotation
+    unsigned keep_files;
+
+    FSYNC_POLICY fsync_policy;
+    double fsync_interval; // seconds
+
+    size_t bytes;    // in the live file, including what stdio still holds
+    double t_opened; // of the live file
+    double t_synced;
+
+    size_t n_rotations;
+    size_t n_syncs;
+} log_sink_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES log_sink_open(log_sink_t *sink, const char *path, size_t stdio_buf_size, int redirect_stderr);
+EXIT_TYPES log_sink_printf(log_sink_t *sink, const char *format, ...) __attribute__((format(printf, 2, 3)));
+EXIT_TYPES log_sink_poll(log_sink_t *sink);
+EXIT_TYPES log_sink_rotate(log_sink_t *sink);
+EXIT_TYPES log_sink_close(log_sink_t *sink); // flushes, syncs unless FSYNC_NEVER, puts the original fd 1 / 2 back
+
+EXIT_TYPES log_sink_check(log_sink_t *sink);
+EXIT_TYPES log_sink_sync(log_sink_t *sink);
+EXIT_TYPES shift_rotated_files(const char *path, unsigned keep_files);
+void remove_log_files(const char *path, unsigned keep_files);
+
+EXIT_TYPES bench_policy(const char *path, size_t n_lines, const log_sink_t *settings, size_t stdio_buf_size);
+EXIT_TYPES bench_policy_child(const char *path, size_t n_lines, const log_sink_t *settings, size_t stdio_buf_size);
+
+size_t parse_size(const char *text);
+double now_sec(void);
+double now_sec_coarse(void);
+void log_result(const char *policy_name, size_t stdio_buf_size, const log_sink_t *sink, size_t lines, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Globals ------------------ */
+
+// stdout keeps a pointer to its buffer until the next setvbuf(): static, so it's never freed under it
+static char stdio_buffer[SIZE_BUF_STDIO_MAX];
+
+static const char *FSYNC_POLICY_NAMES[FSYNC_POLICY_COUNT] = {"never", "on_rotate", "interval"};
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <log_file> [lines] [%s <bytes>] [%s <ms>] [%s <files>] [%s <ms>] [%s]\n", argv[0], OPTION_MAX,
+                OPTION_AGE, OPTION_KEEP, OPTION_INTERVAL, OPTION_STDERR);
+        return ERR_ARGS;
+    }
+
+    size_t n_lines = LINES_DEFAULT;
+    log_sink_t settings = {
+        .max_bytes = MAX_BYTES_DEFAULT,
+        .keep_files = KEEP_FILES_DEFAULT,
+        .fsync_interval = FSYNC_INTERVAL_MS_DEFAULT / 1000.0,
+    };
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_MAX) == 0 && i + 1 < argc)
+        {
+            settings.max_bytes = parse_size(argv[++i]);
+        }
+        else if (strcmp(argv[i], OPTION_AGE) == 0 && i + 1 < argc)
+        {
+            settings.max_age = strtoul(argv[++i], NULL, 10) / 1000.0;
+        }
+        else if (strcmp(argv[i], OPTION_KEEP) == 0 && i + 1 < argc)
+        {
+            settings.keep_files = (unsigned)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], OPTION_INTERVAL) == 0 && i + 1 < argc)
+        {
+            settings.fsync_interval = strtoul(argv[++i], NULL, 10) / 1000.0;
+        }
+        else if (strcmp(argv[i], OPTION_STDERR) == 0)
+        {
+            settings.redirect_stderr = 1;
+        }
+        else
+        {
+            n_lines = strtoul(argv[i], NULL, 10);
+        }
+    }
+    if (strlen(argv[1]) + sizeof(SUFFIX_NEXT) + 12 > PATH_MAX)
+    {
+        fprintf(stderr, "Log file path too long\n");
+        return ERR_ARGS;
+    }
+
+    // Not printf(): stdout stays untouched, so the children can still setvbuf() it
+    static const char header[] = "policy,stdio_buf,lines,rotations,syncs,seconds,lines_per_s\n";
+    (void)write(FD_STDOUT, header, sizeof(header) - 1);
+
+    const size_t stdio_buf_sizes[] = {0, BUFSIZ, 64 * 1024};
+    EXIT_TYPES ret = SUCCESS;
+    for (int policy = 0; policy < FSYNC_POLICY_COUNT && ret == SUCCESS; policy++)
+    {
+        for (size_t b = 0; b < sizeof(stdio_buf_sizes) / sizeof(stdio_buf_sizes[0]) && ret == SUCCESS; b++)
+        {
+            settings.fsync_policy = (FSYNC_POLICY)policy;
+            ret = bench_policy_child(argv[1], n_lines, &settings, stdio_buf_sizes[b]);
+        }
+    }
+
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES log_sink_open(log_sink_t *sink, const char *path, size_t stdio_buf_size, int redirect_stderr)
+{
+    // Settings (max_bytes, max_age, keep_files, fsync_*) are set by the caller, the rest is ours
+    sink->path = path;
+    sink->redirect_stderr = redirect_stderr;
+    sink->saved_stderr = -1;
+    sink->n_rotations = 0;
+    sink->n_syncs = 0;
+
+    if (stdio_buf_size > SIZE_BUF_STDIO_MAX)
+    {
+        stdio_buf_size = SIZE_BUF_STDIO_MAX;
+    }
+
+    // First thing on stdout, as setvbuf() wants it. Where fd 1 points doesn't matter to the stream.
+    if (stdio_buf_size == 0)
+    {
+        setvbuf(stdout, NULL, _IONBF, 0);
+    }
+    else
+    {
+        setvbuf(stdout, stdio_buffer, _IOFBF, stdio_buf_size);
+    }
+
+    sink->fd = open(path, FILE_MODES, FILE_PERMISSIONS);
+    if (sink->fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the log file");
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(sink->fd, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the log file size");
+        close_file_safer(sink->fd);
+        return ERR_FILE_OPEN;
+    }
+    sink->bytes = (size_t)st.st_size; // appending to what an earlier run left
+    sink->t_opened = sink->t_synced = now_sec_coarse();
+
+    fflush(stdout);
+    fflush(stderr);
+    sink->saved_stdout = dup(FD_STDOUT);
+    if (redirect_stderr)
+    {
+        sink->saved_stderr = dup(FD_STDERR);
+    }
+    if (sink->saved_stdout == ERR_GENERAL_ERROR || dup2(sink->fd, FD_STDOUT) == ERR_GENERAL_ERROR ||
+        (redirect_stderr && (sink->saved_stderr == ERR_GENERAL_ERROR || dup2(sink->fd, FD_STDERR) == ERR_GENERAL_ERROR)))
+    {
+        log_error("Error redirecting to the log file");
+        if (sink->saved_stdout != ERR_GENERAL_ERROR)
+        {
+            dup2(sink->saved_stdout, FD_STDOUT);
+            close_file_safer(sink->saved_stdout);
+        }
+        if (sink->saved_stderr != ERR_GENERAL_ERROR)
+        {
+            dup2(sink->saved_stderr, FD_STDERR);
+            close_file_safer(sink->saved_stderr);
+        }
+        close_file_safer(sink->fd);
+        return ERR_REDIRECT;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES log_sink_printf(log_sink_t *sink, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vprintf(format, args);
+    va_end(args);
+
+    if (len < 0)
+    {
+        return ERR_FILE_WRITE;
+    }
+    sink->bytes += (size_t)len;
+    return log_sink_check(sink);
+}
+
+EXIT_TYPES log_sink_poll(log_sink_t *sink)
+{
+    // Count also what went around log_sink_printf()
+    fflush(stdout);
+    struct stat st;
+    if (fstat(sink->fd, &st) == SUCCESS)
+    {
+        sink->bytes = (size_t)st.st_size;
+    }
+    return log_sink_check(sink);
+}
+
+EXIT_TYPES log_sink_check(log_sink_t *sink)
+{
+    if (sink->max_bytes != 0 && sink->bytes >= sink->max_bytes)
+    {
+        return log_sink_rotate(sink);
+    }
+
+    if (sink->max_age == 0 && sink->fsync_policy != FSYNC_INTERVAL)
+    {
+        return SUCCESS; // nothing time based, skip the clock
+    }
+
+    const double now = now_sec_coarse();
+    if (sink->max_age != 0 && sink->bytes != 0 && now - sink->t_opened >= sink->max_age)
+    {
+        return log_sink_rotate(sink);
+    }
+    if (sink->fsync_policy == FSYNC_INTERVAL && now - sink->t_synced >= sink->fsync_interval)
+    {
+        fflush(stdout);
+        return log_sink_sync(sink);
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES log_sink_sync(log_sink_t *sink)
+{
+    sink->t_synced = now_sec_coarse();
+    if (fdatasync(sink->fd) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error syncing the log file");
+        return ERR_SYNC;
+    }
+    sink->n_syncs++;
+    return SUCCESS;
+}
+
+EXIT_TYPES log_sink_rotate(log_sink_t *sink)
+{
+    char path_next[PATH_MAX];
+    char path_first[PATH_MAX];
+    snprintf(path_next, sizeof(path_next), "%s%s", sink->path, SUFFIX_NEXT);
+    snprintf(path_first, sizeof(path_first), "%s.1", sink->path);
+
+    // Everything stdio holds belongs to the old file
+    fflush(stdout);
+    fflush(stderr);
+    if (sink->fsync_policy != FSYNC_NEVER)
+    {
+        (void)log_sink_sync(sink); // an error here shouldn't stop the rotation
+    }
+
+    // Nothing is renamed before the new file exists: if this fails, we go on in the old one
+    int new_fd = open(path_next, FILE_MODES_NEXT, FILE_PERMISSIONS);
+    if (new_fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error creating the next log file");
+        return ERR_ROTATE;
+    }
+
+    if (shift_rotated_files(sink->path, sink->keep_files) != SUCCESS)
+    {
+        close_file_safer(new_fd);
+        unlink(path_next);
+        return ERR_ROTATE;
+    }
+
+    // Old file: second name first, then the new file takes the live name in one rename()
+    if (sink->keep_files > 0 && link(sink->path, path_first) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error linking the rotated log file");
+        close_file_safer(new_fd);
+        unlink(path_next);
+        return ERR_ROTATE;
+    }
+    if (rename(path_next, sink->path) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error renaming the next log file");
+        if (sink->keep_files > 0)
+        {
+            unlink(path_first);
+        }
+        close_file_safer(new_fd);
+        unlink(path_next);
+        return ERR_ROTATE;
+    }
+
+    // Other threads writing to fd 1 / 2 hit either the old file or the new one, never a closed fd
+    if (dup2(new_fd, FD_STDOUT) == ERR_GENERAL_ERROR ||
+        (sink->redirect_stderr && dup2(new_fd, FD_STDERR) == ERR_GENERAL_ERROR))
+    {
+        log_error("Error redirecting to the next log file"); // the live name is on the new file already: keep it
+    }
+
+    close_file_safer(sink->fd);
+    sink->fd = new_fd;
+    sink->bytes = 0;
+    sink->t_opened = sink->t_synced = now_sec_coarse();
+    sink->n_rotations++;
+    return SUCCESS;
+}
+
+EXIT_TYPES shift_rotated_files(const char *path, unsigned keep_files)
+{
+    char path_from[PATH_MAX];
+    char path_to[PATH_MAX];
+
+    if (keep_files == 0)
+    {
+        return SUCCESS;
+    }
+
+    // The oldest one goes, <path>.k moves to <path>.k+1. rename() replaces the target in one step.
+    snprintf(path_to, sizeof(path_to), "%s.%u", path, keep_files);
+    if (unlink(path_to) == ERR_GENERAL_ERROR && errno != ENOENT)
+    {
+        log_error("Error removing the oldest log file");
+        return ERR_ROTATE;
+    }
+    for (unsigned k = keep_files - 1; k >= 1; k--)
+    {
+        snprintf(path_from, sizeof(path_from), "%s.%u", path, k);
+        snprintf(path_to, sizeof(path_to), "%s.%u", path, k + 1);
+        if (rename(path_from, path_to) == ERR_GENERAL_ERROR && errno != ENOENT)
+        {
+            log_error("Error shifting a rotated log file");
+            return ERR_ROTATE;
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES log_sink_close(log_sink_t *sink)
+{
+    EXIT_TYPES ret = SUCCESS;
+
+    fflush(stdout);
+    fflush(stderr);
+    if (sink->fsync_policy != FSYNC_NEVER)
+    {
+        ret = log_sink_sync(sink);
+    }
+
+    if (dup2(sink->saved_stdout, FD_STDOUT) == ERR_GENERAL_ERROR ||
+        (sink->redirect_stderr && dup2(sink->saved_stderr, FD_STDERR) == ERR_GENERAL_ERROR))
+    {
+        log_error("Error restoring stdout / stderr");
+        ret = ERR_REDIRECT;
+    }
+    close_file_safer(sink->saved_stdout);
+    if (sink->redirect_stderr)
+    {
+        close_file_safer(sink->saved_stderr);
+    }
+
+    // No setvbuf() back to the usual buffering: stdout has been used, stdio_buffer stays its buffer (static)
+
+    if (close_file_safer(sink->fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    return ret;
+}
+
+void remove_log_files(const char *path, unsigned keep_files)
+{
+    char path_old[PATH_MAX];
+
+    unlink(path);
+    for (unsigned k = 1; k <= keep_files; k++)
+    {
+        snprintf(path_old, sizeof(path_old), "%s.%u", path, k);
+        unlink(path_old);
+    }
+}
+
+EXIT_TYPES bench_policy_child(const char *path, size_t n_lines, const log_sink_t *settings, size_t stdio_buf_size)
+{
+    pid_t cpid = fork();
+    switch (cpid)
+    {
+    case -1:
+        log_error("Error forking the benchmark child");
+        return ERR_GENERAL_ERROR;
+
+    case 0:
+        // EXIT_TYPES are <= 0, the exit status carries them negated
+        exit(-bench_policy(path, n_lines, settings, stdio_buf_size));
+    }
+
+    int status = 0;
+    while (waitpid(cpid, &status, 0) == ERR_GENERAL_ERROR)
+    {
+        if (errno != EINTR)
+        {
+            log_error("Error waiting for the benchmark child");
+            return ERR_GENERAL_ERROR;
+        }
+    }
+    return WIFEXITED(status) ? (EXIT_TYPES)-WEXITSTATUS(status) : ERR_GENERAL_ERROR;
+}
+
+EXIT_TYPES bench_policy(const char *path, size_t n_lines, const log_sink_t *settings, size_t stdio_buf_size)
+{
+    log_sink_t sink = *settings;
+    remove_log_files(path, sink.keep_files); // every run starts from nothing
+
+    EXIT_TYPES ret = log_sink_open(&sink, path, stdio_buf_size, settings->redirect_stderr);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    const double t_start = now_sec();
+    for (size_t i = 0; i < n_lines && ret == SUCCESS; i++)
+    {
+        // ~80 bytes, a typical log line
+        ret = log_sink_printf(&sink, "%.6f INFO worker=%zu request=%zu status=200 bytes=%zu path=/api/v1/items\n", now_sec_coarse(),
+                              i & 7, i, (i * 2654435761u) & 0xffff);
+    }
+    if (ret == ERR_ROTATE || ret == ERR_SYNC)
+    {
+        ret = SUCCESS; // reported already, and the lines are in the file anyway
+    }
+
+    EXIT_TYPES ret_close = log_sink_close(&sink);
+    const double seconds = now_sec() - t_start;
+    if (ret == SUCCESS)
+    {
+        ret = ret_close;
+    }
+    if (ret == SUCCESS)
+    {
+        log_result(FSYNC_POLICY_NAMES[sink.fsync_policy], stdio_buf_size, &sink, n_lines, seconds);
+    }
+    return ret;
+}
+
+size_t parse_size(const char *text)
+{
+    char *end = NULL;
+    size_t value = strtoul(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double now_sec_coarse(void)
+{
+    // Updated once per tick (1 - 10 ms), plenty for rotation ages and sync intervals, a few ns to read
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *policy_name, size_t stdio_buf_size, const log_sink_t *sink, size_t lines, double seconds)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%zu,%zu,%zu,%zu,%.4f,%.0f\n", policy_name, stdio_buf_size, lines,
+                       sink->n_rotations, sink->n_syncs, seconds, (seconds > 0) ? (double)lines / seconds : 0.0);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
@@ -0,0 +1,623 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+2_3 and 2_6 open with O_CREAT and grow the file one small write() at a time. Every write() past the end extends
+i_size, and the file system picks blocks for the new data as it comes: with delayed allocation that's at writeback,
+a bit at a time, and with several files growing next to each other their extents interleave.
+
+out_file_t is an output file that knows where it's going:
+
+- fallocate() reserves the blocks up front (the expected size, or prealloc_chunk at a time when the size isn't
+  known), as few and as long extents as the file system can find. The blocks are marked unwritten, reading them
+  gives zeros, and no zeros are written. Mode 0, so i_size covers them too: our writes land inside the file and
+  don't grow it one write at a time.
+- Writes are gathered in a buffer from posix_memalign() and go out as big aligned pwrite()s.
+- O_DIRECT (optional): the buffer goes to the device without a page cache copy, and nothing is left dirty for
+  writeback. Buffer address, length and offset must be multiples of the block size (st_blksize, a multiple of the
+  logical block size). The last, partial block is padded with zeros and written whole.
+  File systems without O_DIRECT (tmpfs, ...) refuse the open() with EINVAL: then it's a normal buffered file.
+  Some accept the open() and refuse the first pwrite() with EINVAL instead: O_DIRECT is cleared with
+  fcntl(F_SETFL) and the same buffer is written again, buffered from there on.
+- out_close() ftruncate()s to the bytes actually written: the padding and the unused preallocation go away.
+
+Without fallocate() support (EOPNOTSUPP) it just writes, posix_fallocate() would write zeros instead, which
+costs as much as the data.
+
+Benchmark: the same records written
+- small_writes : one write() per record, the 2_3 way
+- prealloc     : out_file_t through the page cache
+- direct       : out_file_t with O_DIRECT
+Each followed by fdatasync() (otherwise the buffered ones are only in the page cache when the clock stops),
+with the number of extents of the result (FIEMAP).
+
+Usage:
+./main <file> [size] [record_size] [--chunk <bytes>] [--buffer <bytes>] [--unknown-size]
+Sizes accept K / M / G suffixes. Default 256M, 100 byte records.
+
+Example:
+./main /data/out.bin 1G 100
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE // O_DIRECT, fallocate()
+
+#include <fcntl.h>        // open(), fallocate(), fcntl()
+#include <unistd.h>       // pwrite(), ftruncate(), fdatasync()
+#include <sys/stat.h>     // fstat(), permission macros
+#include <sys/ioctl.h>    // ioctl()
+#include <linux/fs.h>     // FS_IOC_FIEMAP
+#include <linux/fiemap.h> // struct fiemap
+#include <stdio.h>        // snprintf()
+#include <stdlib.h>       // posix_memalign(), strtoull()
+#include <string.h>       // strerror(), strcmp(), memcpy()
+#include <errno.h>        // errno
+#include <time.h>         // clock_gettime()
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES (O_WRONLY | O_CREAT | O_TRUNC)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+#define OPTION_CHUNK "--chunk"
+#define OPTION_BUFFER "--buffer"
+#define OPTION_UNKNOWN_SIZE "--unknown-size"
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256,
+    SIZE_BUF_RECORD_MAX = 64 * 1024
+};
+
+enum OUT_FILE_SETTINGS
+{
+    ALIGNMENT_MIN = 4096, // st_blksize can be smaller on odd file systems, O_DIRECT is happy with more
+    BUFFER_SIZE_DEFAULT = 1024 * 1024,
+    PREALLOC_CHUNK_DEFAULT = 64 * 1024 * 1024,
+    RECORD_SIZE_DEFAULT = 100
+};
+
+static const unsigned long long FILE_SIZE_DEFAULT = 256ULL * 1024 * 1024;
+
+enum OUT_FILE_FLAGS
+{
+    OUT_DIRECT = 1 << 0
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_WRITE = -4,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7,
+    ERR_NO_SPACE = -8 // fallocate() couldn't reserve the blocks, nothing written past them
+
+} EXIT_TYPES;
+
+typedef enum
+{
+    MODE_SMALL_WRITES = 0,
+    MODE_PREALLOC = 1,
+    MODE_DIRECT = 2,
+    MODE_COUNT
+} WRITE_MODES;
+
+typedef struct
+{
+    int fd;
+    int direct;   // O_DIRECT was accepted
+    int prealloc; // fallocate() works here
+
+    size_t align;
+    char *buf; // posix_memalign(align)
+    size_t buf_size;
+    size_t buf_used;
+
+    off_t offset;    // bytes of the file written, a multiple of align until the close
+    off_t allocated; // reserved with fallocate()
+    size_t prealloc_chunk;
+} out_file_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES out_open(out_file_t *of, const char *path, off_t expected_size, size_t prealloc_chunk, size_t buf_size, int flags);
+EXIT_TYPES out_write(out_file_t *of, const void *data, size_t len);
+EXIT_TYPES out_close(out_file_t *of, int sync); // writes the tail, truncates to the real size, closes, frees
+
+EXIT_TYPES out_flush_buffer(out_file_t *of, size_t len);
+EXIT_TYPES out_reserve(out_file_t *of, off_t end);
+
+EXIT_TYPES bench_small_writes(const char *path, unsigned long long size, size_t record_size);
+EXIT_TYPES bench_out_file(const char *path, unsigned long long size, size_t record_size, off_t expected_size, size_t chunk, size_t buf_size, int flags, int *direct);
+void fill_record(char *record, size_t record_size, unsigned long long index);
+long count_extents(const char *path);
+
+EXIT_TYPES pwrite_all(int fd, const char *buf, size_t len, off_t offset);
+unsigned long long parse_size(const char *text);
+double now_sec(void);
+void log_result(const char *mode, unsigned long long bytes, size_t record_size, double seconds, long extents);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Globals ------------------ */
+
+static const char *MODE_NAMES[MODE_COUNT] = {"small_writes", "prealloc", "direct"};
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <file> [size] [record_size] [%s <bytes>] [%s <bytes>] [%s]\n", argv[0], OPTION_CHUNK, OPTION_BUFFER, OPTION_UNKNOWN_SIZE);
+        return ERR_ARGS;
+    }
+
+    unsigned long long size = FILE_SIZE_DEFAULT;
+    size_t record_size = RECORD_SIZE_DEFAULT;
+    size_t chunk = PREALLOC_CHUNK_DEFAULT;
+    size_t buf_size = BUFFER_SIZE_DEFAULT;
+    int unknown_size = 0;
+    int n_positional = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_CHUNK) == 0 && i + 1 < argc)
+        {
+            chunk = (size_t)parse_size(argv[++i]);
+        }
+        else if (strcmp(argv[i], OPTION_BUFFER) == 0 && i + 1 < argc)
+        {
+            buf_size = (size_t)parse_size(argv[++i]);
+        }
+        else if (strcmp(argv[i], OPTION_UNKNOWN_SIZE) == 0)
+        {
+            unknown_size = 1;
+        }
+        else if (n_positional++ == 0)
+        {
+            size = parse_size(argv[i]);
+        }
+        else
+        {
+            record_size = (size_t)parse_size(argv[i]);
+        }
+    }
+    if (record_size == 0 || record_size > SIZE_BUF_RECORD_MAX)
+    {
+        fprintf(stderr, "Record size must be between 1 and %d bytes\n", SIZE_BUF_RECORD_MAX);
+        return ERR_ARGS;
+    }
+    if (buf_size < ALIGNMENT_MIN || buf_size % ALIGNMENT_MIN != 0 || chunk < buf_size)
+    {
+        fprintf(stderr, "Buffer size must be a multiple of %d bytes, and the chunk at least one buffer\n", ALIGNMENT_MIN);
+        return ERR_ARGS;
+    }
+
+    printf("mode,bytes,record_size,seconds,mb_per_s,extents\n");
+    fflush(stdout); // log_result() writes to the fd directly
+
+    EXIT_TYPES ret = SUCCESS;
+    for (int mode = 0; mode < MODE_COUNT && ret == SUCCESS; mode++)
+    {
+        unlink(argv[1]); // every run allocates from scratch
+        int direct = 0;
+
+        const double t_start = now_sec();
+        if (mode == MODE_SMALL_WRITES)
+        {
+            ret = bench_small_writes(argv[1], size, record_size);
+        }
+        else
+        {
+            ret = bench_out_file(argv[1], size, record_size, unknown_size ? 0 : (off_t)size, chunk, buf_size,
+                                 (mode == MODE_DIRECT) ? OUT_DIRECT : 0, &direct);
+        }
+        const double seconds = now_sec() - t_start;
+
+        if (ret == SUCCESS)
+        {
+            log_result((mode == MODE_DIRECT && !direct) ? "direct(unsupported->prealloc)" : MODE_NAMES[mode], size, record_size,
+                       seconds, count_extents(argv[1]));
+        }
+    }
+
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES out_open(out_file_t *of, const char *path, off_t expected_size, size_t prealloc_chunk, size_t buf_size, int flags)
+{
+    memset(of, 0, sizeof(*of));
+    of->prealloc_chunk = prealloc_chunk;
+    of->prealloc = 1;
+
+    of->fd = ERR_GENERAL_ERROR;
+    if (flags & OUT_DIRECT)
+    {
+        of->fd = open(path, FILE_MODES | O_DIRECT, FILE_PERMISSIONS);
+        of->direct = (of->fd != ERR_GENERAL_ERROR);
+        if (of->fd == ERR_GENERAL_ERROR && errno != EINVAL)
+        {
+            log_error("Error opening the output file");
+            return ERR_FILE_OPEN;
+        }
+    }
+    if (of->fd == ERR_GENERAL_ERROR)
+    {
+        of->fd = open(path, FILE_MODES, FILE_PERMISSIONS);
+        if (of->fd == ERR_GENERAL_ERROR)
+        {
+            log_error("Error opening the output file");
+            return ERR_FILE_OPEN;
+        }
+    }
+
+    struct stat st;
+    of->align = ALIGNMENT_MIN;
+    if (fstat(of->fd, &st) == SUCCESS && (size_t)st.st_blksize > of->align)
+    {
+        of->align = (size_t)st.st_blksize;
+    }
+    of->buf_size = (buf_size + of->align - 1) / of->align * of->align;
+    if (posix_memalign((void **)&of->buf, of->align, of->buf_size) != 0)
+    {
+        fprintf(stderr, "Error allocating the write buffer\n");
+        close_file_safer(of->fd);
+        return ERR_ALLOC;
+    }
+
+    if (expected_size > 0)
+    {
+        EXIT_TYPES ret = out_reserve(of, expected_size);
+        if (ret != SUCCESS)
+        {
+            free(of->buf);
+            close_file_safer(of->fd);
+            return ret;
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES out_reserve(out_file_t *of, off_t end)
+{
+    if (!of->prealloc || end <= of->allocated)
+    {
+        return SUCCESS;
+    }
+
+    // Unknown final size: a chunk at a time, so the extents still come in big pieces
+    off_t new_allocated = end;
+    if (new_allocated < of->allocated + (off_t)of->prealloc_chunk)
+    {
+        new_allocated = of->allocated + (off_t)of->prealloc_chunk;
+    }
+
+    if (fallocate(of->fd, 0, of->allocated, new_allocated - of->allocated) == ERR_GENERAL_ERROR)
+    {
+        if (errno == EOPNOTSUPP)
+        {
+            of->prealloc = 0; // plain writes from now on
+            return SUCCESS;
+        }
+        log_error("Error preallocating the output file");
+        return ERR_NO_SPACE;
+    }
+    of->allocated = new_allocated;
+    return SUCCESS;
+}
+
+EXIT_TYPES out_write(out_file_t *of, const void *data, size_t len)
+{
+    const char *src = data;
+    while (len > 0)
+    {
+        size_t n = of->buf_size - of->buf_used;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(of->buf + of->buf_used, src, n);
+        of->buf_used += n;
+        src += n;
+        len -= n;
+
+        if (of->buf_used == of->buf_size)
+        {
+            EXIT_TYPES ret = out_flush_buffer(of, of->buf_size);
+            if (ret != SUCCESS)
+            {
+                return ret;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES out_flush_buffer(out_file_t *of, size_t len)
+{
+    EXIT_TYPES ret = out_reserve(of, of->offset + (off_t)len);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    // Some file systems take the O_DIRECT open() and only refuse the write (EINVAL):
+    // clear O_DIRECT on the fd and write this buffer and the rest through the page cache
+    size_t done = 0;
+    if (of->direct)
+    {
+        ssize_t bytes_written;
+        do
+        {
+            bytes_written = pwrite(of->fd, of->buf, len, of->offset);
+        } while (bytes_written == ERR_GENERAL_ERROR && errno == EINTR);
+
+        if (bytes_written == ERR_GENERAL_ERROR && errno == EINVAL)
+        {
+            int fd_flags = fcntl(of->fd, F_GETFL);
+            if (fd_flags == ERR_GENERAL_ERROR || fcntl(of->fd, F_SETFL, fd_flags & ~O_DIRECT) == ERR_GENERAL_ERROR)
+            {
+                log_error("Error clearing O_DIRECT on the output file");
+                return ERR_FILE_WRITE;
+            }
+            of->direct = 0;
+        }
+        else if (bytes_written == ERR_GENERAL_ERROR)
+        {
+            log_error("Error writing to the output file");
+            return ERR_FILE_WRITE;
+        }
+        else
+        {
+            done = (size_t)bytes_written;
+        }
+    }
+
+    ret = pwrite_all(of->fd, of->buf + done, len - done, of->offset + (off_t)done);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    of->offset += (off_t)len;
+    of->buf_used = 0;
+    return SUCCESS;
+}
+
+EXIT_TYPES out_close(out_file_t *of, int sync)
+{
+    EXIT_TYPES ret = SUCCESS;
+    const off_t real_size = of->offset + (off_t)of->buf_used;
+
+    if (of->buf_used > 0)
+    {
+        // O_DIRECT writes whole blocks only: pad the tail, the truncate below cuts the padding off
+        size_t len = of->buf_used;
+        if (of->direct)
+        {
+            len = (len + of->align - 1) / of->align * of->align;
+            memset(of->buf + of->buf_used, 0, len - of->buf_used);
+        }
+        ret = out_flush_buffer(of, len);
+    }
+
+    // Drops the padding and whatever was preallocated but not used
+    if (ftruncate(of->fd, real_size) == ERR_GENERAL_ERROR && ret == SUCCESS)
+    {
+        log_error("Error truncating the output file");
+        ret = ERR_FILE_WRITE;
+    }
+
+    // With O_DIRECT the data is on the device already, but the extent conversion and i_size are still metadata
+    if (sync && fdatasync(of->fd) == ERR_GENERAL_ERROR && ret == SUCCESS)
+    {
+        log_error("Error syncing the output file");
+        ret = ERR_FILE_WRITE;
+    }
+
+    if (close_file_safer(of->fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    free(of->buf);
+    of->buf = NULL;
+    return ret;
+}
+
+EXIT_TYPES bench_small_writes(const char *path, unsigned long long size, size_t record_size)
+{
+    int fd = open(path, FILE_MODES, FILE_PERMISSIONS);
+    if (fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the output file");
+        return ERR_FILE_OPEN;
+    }
+
+    char record[SIZE_BUF_RECORD_MAX];
+    EXIT_TYPES ret = SUCCESS;
+    for (unsigned long long done = 0, index = 0; done < size && ret == SUCCESS; done += record_size, index++)
+    {
+        const size_t len = (size - done < record_size) ? (size_t)(size - done) : record_size;
+        fill_record(record, len, index);
+        ssize_t written = write(fd, record, len);
+        if (written != (ssize_t)len)
+        {
+            log_error("Error writing to the output file");
+            ret = ERR_FILE_WRITE;
+        }
+    }
+
+    if (ret == SUCCESS && fdatasync(fd) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error syncing the output file");
+        ret = ERR_FILE_WRITE;
+    }
+    if (close_file_safer(fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    return ret;
+}
+
+EXIT_TYPES bench_out_file(const char *path, unsigned long long size, size_t record_size, off_t expected_size, size_t chunk, size_t buf_size, int flags, int *direct)
+{
+    out_file_t of;
+    EXIT_TYPES ret = out_open(&of, path, expected_size, chunk, buf_size, flags);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    char record[SIZE_BUF_RECORD_MAX];
+    for (unsigned long long done = 0, index = 0; done < size && ret == SUCCESS; done += record_size, index++)
+    {
+        const size_t len = (size - done < record_size) ? (size_t)(size - done) : record_size;
+        fill_record(record, len, index);
+        ret = out_write(&of, record, len);
+    }
+
+    EXIT_TYPES ret_close = out_close(&of, 1);
+    *direct = of.direct; // cleared when a write fell back to buffered
+    return (ret != SUCCESS) ? ret : ret_close;
+}
+
+void fill_record(char *record, size_t record_size, unsigned long long index)
+{
+    // Cheap, but not all the same bytes: a line number and a pattern
+    int len = snprintf(record, record_size, "%llu ", index);
+    size_t pos = (len > 0 && (size_t)len < record_size) ? (size_t)len : 0;
+    for (; pos < record_size; pos++)
+    {
+        record[pos] = (char)('a' + (pos + index) % 26);
+    }
+    record[record_size - 1] = '\n';
+}
+
+long count_extents(const char *path)
+{
+    // fm_extent_count = 0: the kernel only counts them
+    int fd = open(path, O_RDONLY);
+    if (fd == ERR_GENERAL_ERROR)
+    {
+        return -1;
+    }
+
+    struct fiemap fm;
+    memset(&fm, 0, sizeof(fm));
+    fm.fm_start = 0;
+    fm.fm_length = FIEMAP_MAX_OFFSET;
+    fm.fm_flags = FIEMAP_FLAG_SYNC;
+    fm.fm_extent_count = 0;
+
+    long extents = -1; // FIEMAP not supported
+    if (ioctl(fd, FS_IOC_FIEMAP, &fm) == SUCCESS)
+    {
+        extents = (long)fm.fm_mapped_extents;
+    }
+    close_file_safer(fd);
+    return extents;
+}
+
+EXIT_TYPES pwrite_all(int fd, const char *buf, size_t len, off_t offset)
+{
+    // A short O_DIRECT write would leave the rest unaligned: only seen with a full disk, report it as an error then
+    size_t total_written = 0;
+    while (total_written < len)
+    {
+        ssize_t bytes_written = pwrite(fd, buf + total_written, len - total_written, offset + (off_t)total_written);
+        if (bytes_written == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error writing to the output file");
+            return ERR_FILE_WRITE;
+        }
+        if (bytes_written == 0)
+        {
+            return ERR_FILE_WRITE;
+        }
+        total_written += (size_t)bytes_written;
+    }
+    return SUCCESS;
+}
+
+unsigned long long parse_size(const char *text)
+{
+    char *end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    else if (end != NULL && (*end == 'G' || *end == 'g'))
+    {
+        value *= 1024ULL * 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *mode, unsigned long long bytes, size_t record_size, double seconds, long extents)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%llu,%zu,%.4f,%.1f,%ld\n", mode, bytes, record_size, seconds,
+                       (seconds > 0) ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0, extents);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
@@ -0,0 +1,1037 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+The file examples up to here treat a file as bytes and find things with lseek(). 11_4 / 11_5 frame FIFO messages
+with a uint32_t msg_len in front. rec_file_t does the same framing in a file, plus an index so record i can be
+found without reading the i - 1 before it.
+
+Data file <path>, append only:
+  file header : magic, version                                      8 bytes
+  record      : uint32_t len, uint32_t checksum (FNV-1a of payload), payload[len]
+The checksum is how a torn record (crash in the middle of a write) is told apart from a complete one,
+the length alone can't do that.
+
+Index file <path>.idx, mmap()ed MAP_SHARED:
+  header  : magic, version, count, data_end (where the indexed records stop)
+  offsets : uint64_t offsets[count], offsets[i] = start of record i in the data file
+The size of record i is offsets[i + 1] - offsets[i] (data_end for the last one), so a read is one preadv() of
+header + payload, or a pointer into a read only mapping of the data file. The index file grows by doubling,
+ftruncate() + mremap().
+
+Append: the record goes to the data file first, then the index entry, then count. Both are native endian.
+After a crash the index may be behind the data (data written, count not updated yet), or, without rec_sync(),
+anything, since the kernel writes dirty pages back in no particular order. rec_open() therefore checks:
+- index header sane, and the last indexed record ends at data_end, has the length the index says, a matching checksum
+  -> the index is kept, only the records after data_end are scanned in (catch up)
+- otherwise -> the whole index is rebuilt from a scan of the data file
+A scan stops at the first record that is cut off or fails its checksum. Everything from there on is a torn write,
+and the data file is truncated there, so the next append doesn't land behind garbage.
+Only the last indexed record is checked: open stays O(1) and a bad entry in the middle is not noticed there.
+rec_read() / rec_ptr() check every entry they use against its neighbour, data_end and the record's own length,
+and report ERR_CORRUPT / NULL instead of reading somewhere else. Delete <path>.idx to force a rebuild.
+
+rec_sync(): fdatasync() of the data, then msync() of the index. In this order the index is never ahead of the data
+on disk. One writer at a time, readers in the same process.
+
+Benchmark:
+- append        : records of random size (16 - 512 bytes)
+- open_catch_up : after a simulated crash, index LAG_RECORDS behind and a torn record at the end of the data
+- read_pread    : random records, one preadv() each
+- read_mmap     : random records through the data mapping
+- read_scan     : without the index, walking the length prefixes from the start (lseek + read), SCAN_READS only
+- rebuild       : open without an index file
+
+Usage:
+./main <file> [records] [reads] [--verify]
+
+Example:
+./main /tmp/records.bin 1000000 1000000
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE // mremap()
+
+#include <fcntl.h>    // open()
+#include <unistd.h>   // pread(), ftruncate(), fdatasync(), lseek()
+#include <sys/uio.h>  // preadv(), pwritev()
+#include <sys/mman.h> // mmap(), mremap(), msync()
+#include <sys/stat.h> // fstat(), permission macros
+#include <stdio.h>    // snprintf()
+#include <stdlib.h>   // malloc(), strtoul()
+#include <stdint.h>   // uint32_t, uint64_t
+#include <string.h>   // strerror(), strcmp(), memcpy()
+#include <errno.h>    // errno
+#include <time.h>     // clock_gettime()
+#include <limits.h>   // PATH_MAX
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES (O_RDWR | O_CREAT)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+#define SUFFIX_INDEX ".idx"
+#define OPTION_VERIFY "--verify"
+
+#define DATA_MAGIC 0x46434552u  // "RECF"
+#define INDEX_MAGIC 0x58444952u // "RIDX"
+#define FORMAT_VERSION 1u
+
+#define FNV32_OFFSET_BASIS 0x811c9dc5u
+#define FNV32_PRIME 0x01000193u
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256,
+    SIZE_BUF_RECORD = 64 * 1024 // benchmark read buffer
+};
+
+enum RECORD_SETTINGS
+{
+    RECORD_SIZE_MAX = 64 * 1024 * 1024, // a longer length prefix is taken as garbage
+    INDEX_CAPACITY_MIN = 1024,
+    RECORDS_DEFAULT = 1000000,
+    READS_DEFAULT = 1000000,
+    BENCH_RECORD_MIN = 16,
+    BENCH_RECORD_MAX = 512,
+    LAG_RECORDS = 1000,
+    TORN_PAYLOAD = 100, // the simulated torn record claims this much, TORN_PAYLOAD / 3 made it to the disk
+    SCAN_READS = 10
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_READ = -3,
+    ERR_FILE_WRITE = -4,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7,
+    ERR_NOT_FOUND = -8,
+    ERR_BUFFER_SMALL = -9,
+    ERR_CORRUPT = -10 // not our file, or a record that doesn't match its index entry / checksum
+
+} EXIT_TYPES;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+} data_header_t;
+
+typedef struct
+{
+    uint32_t len;
+    uint32_t checksum;
+} record_header_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+    uint64_t data_end;
+    uint64_t offsets[]; // count used, the file is sized for more
+} index_t;
+
+typedef struct
+{
+    int fd_data;
+    int fd_index;
+    int verify; // checksum every read, not only at open
+
+    index_t *index; // MAP_SHARED over <path>.idx
+    size_t index_capacity;
+
+    uint64_t data_end;
+
+    const char *map; // read only view of the data for rec_ptr(), remapped when the data outgrew it
+    size_t map_size;
+
+    // What rec_open() found
+    int rebuilt;
+    uint64_t recovered;
+    uint64_t truncated_bytes;
+} rec_file_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES rec_open(rec_file_t *rf, const char *path, int verify);
+EXIT_TYPES rec_append(rec_file_t *rf, const void *payload, uint32_t len);
+EXIT_TYPES rec_read(rec_file_t *rf, uint64_t i, void *buf, size_t capacity, uint32_t *len);
+const void *rec_ptr(rec_file_t *rf, uint64_t i, uint32_t *len); // valid until the next rec_append() / rec_close()
+uint64_t rec_count(const rec_file_t *rf);
+EXIT_TYPES rec_sync(rec_file_t *rf);
+EXIT_TYPES rec_close(rec_file_t *rf);
+
+EXIT_TYPES index_map(rec_file_t *rf, size_t capacity);
+EXIT_TYPES index_reserve(rec_file_t *rf, uint64_t count);
+int index_is_valid(rec_file_t *rf, uint64_t data_size);
+EXIT_TYPES index_scan(rec_file_t *rf, uint64_t from, uint64_t data_size);
+EXIT_TYPES data_map(rec_file_t *rf, uint64_t size);
+uint32_t checksum32(const void *data, size_t len);
+
+EXIT_TYPES bench_append(rec_file_t *rf, uint64_t n_records);
+EXIT_TYPES simulate_crash(const char *path, const char *path_index);
+EXIT_TYPES bench_read(rec_file_t *rf, uint64_t n_reads, int use_mmap);
+EXIT_TYPES bench_scan(const char *path, uint64_t n_records, uint64_t n_reads);
+uint64_t bench_payload_len(uint64_t i);
+uint64_t xorshift64(uint64_t *state);
+
+EXIT_TYPES pwrite_all(int fd, const char *buf, size_t len, off_t offset);
+EXIT_TYPES pread_all(int fd, char *buf, size_t len, off_t offset);
+double now_sec(void);
+void log_result(const char *phase, uint64_t records, uint64_t ops, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <file> [records] [reads] [%s]\n", argv[0], OPTION_VERIFY);
+        return ERR_ARGS;
+    }
+
+    uint64_t n_records = RECORDS_DEFAULT;
+    uint64_t n_reads = READS_DEFAULT;
+    int verify = 0;
+    int n_positional = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_VERIFY) == 0)
+        {
+            verify = 1;
+        }
+        else if (n_positional++ == 0)
+        {
+            n_records = strtoull(argv[i], NULL, 10);
+        }
+        else
+        {
+            n_reads = strtoull(argv[i], NULL, 10);
+        }
+    }
+    if (n_records <= LAG_RECORDS)
+    {
+        fprintf(stderr, "Need more than %d records\n", LAG_RECORDS);
+        return ERR_ARGS;
+    }
+
+    char path_index[PATH_MAX];
+    if (snprintf(path_index, sizeof(path_index), "%s%s", argv[1], SUFFIX_INDEX) >= (int)sizeof(path_index))
+    {
+        fprintf(stderr, "Path too long\n");
+        return ERR_ARGS;
+    }
+    unlink(argv[1]);
+    unlink(path_index);
+
+    printf("phase,records,ops,seconds,ns_per_op\n");
+    fflush(stdout); // log_result() writes to the fd directly
+
+    rec_file_t rf;
+    EXIT_TYPES ret = rec_open(&rf, argv[1], verify);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    double t_start = now_sec();
+    ret = bench_append(&rf, n_records);
+    if (ret == SUCCESS)
+    {
+        ret = rec_sync(&rf);
+    }
+    log_result("append", n_records, n_records, now_sec() - t_start);
+    if (rec_close(&rf) != SUCCESS || ret != SUCCESS)
+    {
+        return (ret != SUCCESS) ? ret : ERR_FILE_CLOSE;
+    }
+
+    // Crash: the index didn't get the last LAG_RECORDS, and a record was cut off half way
+    ret = simulate_crash(argv[1], path_index);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    t_start = now_sec();
+    ret = rec_open(&rf, argv[1], verify);
+    const double t_catch_up = now_sec() - t_start;
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    if (rec_count(&rf) != n_records || rf.rebuilt || rf.recovered != LAG_RECORDS ||
+        rf.truncated_bytes != sizeof(record_header_t) + TORN_PAYLOAD / 3)
+    {
+        fprintf(stderr, "Recovery mismatch: %llu records (%llu expected), %llu recovered, %llu bytes truncated, rebuilt %d\n",
+                (unsigned long long)rec_count(&rf), (unsigned long long)n_records, (unsigned long long)rf.recovered,
+                (unsigned long long)rf.truncated_bytes, rf.rebuilt);
+        rec_close(&rf);
+        return ERR_CORRUPT;
+    }
+    log_result("open_catch_up", n_records, LAG_RECORDS, t_catch_up);
+
+    for (int use_mmap = 0; use_mmap <= 1 && ret == SUCCESS; use_mmap++)
+    {
+        t_start = now_sec();
+        ret = bench_read(&rf, n_reads, use_mmap);
+        if (ret == SUCCESS)
+        {
+            log_result(use_mmap ? "read_mmap" : "read_pread", n_records, n_reads, now_sec() - t_start);
+        }
+    }
+    if (rec_close(&rf) != SUCCESS || ret != SUCCESS)
+    {
+        return (ret != SUCCESS) ? ret : ERR_FILE_CLOSE;
+    }
+
+    t_start = now_sec();
+    ret = bench_scan(argv[1], n_records, SCAN_READS);
+    if (ret == SUCCESS)
+    {
+        log_result("read_scan", n_records, SCAN_READS, now_sec() - t_start);
+    }
+
+    // No index at all: full rebuild
+    unlink(path_index);
+    t_start = now_sec();
+    ret = rec_open(&rf, argv[1], verify);
+    const double t_rebuild = now_sec() - t_start;
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    if (rec_count(&rf) != n_records || !rf.rebuilt)
+    {
+        fprintf(stderr, "Rebuild mismatch: %llu records, %llu expected\n", (unsigned long long)rec_count(&rf), (unsigned long long)n_records);
+        ret = ERR_CORRUPT;
+    }
+    else
+    {
+        log_result("rebuild", n_records, n_records, t_rebuild);
+    }
+    if (rec_close(&rf) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES rec_open(rec_file_t *rf, const char *path, int verify)
+{
+    char path_index[PATH_MAX];
+    memset(rf, 0, sizeof(*rf));
+    rf->verify = verify;
+    rf->fd_index = ERR_GENERAL_ERROR;
+
+    if (snprintf(path_index, sizeof(path_index), "%s%s", path, SUFFIX_INDEX) >= (int)sizeof(path_index))
+    {
+        errno = ENAMETOOLONG;
+        log_error("Error opening the index file");
+        return ERR_FILE_OPEN;
+    }
+
+    rf->fd_data = open(path, FILE_MODES, FILE_PERMISSIONS);
+    if (rf->fd_data == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the data file");
+        return ERR_FILE_OPEN;
+    }
+
+    EXIT_TYPES ret = SUCCESS;
+    struct stat st;
+    if (fstat(rf->fd_data, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the data file size");
+        ret = ERR_FILE_READ;
+        goto fail;
+    }
+
+    // New file: write the header. Existing file: check it.
+    data_header_t header = {.magic = DATA_MAGIC, .version = FORMAT_VERSION};
+    if (st.st_size == 0)
+    {
+        ret = pwrite_all(rf->fd_data, (const char *)&header, sizeof(header), 0);
+        st.st_size = sizeof(header);
+    }
+    else if (st.st_size < (off_t)sizeof(header) || pread_all(rf->fd_data, (char *)&header, sizeof(header), 0) != SUCCESS ||
+             header.magic != DATA_MAGIC || header.version != FORMAT_VERSION)
+    {
+        fprintf(stderr, "%s is not a record file\n", path);
+        ret = ERR_CORRUPT;
+    }
+    if (ret != SUCCESS)
+    {
+        goto fail;
+    }
+    const uint64_t data_size = (uint64_t)st.st_size;
+
+    rf->fd_index = open(path_index, FILE_MODES, FILE_PERMISSIONS);
+    if (rf->fd_index == ERR_GENERAL_ERROR || fstat(rf->fd_index, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the index file");
+        ret = ERR_FILE_OPEN;
+        goto fail;
+    }
+
+    // Map whatever is there, the header decides if we keep it
+    size_t capacity = INDEX_CAPACITY_MIN;
+    if ((size_t)st.st_size > sizeof(index_t) + capacity * sizeof(uint64_t))
+    {
+        capacity = ((size_t)st.st_size - sizeof(index_t)) / sizeof(uint64_t);
+    }
+    ret = index_map(rf, capacity);
+    if (ret != SUCCESS)
+    {
+        goto fail;
+    }
+
+    uint64_t scan_from = rf->index->data_end;
+    if (!index_is_valid(rf, data_size))
+    {
+        rf->rebuilt = 1;
+        rf->index->magic = INDEX_MAGIC;
+        rf->index->version = FORMAT_VERSION;
+        rf->index->count = 0;
+        rf->index->data_end = sizeof(data_header_t);
+        scan_from = sizeof(data_header_t);
+    }
+    rf->data_end = rf->index->data_end;
+
+    const uint64_t count_before = rf->index->count;
+    ret = index_scan(rf, scan_from, data_size);
+    if (ret != SUCCESS)
+    {
+        goto fail;
+    }
+    rf->recovered = rf->rebuilt ? 0 : rf->index->count - count_before;
+    return SUCCESS;
+
+fail:
+    rec_close(rf);
+    return ret;
+}
+
+int index_is_valid(rec_file_t *rf, uint64_t data_size)
+{
+    const index_t *index = rf->index;
+    if (index->magic != INDEX_MAGIC || index->version != FORMAT_VERSION || index->count > rf->index_capacity ||
+        index->data_end < sizeof(data_header_t) || index->data_end > data_size)
+    {
+        return 0;
+    }
+    if (index->count == 0)
+    {
+        return index->data_end == sizeof(data_header_t);
+    }
+
+    // The last indexed record must be there, whole, and end at data_end
+    const uint64_t start = index->offsets[index->count - 1];
+    record_header_t header;
+    if (start < sizeof(data_header_t) || start + sizeof(header) > index->data_end ||
+        pread_all(rf->fd_data, (char *)&header, sizeof(header), (off_t)start) != SUCCESS ||
+        start + sizeof(header) + header.len != index->data_end || header.len > RECORD_SIZE_MAX)
+    {
+        return 0;
+    }
+
+    char *payload = malloc(header.len ? header.len : 1);
+    int valid = payload != NULL && pread_all(rf->fd_data, payload, header.len, (off_t)(start + sizeof(header))) == SUCCESS &&
+                checksum32(payload, header.len) == header.checksum;
+    free(payload);
+    return valid;
+}
+
+EXIT_TYPES index_scan(rec_file_t *rf, uint64_t from, uint64_t data_size)
+{
+    if (from >= data_size)
+    {
+        return SUCCESS;
+    }
+
+    // One read only mapping of the data, walked record by record
+    EXIT_TYPES ret = data_map(rf, data_size);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    uint64_t pos = from;
+    while (pos + sizeof(record_header_t) <= data_size)
+    {
+        record_header_t header;
+        memcpy(&header, rf->map + pos, sizeof(header)); // records aren't aligned
+        if (header.len > RECORD_SIZE_MAX || pos + sizeof(header) + header.len > data_size ||
+            checksum32(rf->map + pos + sizeof(header), header.len) != header.checksum)
+        {
+            break;
+        }
+
+        ret = index_reserve(rf, rf->index->count + 1);
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+        rf->index->offsets[rf->index->count] = pos;
+        pos += sizeof(header) + header.len;
+        rf->index->count++;
+    }
+    rf->index->data_end = rf->data_end = pos;
+
+    // Whatever follows is a torn write: cut it off, appends go right after the last good record
+    if (pos < data_size)
+    {
+        if (ftruncate(rf->fd_data, (off_t)pos) == ERR_GENERAL_ERROR)
+        {
+            log_error("Error truncating the torn record");
+            return ERR_FILE_WRITE;
+        }
+        rf->truncated_bytes = data_size - pos;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES index_map(rec_file_t *rf, size_t capacity)
+{
+    const size_t size = sizeof(index_t) + capacity * sizeof(uint64_t);
+
+    struct stat st;
+    if (fstat(rf->fd_index, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the index file size");
+        return ERR_FILE_READ;
+    }
+    if ((size_t)st.st_size < size && ftruncate(rf->fd_index, (off_t)size) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error growing the index file");
+        return ERR_FILE_WRITE;
+    }
+
+    void *map;
+    if (rf->index == NULL)
+    {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, rf->fd_index, 0);
+    }
+    else
+    {
+        map = mremap(rf->index, sizeof(index_t) + rf->index_capacity * sizeof(uint64_t), size, MREMAP_MAYMOVE);
+    }
+    if (map == MAP_FAILED)
+    {
+        log_error("Error mapping the index file");
+        return ERR_ALLOC;
+    }
+    rf->index = map;
+    rf->index_capacity = capacity;
+    return SUCCESS;
+}
+
+EXIT_TYPES index_reserve(rec_file_t *rf, uint64_t count)
+{
+    if (count <= rf->index_capacity)
+    {
+        return SUCCESS;
+    }
+    size_t capacity = rf->index_capacity * 2;
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+    return index_map(rf, capacity);
+}
+
+EXIT_TYPES data_map(rec_file_t *rf, uint64_t size)
+{
+    if (rf->map != NULL && rf->map_size >= size)
+    {
+        return SUCCESS;
+    }
+    if (rf->map != NULL)
+    {
+        munmap((void *)rf->map, rf->map_size);
+        rf->map = NULL;
+        rf->map_size = 0;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, rf->fd_data, 0);
+    if (map == MAP_FAILED)
+    {
+        log_error("Error mapping the data file");
+        return ERR_ALLOC;
+    }
+    madvise(map, size, MADV_RANDOM); // lookups jump around, read ahead would be wasted
+    rf->map = map;
+    rf->map_size = size;
+    return SUCCESS;
+}
+
+EXIT_TYPES rec_append(rec_file_t *rf, const void *payload, uint32_t len)
+{
+    if (len > RECORD_SIZE_MAX)
+    {
+        return ERR_ARGS;
+    }
+    EXIT_TYPES ret = index_reserve(rf, rf->index->count + 1);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    // Data first, in one syscall
+    record_header_t header = {.len = len, .checksum = checksum32(payload, len)};
+    struct iovec iov[2] = {{.iov_base = &header, .iov_len = sizeof(header)}, {.iov_base = (void *)payload, .iov_len = len}};
+    const size_t total = sizeof(header) + len;
+    ssize_t written = pwritev(rf->fd_data, iov, 2, (off_t)rf->data_end);
+    if (written == ERR_GENERAL_ERROR)
+    {
+        log_error("Error appending the record");
+        return ERR_FILE_WRITE;
+    }
+    if ((size_t)written < total)
+    {
+        // Short write: the rest, from whichever part it stopped in
+        const size_t done = (size_t)written;
+        if (done < sizeof(header))
+        {
+            ret = pwrite_all(rf->fd_data, (const char *)&header + done, sizeof(header) - done, (off_t)(rf->data_end + done));
+        }
+        if (ret == SUCCESS)
+        {
+            const size_t payload_done = (done > sizeof(header)) ? done - sizeof(header) : 0;
+            ret = pwrite_all(rf->fd_data, (const char *)payload + payload_done, len - payload_done,
+                             (off_t)(rf->data_end + sizeof(header) + payload_done));
+        }
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+    }
+
+    // Then the entry, then the count that makes it visible
+    rf->index->offsets[rf->index->count] = rf->data_end;
+    rf->data_end += total;
+    rf->index->data_end = rf->data_end;
+    rf->index->count++;
+    return SUCCESS;
+}
+
+EXIT_TYPES rec_read(rec_file_t *rf, uint64_t i, void *buf, size_t capacity, uint32_t *len)
+{
+    const index_t *index = rf->index;
+    if (i >= index->count)
+    {
+        return ERR_NOT_FOUND;
+    }
+    const uint64_t start = index->offsets[i];
+    const uint64_t end = (i + 1 < index->count) ? index->offsets[i + 1] : index->data_end;
+    if (start < sizeof(data_header_t) || end < start || end - start < sizeof(record_header_t) || end > rf->data_end)
+    {
+        return ERR_CORRUPT; // a bad entry, open only checks the last one
+    }
+    const size_t payload_len = (size_t)(end - start - sizeof(record_header_t));
+    if (payload_len > capacity)
+    {
+        *len = (uint32_t)payload_len;
+        return ERR_BUFFER_SMALL;
+    }
+
+    // Size known from the index: header and payload in one syscall
+    record_header_t header;
+    struct iovec iov[2] = {{.iov_base = &header, .iov_len = sizeof(header)}, {.iov_base = buf, .iov_len = payload_len}};
+    ssize_t n = preadv(rf->fd_data, iov, 2, (off_t)start);
+    if (n != (ssize_t)(sizeof(header) + payload_len))
+    {
+        if (n == ERR_GENERAL_ERROR)
+        {
+            log_error("Error reading the record");
+        }
+        return ERR_FILE_READ;
+    }
+    if (header.len != payload_len || (rf->verify && checksum32(buf, payload_len) != header.checksum))
+    {
+        return ERR_CORRUPT;
+    }
+    *len = header.len;
+    return SUCCESS;
+}
+
+const void *rec_ptr(rec_file_t *rf, uint64_t i, uint32_t *len)
+{
+    const index_t *index = rf->index;
+    if (i >= index->count || data_map(rf, rf->data_end) != SUCCESS)
+    {
+        return NULL;
+    }
+
+    // Same bounds as rec_read(): a bad entry must not send us outside the mapping
+    const uint64_t start = index->offsets[i];
+    const uint64_t end = (i + 1 < index->count) ? index->offsets[i + 1] : index->data_end;
+    if (start < sizeof(data_header_t) || end < start || end - start < sizeof(record_header_t) || end > rf->data_end ||
+        end > rf->map_size)
+    {
+        return NULL;
+    }
+
+    record_header_t header;
+    memcpy(&header, rf->map + start, sizeof(header));
+    const char *payload = rf->map + start + sizeof(header);
+    if (header.len != end - start - sizeof(header) || (rf->verify && checksum32(payload, header.len) != header.checksum))
+    {
+        return NULL;
+    }
+    *len = header.len;
+    return payload;
+}
+
+uint64_t rec_count(const rec_file_t *rf)
+{
+    return rf->index->count;
+}
+
+EXIT_TYPES rec_sync(rec_file_t *rf)
+{
+    // Data before index: on disk the index never points past the data
+    if (fdatasync(rf->fd_data) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error syncing the data file");
+        return ERR_FILE_WRITE;
+    }
+    if (msync(rf->index, sizeof(index_t) + rf->index_capacity * sizeof(uint64_t), MS_SYNC) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error syncing the index file");
+        return ERR_FILE_WRITE;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES rec_close(rec_file_t *rf)
+{
+    EXIT_TYPES ret = SUCCESS;
+
+    if (rf->map != NULL)
+    {
+        munmap((void *)rf->map, rf->map_size);
+        rf->map = NULL;
+    }
+    if (rf->index != NULL)
+    {
+        // Drop the spare capacity, the next open maps what's left
+        const uint64_t count = rf->index->count;
+        munmap(rf->index, sizeof(index_t) + rf->index_capacity * sizeof(uint64_t));
+        rf->index = NULL;
+        if (ftruncate(rf->fd_index, (off_t)(sizeof(index_t) + count * sizeof(uint64_t))) == ERR_GENERAL_ERROR)
+        {
+            log_error("Error trimming the index file");
+            ret = ERR_FILE_WRITE;
+        }
+    }
+    if (rf->fd_index != ERR_GENERAL_ERROR && close_file_safer(rf->fd_index) != SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    if (close_file_safer(rf->fd_data) != SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    rf->fd_index = rf->fd_data = ERR_GENERAL_ERROR;
+    return ret;
+}
+
+uint32_t checksum32(const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint32_t hash = FNV32_OFFSET_BASIS;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ p[i]) * FNV32_PRIME;
+    }
+    return hash;
+}
+
+uint64_t xorshift64(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+uint64_t bench_payload_len(uint64_t i)
+{
+    // Random looking but reproducible per record, so readers can check what they got
+    uint64_t state = (i + 1) * 0x9e3779b97f4a7c15ULL;
+    return BENCH_RECORD_MIN + xorshift64(&state) % (BENCH_RECORD_MAX - BENCH_RECORD_MIN + 1);
+}
+
+EXIT_TYPES bench_append(rec_file_t *rf, uint64_t n_records)
+{
+    char payload[BENCH_RECORD_MAX];
+    for (size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = (char)('a' + i % 26);
+    }
+
+    for (uint64_t i = 0; i < n_records; i++)
+    {
+        memcpy(payload, &i, sizeof(i)); // the record number first
+        EXIT_TYPES ret = rec_append(rf, payload, (uint32_t)bench_payload_len(i));
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES simulate_crash(const char *path, const char *path_index)
+{
+    EXIT_TYPES ret = SUCCESS;
+    int fd_data = open(path, O_WRONLY | O_APPEND);
+    int fd_index = open(path_index, O_RDWR);
+    if (fd_data == ERR_GENERAL_ERROR || fd_index == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the files for the crash");
+        ret = ERR_FILE_OPEN;
+        goto done;
+    }
+
+    // Index: LAG_RECORDS entries never made it, header rolled back to before them
+    index_t header;
+    ret = pread_all(fd_index, (char *)&header, sizeof(header), 0);
+    if (ret != SUCCESS)
+    {
+        goto done;
+    }
+    uint64_t data_end_lagged = 0;
+    ret = pread_all(fd_index, (char *)&data_end_lagged, sizeof(data_end_lagged),
+                    (off_t)(sizeof(index_t) + (header.count - LAG_RECORDS) * sizeof(uint64_t)));
+    if (ret != SUCCESS)
+    {
+        goto done;
+    }
+    header.count -= LAG_RECORDS;
+    header.data_end = data_end_lagged; // the first lost entry's record starts where the indexed ones end
+    ret = pwrite_all(fd_index, (const char *)&header, sizeof(header), 0);
+    if (ret != SUCCESS)
+    {
+        goto done;
+    }
+
+    // Data: a record whose header says TORN_PAYLOAD bytes, only a third of them written
+    char torn[sizeof(record_header_t) + TORN_PAYLOAD / 3];
+    record_header_t torn_header = {.len = TORN_PAYLOAD, .checksum = 0};
+    memcpy(torn, &torn_header, sizeof(torn_header));
+    memset(torn + sizeof(torn_header), 'x', sizeof(torn) - sizeof(torn_header));
+    if (write(fd_data, torn, sizeof(torn)) != (ssize_t)sizeof(torn))
+    {
+        log_error("Error writing the torn record");
+        ret = ERR_FILE_WRITE;
+    }
+
+done:
+    if (fd_data != ERR_GENERAL_ERROR)
+    {
+        close_file_safer(fd_data);
+    }
+    if (fd_index != ERR_GENERAL_ERROR)
+    {
+        close_file_safer(fd_index);
+    }
+    return ret;
+}
+
+EXIT_TYPES bench_read(rec_file_t *rf, uint64_t n_reads, int use_mmap)
+{
+    static char buf[SIZE_BUF_RECORD];
+    const uint64_t count = rec_count(rf);
+    uint64_t state = 0x2545f4914f6cdd1dULL + (uint64_t)use_mmap;
+
+    for (uint64_t r = 0; r < n_reads; r++)
+    {
+        const uint64_t i = xorshift64(&state) % count;
+        uint32_t len = 0;
+        const char *payload = buf;
+
+        if (use_mmap)
+        {
+            payload = rec_ptr(rf, i, &len);
+            if (payload == NULL)
+            {
+                fprintf(stderr, "Record %llu not readable\n", (unsigned long long)i);
+                return ERR_CORRUPT;
+            }
+        }
+        else
+        {
+            EXIT_TYPES ret = rec_read(rf, i, buf, sizeof(buf), &len);
+            if (ret != SUCCESS)
+            {
+                fprintf(stderr, "Record %llu not readable (%d)\n", (unsigned long long)i, ret);
+                return ret;
+            }
+        }
+
+        uint64_t number;
+        memcpy(&number, payload, sizeof(number));
+        if (number != i || len != bench_payload_len(i))
+        {
+            fprintf(stderr, "Record %llu has the wrong content\n", (unsigned long long)i);
+            return ERR_CORRUPT;
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES bench_scan(const char *path, uint64_t n_records, uint64_t n_reads)
+{
+    // No index: hop over the length prefixes from the first record, lseek() + read() of every header
+    int fd = open(path, O_RDONLY);
+    if (fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the data file");
+        return ERR_FILE_OPEN;
+    }
+
+    EXIT_TYPES ret = SUCCESS;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (uint64_t r = 0; r < n_reads && ret == SUCCESS; r++)
+    {
+        const uint64_t target = xorshift64(&state) % n_records;
+        off_t pos = sizeof(data_header_t);
+        record_header_t header;
+        for (uint64_t i = 0;; i++)
+        {
+            if (lseek(fd, pos, SEEK_SET) == ERR_GENERAL_ERROR || read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header))
+            {
+                ret = ERR_FILE_READ;
+                break;
+            }
+            if (i == target)
+            {
+                uint64_t number = 0;
+                if (read(fd, &number, sizeof(number)) != (ssize_t)sizeof(number) || number != target)
+                {
+                    ret = ERR_CORRUPT;
+                }
+                break;
+            }
+            pos += (off_t)(sizeof(header) + header.len);
+        }
+    }
+
+    if (close_file_safer(fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    return ret;
+}
+
+EXIT_TYPES pwrite_all(int fd, const char *buf, size_t len, off_t offset)
+{
+    size_t total_written = 0;
+    while (total_written < len)
+    {
+        ssize_t bytes_written = pwrite(fd, buf + total_written, len - total_written, offset + (off_t)total_written);
+        if (bytes_written == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error writing to file");
+            return ERR_FILE_WRITE;
+        }
+        total_written += (size_t)bytes_written;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES pread_all(int fd, char *buf, size_t len, off_t offset)
+{
+    size_t total_read = 0;
+    while (total_read < len)
+    {
+        ssize_t bytes_read = pread(fd, buf + total_read, len - total_read, offset + (off_t)total_read);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error reading from file");
+            return ERR_FILE_READ;
+        }
+        if (bytes_read == 0)
+        {
+            return ERR_FILE_READ; // end of file before len bytes
+        }
+        total_read += (size_t)bytes_read;
+    }
+    return SUCCESS;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *phase, uint64_t records, uint64_t ops, double seconds)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%llu,%llu,%.4f,%.1f\n", phase, (unsigned long long)records,
+                       (unsigned long long)ops, seconds, (ops > 0) ? seconds * 1e9 / (double)ops : 0.0);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
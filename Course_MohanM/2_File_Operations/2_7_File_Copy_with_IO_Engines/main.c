@@ -0,0 +1,541 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+Large-file copy, built from 2_2 (read) and 2_3 (write), with a selectable I/O engine:
+
+rw              : read() a block into a user buffer, write() it out. 2 copies per byte (kernel -> user -> kernel).
+                  The block size is the knob: syscall count vs. cache footprint.
+sendfile        : kernel copies page cache -> file directly, 0 copies through user space.
+copy_file_range : the file system may not copy at all (reflink on btrfs / XFS, server side copy on NFS),
+                  otherwise it behaves like sendfile. Fails with EXDEV across file systems on older kernels.
+splice          : file -> pipe -> file, the pipe only carries page references. The pipe is resized to the block size.
+mmap            : both files mapped, one memcpy() from the source pages into the destination pages.
+                  The destination is sized with ftruncate() first, page faults replace the syscalls.
+
+GB/s = file size / wall time from open() to close() (+ fdatasync() with --sync, otherwise a lot of it is
+only in the page cache when the clock stops). Run it twice: the first run also measures reading from the disk,
+the second one reads from the page cache.
+
+Usage:
+./main <rw|sendfile|copy_file_range|splice|mmap|all> <source> <destination> [block_size] [--sync]
+block_size accepts K / M suffixes, default 128K.
+
+Example:
+dd if=/dev/urandom of=big.bin bs=1M count=1024
+./main all big.bin copy.bin 1M --sync
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE // splice(), copy_file_range(), F_SETPIPE_SZ
+
+#include <fcntl.h>        // open(), splice(), fcntl()
+#include <unistd.h>       // read(), write(), close(), copy_file_range()
+#include <sys/sendfile.h> // sendfile()
+#include <sys/mman.h>     // mmap(), madvise()
+#include <sys/stat.h>     // fstat(), stat(), permission macros
+#include <stdio.h>        // snprintf()
+#include <stdlib.h>       // malloc(), strtoul()
+#include <string.h>       // strerror(), strcmp(), memcpy()
+#include <errno.h>        // errno
+#include <time.h>         // clock_gettime()
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES_SRC (O_RDONLY)
+#define FILE_MODES_DST (O_RDWR | O_CREAT | O_TRUNC) // O_RDWR: the mmap engine maps it for writing
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+#define OPTION_SYNC "--sync"
+#define ENGINE_ALL "all"
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256
+};
+
+enum COPY_SETTINGS
+{
+    BLOCK_SIZE_DEFAULT = 128 * 1024,
+    BLOCK_SIZE_MIN = 4096,
+    MMAP_CHUNK = 64 * 1024 * 1024 // memcpy in chunks, so the source pages can be dropped behind us
+};
+
+static const size_t SENDFILE_MAX_CHUNK = 0x7ffff000; // Linux moves at most this much per call
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_READ = -3,
+    ERR_FILE_WRITE = -4,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7,
+    ERR_NOT_SUPPORTED = -8 // engine not available for this pair of files, "all" moves on
+
+} EXIT_TYPES;
+
+typedef enum
+{
+    ENGINE_RW = 0,
+    ENGINE_SENDFILE = 1,
+    ENGINE_COPY_FILE_RANGE = 2,
+    ENGINE_SPLICE = 3,
+    ENGINE_MMAP = 4,
+    ENGINE_COUNT
+} COPY_ENGINES;
+
+typedef EXIT_TYPES (*copy_fn)(int fd_src, int fd_dst, size_t len, size_t block_size);
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES copy_rw(int fd_src, int fd_dst, size_t len, size_t block_size);
+EXIT_TYPES copy_sendfile(int fd_src, int fd_dst, size_t len, size_t block_size);
+EXIT_TYPES copy_copy_file_range(int fd_src, int fd_dst, size_t len, size_t block_size);
+EXIT_TYPES copy_splice(int fd_src, int fd_dst, size_t len, size_t block_size);
+EXIT_TYPES copy_mmap(int fd_src, int fd_dst, size_t len, size_t block_size);
+
+EXIT_TYPES run_engine(COPY_ENGINES engine, const char *path_src, const char *path_dst, size_t block_size, int sync);
+EXIT_TYPES write_all(int fd, const char *buf, size_t len);
+size_t parse_size(const char *text);
+double now_sec(void);
+void log_result(const char *engine, size_t bytes, size_t block_size, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Globals ------------------ */
+
+static const char *ENGINE_NAMES[ENGINE_COUNT] = {"rw", "sendfile", "copy_file_range", "splice", "mmap"};
+static const copy_fn ENGINE_FUNCTIONS[ENGINE_COUNT] = {copy_rw, copy_sendfile, copy_copy_file_range, copy_splice, copy_mmap};
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4 || argc > 6)
+    {
+        fprintf(stderr, "Usage: %s <rw|sendfile|copy_file_range|splice|mmap|all> <source> <destination> [block_size] [%s]\n", argv[0], OPTION_SYNC);
+        return ERR_ARGS;
+    }
+
+    size_t block_size = BLOCK_SIZE_DEFAULT;
+    int sync = 0;
+    for (int i = 4; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_SYNC) == 0)
+        {
+            sync = 1;
+        }
+        else if ((block_size = parse_size(argv[i])) < BLOCK_SIZE_MIN)
+        {
+            fprintf(stderr, "Block size must be at least %d bytes\n", BLOCK_SIZE_MIN);
+            return ERR_ARGS;
+        }
+    }
+
+    int run_all = (strcmp(argv[1], ENGINE_ALL) == 0);
+    int engine_known = run_all;
+    for (int engine = 0; engine < ENGINE_COUNT; engine++)
+    {
+        engine_known |= (strcmp(argv[1], ENGINE_NAMES[engine]) == 0);
+    }
+    if (!engine_known)
+    {
+        fprintf(stderr, "Unknown engine: %s\n", argv[1]);
+        return ERR_ARGS;
+    }
+
+    EXIT_TYPES ret = SUCCESS;
+    printf("engine,bytes,block_size,seconds,gb_per_s\n");
+    fflush(stdout); // log_result() writes to the fd directly
+
+    for (int engine = 0; engine < ENGINE_COUNT; engine++)
+    {
+        if (!run_all && strcmp(argv[1], ENGINE_NAMES[engine]) != 0)
+        {
+            continue;
+        }
+
+        EXIT_TYPES ret_engine = run_engine((COPY_ENGINES)engine, argv[2], argv[3], block_size, sync);
+        if (ret_engine != SUCCESS && !(run_all && ret_engine == ERR_NOT_SUPPORTED))
+        {
+            ret = ret_engine;
+        }
+    }
+
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES run_engine(COPY_ENGINES engine, const char *path_src, const char *path_dst, size_t block_size, int sync)
+{
+    const double t_start = now_sec();
+
+    int fd_src = open(path_src, FILE_MODES_SRC);
+    if (fd_src == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the source file");
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(fd_src, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the source file size");
+        close_file_safer(fd_src);
+        return ERR_FILE_READ;
+    }
+
+    // O_TRUNC would empty the source before the first byte is copied
+    struct stat st_dst;
+    if (stat(path_dst, &st_dst) == SUCCESS && st_dst.st_dev == st.st_dev && st_dst.st_ino == st.st_ino)
+    {
+        fprintf(stderr, "Source and destination are the same file\n");
+        close_file_safer(fd_src);
+        return ERR_ARGS;
+    }
+
+    int fd_dst = open(path_dst, FILE_MODES_DST, FILE_PERMISSIONS);
+    if (fd_dst == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the destination file");
+        close_file_safer(fd_src);
+        return ERR_FILE_OPEN;
+    }
+
+    // Tell the kernel the source is read front to back once, so readahead can be more aggressive
+    posix_fadvise(fd_src, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    EXIT_TYPES ret = ENGINE_FUNCTIONS[engine](fd_src, fd_dst, (size_t)st.st_size, block_size);
+    if (ret == SUCCESS && sync && fdatasync(fd_dst) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error flushing the destination file");
+        ret = ERR_FILE_WRITE;
+    }
+
+    if (close_file_safer(fd_src) != SUCCESS || close_file_safer(fd_dst) != SUCCESS)
+    {
+        ret = (ret == SUCCESS) ? ERR_FILE_CLOSE : ret;
+    }
+
+    if (ret == SUCCESS)
+    {
+        log_result(ENGINE_NAMES[engine], (size_t)st.st_size, block_size, now_sec() - t_start);
+    }
+    else if (ret == ERR_NOT_SUPPORTED)
+    {
+        fprintf(stderr, "%s: not supported for these files, skipped\n", ENGINE_NAMES[engine]);
+    }
+    return ret;
+}
+
+EXIT_TYPES copy_rw(int fd_src, int fd_dst, size_t len, size_t block_size)
+{
+    (void)len; // read() tells us about EOF, the file may still grow
+
+    char *buf = malloc(block_size);
+    if (buf == NULL)
+    {
+        log_error("Error allocating the copy buffer");
+        return ERR_ALLOC;
+    }
+
+    EXIT_TYPES ret = SUCCESS;
+    for (;;)
+    {
+        ssize_t bytes_read = read(fd_src, buf, block_size);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error reading the source file");
+            ret = ERR_FILE_READ;
+            break;
+        }
+        else if (bytes_read == 0) // EOF
+        {
+            break;
+        }
+
+        if ((ret = write_all(fd_dst, buf, (size_t)bytes_read)) != SUCCESS)
+        {
+            break;
+        }
+    }
+
+    free(buf);
+    return ret;
+}
+
+EXIT_TYPES copy_sendfile(int fd_src, int fd_dst, size_t len, size_t block_size)
+{
+    (void)block_size; // the kernel picks its own chunks
+
+    off_t offset = 0;
+    while ((size_t)offset < len)
+    {
+        size_t chunk = len - (size_t)offset;
+        ssize_t sent = sendfile(fd_dst, fd_src, &offset, (chunk < SENDFILE_MAX_CHUNK) ? chunk : SENDFILE_MAX_CHUNK);
+        if (sent == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (offset == 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                return ERR_NOT_SUPPORTED;
+            }
+            log_error("Error in sendfile");
+            return ERR_FILE_WRITE;
+        }
+        else if (sent == 0) // source got shorter, the copy is incomplete
+        {
+            fprintf(stderr, "sendfile: source ended at %lld of %zu bytes\n", (long long)offset, len);
+            return ERR_FILE_READ;
+        }
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES copy_copy_file_range(int fd_src, int fd_dst, size_t len, size_t block_size)
+{
+    (void)block_size;
+
+    size_t total = 0;
+    while (total < len)
+    {
+        // NULL offsets: both file offsets move, like read() / write()
+        ssize_t copied = copy_file_range(fd_src, NULL, fd_dst, NULL, len - total, 0);
+        if (copied == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (total == 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL))
+            {
+                return ERR_NOT_SUPPORTED;
+            }
+            log_error("Error in copy_file_range");
+            return ERR_FILE_WRITE;
+        }
+        else if (copied == 0) // same as sendfile()
+        {
+            fprintf(stderr, "copy_file_range: source ended at %zu of %zu bytes\n", total, len);
+            return ERR_FILE_READ;
+        }
+        total += (size_t)copied;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES copy_splice(int fd_src, int fd_dst, size_t len, size_t block_size)
+{
+    int pipe_fds[2];
+    if (pipe(pipe_fds) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error creating the pipe");
+        return ERR_GENERAL_ERROR;
+    }
+
+    // A pipe holds 64K by default, as big as the block makes fewer round trips (capped by /proc/sys/fs/pipe-max-size)
+    long pipe_size = fcntl(pipe_fds[1], F_SETPIPE_SZ, (int)block_size);
+    size_t chunk = (pipe_size > 0) ? (size_t)pipe_size : block_size;
+
+    EXIT_TYPES ret = SUCCESS;
+    size_t total = 0;
+    while (total < len && ret == SUCCESS)
+    {
+        ssize_t in_pipe = splice(fd_src, NULL, pipe_fds[1], NULL, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in_pipe == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ret = (total == 0 && errno == EINVAL) ? ERR_NOT_SUPPORTED : ERR_FILE_READ;
+            if (ret != ERR_NOT_SUPPORTED)
+            {
+                log_error("Error in splice (source -> pipe)");
+            }
+            break;
+        }
+        else if (in_pipe == 0) // same as sendfile()
+        {
+            fprintf(stderr, "splice: source ended at %zu of %zu bytes\n", total, len);
+            ret = ERR_FILE_READ;
+            break;
+        }
+
+        // Drain everything that went in, the pipe must be empty before the next block
+        while (in_pipe > 0)
+        {
+            ssize_t out = splice(pipe_fds[0], NULL, fd_dst, NULL, (size_t)in_pipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out == ERR_GENERAL_ERROR)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                log_error("Error in splice (pipe -> destination)");
+                ret = ERR_FILE_WRITE;
+                break;
+            }
+            in_pipe -= out;
+            total += (size_t)out;
+        }
+    }
+
+    close_file_safer(pipe_fds[0]);
+    close_file_safer(pipe_fds[1]);
+    return ret;
+}
+
+EXIT_TYPES copy_mmap(int fd_src, int fd_dst, size_t len, size_t block_size)
+{
+    (void)block_size;
+
+    if (len == 0) // mmap() of 0 bytes fails
+    {
+        return SUCCESS;
+    }
+
+    if (ftruncate(fd_dst, (off_t)len) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error sizing the destination file");
+        return ERR_FILE_WRITE;
+    }
+
+    char *src = mmap(NULL, len, PROT_READ, MAP_SHARED, fd_src, 0);
+    if (src == MAP_FAILED)
+    {
+        log_error("Error mapping the source file");
+        return ERR_FILE_READ;
+    }
+    char *dst = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd_dst, 0);
+    if (dst == MAP_FAILED)
+    {
+        log_error("Error mapping the destination file");
+        munmap(src, len);
+        return ERR_FILE_WRITE;
+    }
+
+    madvise(src, len, MADV_SEQUENTIAL);
+    madvise(dst, len, MADV_SEQUENTIAL);
+
+    for (size_t offset = 0; offset < len; offset += MMAP_CHUNK)
+    {
+        size_t chunk = (len - offset < MMAP_CHUNK) ? (len - offset) : MMAP_CHUNK;
+        memcpy(dst + offset, src + offset, chunk);
+        madvise(src + offset, chunk, MADV_DONTNEED); // clean page cache pages, only drops them from this mapping
+    }
+
+    // The dirty pages go back to the file when the kernel writes them back, munmap() doesn't wait for it
+    EXIT_TYPES ret = SUCCESS;
+    if (munmap(dst, len) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error unmapping the destination file");
+        ret = ERR_FILE_WRITE;
+    }
+    munmap(src, len);
+    return ret;
+}
+
+EXIT_TYPES write_all(int fd, const char *buf, size_t len)
+{
+    size_t total_written = 0;
+
+    while (total_written < len)
+    {
+        ssize_t bytes_written = write(fd, buf + total_written, len - total_written);
+        if (bytes_written == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error writing to file");
+            return ERR_FILE_WRITE;
+        }
+        total_written += (size_t)bytes_written;
+    }
+    return SUCCESS;
+}
+
+size_t parse_size(const char *text)
+{
+    char *end = NULL;
+    size_t value = strtoul(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *engine, size_t bytes, size_t block_size, double seconds)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%zu,%zu,%.4f,%.3f\n", engine, bytes, block_size, seconds,
+                       (seconds > 0) ? (double)bytes / seconds / 1e9 : 0.0);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
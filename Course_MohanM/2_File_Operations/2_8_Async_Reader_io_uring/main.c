@@ -0,0 +1,841 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+2_2 reads with one read() at a time: the next request only goes out after the previous one came back,
+so the device never sees more than one request and every block pays the full round trip.
+
+This reader keeps up to queue_depth reads in flight:
+
+uring   : io_uring through the raw syscalls (no liburing). The SQ / CQ rings are mmap()ed, every slot gets its own
+          buffer and the buffers are registered once (IORING_REGISTER_BUFFERS), so IORING_OP_READ_FIXED skips
+          pinning the pages on every request. If registering fails (RLIMIT_MEMLOCK) plain IORING_OP_READ is used.
+          One io_uring_enter() submits the new reads and waits for at least one completion.
+threads : fallback when io_uring is not there (old kernel, seccomp in containers, kernel.io_uring_disabled).
+          queue_depth threads doing pread() on blocks they take from a shared counter.
+          epoll() does not help here: regular files are always "ready", epoll_ctl() refuses them with EPERM.
+sync    : the 2_2 loop with a bigger buffer, the baseline. Always queue depth 1.
+
+Completions come back in any order, consume_block() is where the log parser would go. Here it only sums the
+bytes, so every engine must print the same checksum.
+
+Latency is per block, from the first submit to the completion (short reads are resubmitted and counted in).
+
+cold: POSIX_FADV_DONTNEED on the file before the run, drops its clean pages from the page cache without root.
+      (Does nothing on tmpfs, the file has to be on a real disk.)
+warm: the file is read once before the warm runs, it has to fit in RAM.
+
+Usage:
+./main <sync|uring|threads|all> <file> [block_size] [queue_depth] [--cold|--warm]
+Without queue_depth it sweeps 1, 2, 4 .. 128. Without --cold / --warm it runs both.
+
+Example:
+dd if=/dev/urandom of=big.bin bs=1M count=1024
+./main all big.bin 128K > result.csv
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>            // open(), posix_fadvise()
+#include <unistd.h>           // read(), pread(), close(), syscall()
+#include <sys/syscall.h>      // __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register
+#include <sys/mman.h>         // mmap()
+#include <sys/stat.h>         // fstat()
+#include <sys/uio.h>          // struct iovec
+#include <linux/io_uring.h>   // struct io_uring_params, io_uring_sqe, io_uring_cqe
+#include <pthread.h>          // pthread_create(), pthread_join()
+#include <stdio.h>            // snprintf()
+#include <stdlib.h>           // malloc(), posix_memalign(), qsort(), strtoul()
+#include <string.h>           // strerror(), strcmp(), memset()
+#include <stdint.h>           // uint64_t
+#include <errno.h>            // errno
+#include <time.h>             // clock_gettime()
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES (O_RDONLY)
+
+#define OPTION_COLD "--cold"
+#define OPTION_WARM "--warm"
+#define ENGINE_ALL "all"
+
+// The rings are shared with the kernel: read what it wrote with acquire, publish what we wrote with release
+#define load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256
+};
+
+enum READ_SETTINGS
+{
+    BLOCK_SIZE_DEFAULT = 128 * 1024,
+    BLOCK_SIZE_MIN = 4096,
+    BUFFER_ALIGNMENT = 4096, // page aligned, also what O_DIRECT would want
+    QUEUE_DEPTH_MIN = 1,
+    QUEUE_DEPTH_MAX = 128
+};
+
+enum CACHE_STATES
+{
+    CACHE_COLD = 1 << 0,
+    CACHE_WARM = 1 << 1
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_READ = -3,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7,
+    ERR_NOT_SUPPORTED = -8 // io_uring not available, the caller falls back to the thread pool
+
+} EXIT_TYPES;
+
+typedef enum
+{
+    READER_SYNC = 0,
+    READER_URING = 1,
+    READER_THREADS = 2,
+    READER_COUNT
+} READERS;
+
+typedef struct
+{
+    int fd;
+    size_t file_size;
+    size_t block_size;
+    unsigned queue_depth;
+    size_t n_blocks;
+    double *latency_us; // one per block, indexed by block number so the threads never share an entry
+    uint64_t checksum;
+} read_job_t;
+
+typedef EXIT_TYPES (*reader_fn)(read_job_t *job);
+
+typedef struct
+{
+    int ring_fd;
+    int buffers_registered;
+
+    void *sq_ptr;
+    size_t sq_map_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_map_size;
+
+    void *cq_ptr; // == sq_ptr with IORING_FEAT_SINGLE_MMAP
+    size_t cq_map_size;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} uring_t;
+
+typedef struct
+{
+    size_t block;
+    off_t offset;
+    size_t done; // bytes already read, > 0 only after a short read
+    size_t want;
+    double t_submit;
+    uint8_t *buf;
+} uring_slot_t;
+
+typedef struct
+{
+    read_job_t *job;
+    size_t next_block; // shared, taken with __atomic_fetch_add()
+    int failed;
+    uint64_t checksum;
+} pool_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES read_sync(read_job_t *job);
+EXIT_TYPES read_uring(read_job_t *job);
+EXIT_TYPES read_threads(read_job_t *job);
+
+EXIT_TYPES run_reader(READERS reader, const char *path, size_t block_size, unsigned queue_depth, int cache);
+EXIT_TYPES warm_file(const char *path);
+
+EXIT_TYPES uring_setup(uring_t *ring, unsigned entries);
+void uring_destroy(uring_t *ring);
+void uring_queue_read(uring_t *ring, int fd, uring_slot_t *slot, unsigned slot_index);
+void *pool_worker(void *arg);
+
+ssize_t pread_all(int fd, uint8_t *buf, size_t len, off_t offset);
+uint64_t consume_block(const uint8_t *buf, size_t len);
+int compare_double(const void *a, const void *b);
+double percentile(const double *sorted, size_t n, double p);
+size_t parse_size(const char *text);
+double now_sec(void);
+void log_result(const char *engine, int cache, unsigned queue_depth, const read_job_t *job, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Globals ------------------ */
+
+static const char *READER_NAMES[READER_COUNT] = {"sync", "uring", "threads"};
+static const reader_fn READER_FUNCTIONS[READER_COUNT] = {read_sync, read_uring, read_threads};
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 6)
+    {
+        fprintf(stderr, "Usage: %s <sync|uring|threads|all> <file> [block_size] [queue_depth] [%s|%s]\n", argv[0], OPTION_COLD, OPTION_WARM);
+        return ERR_ARGS;
+    }
+
+    size_t block_size = BLOCK_SIZE_DEFAULT;
+    unsigned queue_depth = 0; // 0: sweep
+    int cache = CACHE_COLD | CACHE_WARM;
+    int positional = 0;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], OPTION_COLD) == 0)
+        {
+            cache = CACHE_COLD;
+        }
+        else if (strcmp(argv[i], OPTION_WARM) == 0)
+        {
+            cache = CACHE_WARM;
+        }
+        else if (positional++ == 0)
+        {
+            block_size = parse_size(argv[i]);
+        }
+        else
+        {
+            queue_depth = (unsigned)strtoul(argv[i], NULL, 10);
+            if (queue_depth < QUEUE_DEPTH_MIN || queue_depth > QUEUE_DEPTH_MAX)
+            {
+                fprintf(stderr, "Queue depth must be between %d and %d\n", QUEUE_DEPTH_MIN, QUEUE_DEPTH_MAX);
+                return ERR_ARGS;
+            }
+        }
+    }
+    if (block_size < BLOCK_SIZE_MIN || block_size % BUFFER_ALIGNMENT != 0)
+    {
+        fprintf(stderr, "Block size must be a multiple of %d bytes\n", BUFFER_ALIGNMENT);
+        return ERR_ARGS;
+    }
+
+    int run_all = (strcmp(argv[1], ENGINE_ALL) == 0);
+    int reader_known = run_all;
+    for (int reader = 0; reader < READER_COUNT; reader++)
+    {
+        reader_known |= (strcmp(argv[1], READER_NAMES[reader]) == 0);
+    }
+    if (!reader_known)
+    {
+        fprintf(stderr, "Unknown engine: %s\n", argv[1]);
+        return ERR_ARGS;
+    }
+
+    printf("engine,cache,queue_depth,block_size,bytes,seconds,mb_per_s,p50_us,p99_us,checksum\n");
+    fflush(stdout); // log_result() writes to the fd directly
+
+    EXIT_TYPES ret = SUCCESS;
+    const int cache_states[] = {CACHE_COLD, CACHE_WARM};
+    for (size_t c = 0; c < sizeof(cache_states) / sizeof(cache_states[0]) && ret == SUCCESS; c++)
+    {
+        if (!(cache & cache_states[c]))
+        {
+            continue;
+        }
+        if (cache_states[c] == CACHE_WARM && (ret = warm_file(argv[2])) != SUCCESS)
+        {
+            break;
+        }
+
+        for (int reader = 0; reader < READER_COUNT && ret == SUCCESS; reader++)
+        {
+            if (!run_all && strcmp(argv[1], READER_NAMES[reader]) != 0)
+            {
+                continue;
+            }
+
+            unsigned qd_first = queue_depth ? queue_depth : QUEUE_DEPTH_MIN;
+            unsigned qd_last = queue_depth ? queue_depth : QUEUE_DEPTH_MAX;
+            if (reader == READER_SYNC)
+            {
+                qd_first = qd_last = 1;
+            }
+
+            for (unsigned qd = qd_first; qd <= qd_last && ret == SUCCESS; qd *= 2)
+            {
+                ret = run_reader((READERS)reader, argv[2], block_size, qd, cache_states[c]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES run_reader(READERS reader, const char *path, size_t block_size, unsigned queue_depth, int cache)
+{
+    read_job_t job = {0};
+    job.block_size = block_size;
+    job.queue_depth = queue_depth;
+
+    job.fd = open(path, FILE_MODES);
+    if (job.fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the file");
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(job.fd, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the file size");
+        close_file_safer(job.fd);
+        return ERR_FILE_READ;
+    }
+    job.file_size = (size_t)st.st_size;
+    job.n_blocks = (job.file_size + block_size - 1) / block_size;
+
+    job.latency_us = malloc((job.n_blocks ? job.n_blocks : 1) * sizeof(double));
+    if (job.latency_us == NULL)
+    {
+        log_error("Error allocating the latency table");
+        close_file_safer(job.fd);
+        return ERR_ALLOC;
+    }
+
+    if (cache == CACHE_COLD)
+    {
+        posix_fadvise(job.fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    const char *engine = READER_NAMES[reader];
+    const double t_start = now_sec();
+    EXIT_TYPES ret = READER_FUNCTIONS[reader](&job);
+    if (ret == ERR_NOT_SUPPORTED && reader == READER_URING)
+    {
+        // Nothing was read yet, the cache state is still the one we prepared
+        engine = "uring->threads";
+        ret = read_threads(&job);
+    }
+    const double seconds = now_sec() - t_start;
+
+    if (ret == SUCCESS)
+    {
+        log_result(engine, cache, queue_depth, &job, seconds);
+    }
+
+    free(job.latency_us);
+    if (close_file_safer(job.fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    return ret;
+}
+
+EXIT_TYPES warm_file(const char *path)
+{
+    read_job_t job = {0};
+    job.block_size = BLOCK_SIZE_DEFAULT;
+
+    job.fd = open(path, FILE_MODES);
+    if (job.fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the file");
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(job.fd, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the file size");
+        close_file_safer(job.fd);
+        return ERR_FILE_READ;
+    }
+    job.file_size = (size_t)st.st_size;
+    job.n_blocks = (job.file_size + job.block_size - 1) / job.block_size;
+
+    EXIT_TYPES ret = ERR_ALLOC;
+    job.latency_us = malloc((job.n_blocks ? job.n_blocks : 1) * sizeof(double));
+    if (job.latency_us != NULL)
+    {
+        ret = read_sync(&job);
+        free(job.latency_us);
+    }
+    close_file_safer(job.fd);
+    return ret;
+}
+
+EXIT_TYPES read_sync(read_job_t *job)
+{
+    uint8_t *buf = NULL;
+    if (posix_memalign((void **)&buf, BUFFER_ALIGNMENT, job->block_size) != 0)
+    {
+        log_error("Error allocating the read buffer");
+        return ERR_ALLOC;
+    }
+
+    EXIT_TYPES ret = SUCCESS;
+    for (size_t block = 0; block < job->n_blocks; block++)
+    {
+        const double t_submit = now_sec();
+        ssize_t bytes_read = pread_all(job->fd, buf, job->block_size, (off_t)(block * job->block_size));
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            log_error("Error reading the file");
+            ret = ERR_FILE_READ;
+            break;
+        }
+        job->latency_us[block] = (now_sec() - t_submit) * 1e6;
+        job->checksum += consume_block(buf, (size_t)bytes_read);
+    }
+
+    free(buf);
+    return ret;
+}
+
+EXIT_TYPES read_uring(read_job_t *job)
+{
+    uring_t ring;
+    EXIT_TYPES ret = uring_setup(&ring, job->queue_depth);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    const unsigned n_slots = job->queue_depth;
+    uint8_t *buffers = NULL;
+    uring_slot_t *slots = calloc(n_slots, sizeof(uring_slot_t));
+    unsigned *free_slots = malloc(n_slots * sizeof(unsigned));
+    struct iovec *iov = malloc(n_slots * sizeof(struct iovec));
+    if (slots == NULL || free_slots == NULL || iov == NULL ||
+        posix_memalign((void **)&buffers, BUFFER_ALIGNMENT, (size_t)n_slots * job->block_size) != 0)
+    {
+        log_error("Error allocating the io_uring buffers");
+        free(slots);
+        free(free_slots);
+        free(iov);
+        uring_destroy(&ring);
+        return ERR_ALLOC;
+    }
+
+    unsigned n_free = 0;
+    for (unsigned i = 0; i < n_slots; i++)
+    {
+        slots[i].buf = buffers + (size_t)i * job->block_size;
+        iov[i].iov_base = slots[i].buf;
+        iov[i].iov_len = job->block_size;
+        free_slots[n_free++] = n_slots - 1 - i;
+    }
+
+    // Pins the pages once for the whole run, READ_FIXED then refers to them by index
+    ring.buffers_registered = (syscall(__NR_io_uring_register, ring.ring_fd, IORING_REGISTER_BUFFERS, iov, n_slots) == 0);
+
+    size_t next_block = 0;
+    size_t blocks_done = 0;
+    unsigned to_submit = 0;
+    while (blocks_done < job->n_blocks && ret == SUCCESS)
+    {
+        while (n_free > 0 && next_block < job->n_blocks)
+        {
+            unsigned slot_index = free_slots[--n_free];
+            uring_slot_t *slot = &slots[slot_index];
+            slot->block = next_block++;
+            slot->offset = (off_t)(slot->block * job->block_size);
+            slot->done = 0;
+            slot->want = job->block_size;
+            if ((slot->block + 1) * job->block_size > job->file_size)
+            {
+                slot->want = job->file_size - slot->block * job->block_size;
+            }
+            slot->t_submit = now_sec();
+            uring_queue_read(&ring, job->fd, slot, slot_index);
+            to_submit++;
+        }
+
+        int submitted = (int)syscall(__NR_io_uring_enter, ring.ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+                continue;
+            }
+            log_error("Error in io_uring_enter");
+            ret = ERR_FILE_READ;
+            break;
+        }
+        to_submit -= (unsigned)submitted;
+
+        unsigned head = *ring.cq_head;
+        const unsigned tail = load_acquire(ring.cq_tail);
+        for (; head != tail && ret == SUCCESS; head++)
+        {
+            const struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            const unsigned slot_index = (unsigned)cqe->user_data;
+            uring_slot_t *slot = &slots[slot_index];
+
+            if (cqe->res == -EAGAIN || cqe->res == -EINTR)
+            {
+                uring_queue_read(&ring, job->fd, slot, slot_index);
+                to_submit++;
+                continue;
+            }
+            if (cqe->res < 0)
+            {
+                errno = -cqe->res;
+                log_error("Error in an io_uring read");
+                ret = ERR_FILE_READ;
+                continue; // head++ consumes this CQE, ret ends both loops, nothing is refilled
+            }
+
+            slot->done += (size_t)cqe->res;
+            if (cqe->res > 0 && slot->done < slot->want) // short read, ask for the rest
+            {
+                uring_queue_read(&ring, job->fd, slot, slot_index);
+                to_submit++;
+                continue;
+            }
+
+            // res == 0 before the end: the file got shorter, keep what we have
+            job->latency_us[slot->block] = (now_sec() - slot->t_submit) * 1e6;
+            job->checksum += consume_block(slot->buf, slot->done);
+            free_slots[n_free++] = slot_index;
+            blocks_done++;
+        }
+        store_release(ring.cq_head, head);
+    }
+
+    // Closing the ring cancels whatever is still in flight after an error
+    uring_destroy(&ring);
+    free(buffers);
+    free(slots);
+    free(free_slots);
+    free(iov);
+    return ret;
+}
+
+EXIT_TYPES read_threads(read_job_t *job)
+{
+    pool_t pool = {0};
+    pool.job = job;
+
+    pthread_t *threads = malloc(job->queue_depth * sizeof(pthread_t));
+    if (threads == NULL)
+    {
+        log_error("Error allocating the thread pool");
+        return ERR_ALLOC;
+    }
+
+    unsigned n_started = 0;
+    for (; n_started < job->queue_depth; n_started++)
+    {
+        int err = pthread_create(&threads[n_started], NULL, pool_worker, &pool);
+        if (err != 0)
+        {
+            errno = err;
+            log_error("Error creating a reader thread");
+            break;
+        }
+    }
+    for (unsigned i = 0; i < n_started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    // The threads that did start have read every block, only fail if none did
+    if (n_started == 0 || pool.failed)
+    {
+        return ERR_FILE_READ;
+    }
+    job->checksum += pool.checksum;
+    return SUCCESS;
+}
+
+void *pool_worker(void *arg)
+{
+    pool_t *pool = (pool_t *)arg;
+    read_job_t *job = pool->job;
+
+    uint8_t *buf = NULL;
+    if (posix_memalign((void **)&buf, BUFFER_ALIGNMENT, job->block_size) != 0)
+    {
+        __atomic_store_n(&pool->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    uint64_t checksum = 0;
+    for (;;)
+    {
+        const size_t block = __atomic_fetch_add(&pool->next_block, 1, __ATOMIC_RELAXED);
+        if (block >= job->n_blocks || __atomic_load_n(&pool->failed, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+
+        const double t_submit = now_sec();
+        ssize_t bytes_read = pread_all(job->fd, buf, job->block_size, (off_t)(block * job->block_size));
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            log_error("Error reading the file");
+            __atomic_store_n(&pool->failed, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        job->latency_us[block] = (now_sec() - t_submit) * 1e6;
+        checksum += consume_block(buf, (size_t)bytes_read);
+    }
+
+    __atomic_fetch_add(&pool->checksum, checksum, __ATOMIC_RELAXED);
+    free(buf);
+    return NULL;
+}
+
+EXIT_TYPES uring_setup(uring_t *ring, unsigned entries)
+{
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->ring_fd == ERR_GENERAL_ERROR)
+    {
+        if (errno == ENOSYS || errno == EPERM || errno == EACCES)
+        {
+            log_error("io_uring not available, using the thread pool");
+            return ERR_NOT_SUPPORTED;
+        }
+        log_error("Error in io_uring_setup");
+        return ERR_GENERAL_ERROR;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) // one mapping holds both rings
+    {
+        if (ring->cq_map_size > ring->sq_map_size)
+        {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED)
+    {
+        log_error("Error mapping the submission ring");
+        close_file_safer(ring->ring_fd);
+        return ERR_GENERAL_ERROR;
+    }
+
+    ring->cq_ptr = ring->sq_ptr;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        ring->cq_ptr = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED)
+        {
+            log_error("Error mapping the completion ring");
+            munmap(ring->sq_ptr, ring->sq_map_size);
+            close_file_safer(ring->ring_fd);
+            return ERR_GENERAL_ERROR;
+        }
+    }
+
+    ring->sqes_map_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        log_error("Error mapping the submission entries");
+        if (ring->cq_ptr != ring->sq_ptr)
+        {
+            munmap(ring->cq_ptr, ring->cq_map_size);
+        }
+        munmap(ring->sq_ptr, ring->sq_map_size);
+        close_file_safer(ring->ring_fd);
+        return ERR_GENERAL_ERROR;
+    }
+
+    uint8_t *sq = ring->sq_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+    uint8_t *cq = ring->cq_ptr;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return SUCCESS;
+}
+
+void uring_destroy(uring_t *ring)
+{
+    munmap(ring->sqes, ring->sqes_map_size);
+    if (ring->cq_ptr != ring->sq_ptr)
+    {
+        munmap(ring->cq_ptr, ring->cq_map_size);
+    }
+    munmap(ring->sq_ptr, ring->sq_map_size);
+    close_file_safer(ring->ring_fd); // also unregisters the buffers
+}
+
+void uring_queue_read(uring_t *ring, int fd, uring_slot_t *slot, unsigned slot_index)
+{
+    // Only this thread writes the SQ tail, the kernel only moves the head.
+    // Never more reads in flight than slots, and the ring has at least as many entries, so it can't be full.
+    const unsigned tail = *ring->sq_tail;
+    const unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = ring->buffers_registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = (uint64_t)slot->offset + slot->done;
+    sqe->addr = (uint64_t)(uintptr_t)(slot->buf + slot->done);
+    sqe->len = (uint32_t)(slot->want - slot->done);
+    sqe->buf_index = (uint16_t)slot_index;
+    sqe->user_data = slot_index;
+
+    ring->sq_array[index] = index;
+    store_release(ring->sq_tail, tail + 1);
+}
+
+ssize_t pread_all(int fd, uint8_t *buf, size_t len, off_t offset)
+{
+    size_t total = 0;
+    while (total < len)
+    {
+        ssize_t bytes_read = pread(fd, buf + total, len - total, offset + (off_t)total);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return ERR_GENERAL_ERROR;
+        }
+        else if (bytes_read == 0) // EOF, last block
+        {
+            break;
+        }
+        total += (size_t)bytes_read;
+    }
+    return (ssize_t)total;
+}
+
+uint64_t consume_block(const uint8_t *buf, size_t len)
+{
+    // Stand-in for the log parser: touches every byte, the order of the blocks doesn't matter
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        sum += buf[i];
+    }
+    return sum;
+}
+
+int compare_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double percentile(const double *sorted, size_t n, double p)
+{
+    if (n == 0)
+    {
+        return 0.0;
+    }
+    return sorted[(size_t)(p * (double)(n - 1) + 0.5)];
+}
+
+size_t parse_size(const char *text)
+{
+    char *end = NULL;
+    size_t value = strtoul(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *engine, int cache, unsigned queue_depth, const read_job_t *job, double seconds)
+{
+    qsort(job->latency_us, job->n_blocks, sizeof(double), compare_double);
+
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%s,%u,%zu,%zu,%.4f,%.1f,%.1f,%.1f,%llu\n",
+                       engine, (cache == CACHE_COLD) ? "cold" : "warm", queue_depth, job->block_size, job->file_size, seconds,
+                       (seconds > 0) ? (double)job->file_size / seconds / 1e6 : 0.0,
+                       percentile(job->latency_us, job->n_blocks, 0.50), percentile(job->latency_us, job->n_blocks, 0.99),
+                       (unsigned long long)job->checksum);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
@@ -0,0 +1,969 @@
+/* ---------------- Notes ------------------ */
+
+/*
+
+2_5 looks for one word with a read() per byte and goes back with lseek() to overwrite it.
+This is the same idea for big files and many words at once:
+
+- The file is read in big blocks (default 1M), never all at once.
+- All the patterns are searched in one pass with an Aho-Corasick automaton: a trie of the patterns where every
+  (state, byte) already points to the next state (the failure links are folded into the table at build time),
+  so every byte costs one table lookup, whatever the number of patterns.
+- Most of the time the automaton is in the root state (no partial match). There the bytes that can't start
+  a pattern are skipped: memchr() when all the patterns start with the same byte, a 256 entry table otherwise.
+- The state is kept from one block to the next, so a match split over two blocks is found like any other.
+
+Which match wins: the first pattern to end wins, when several end on the same byte the longest one.
+After a replacement the search restarts behind it, matches never overlap.
+
+Replacing:
+- every replacement has the length of its pattern: the file is patched in place, one pwrite() per match
+  at the offset of the match (it may start in the previous block, the offset is absolute).
+- otherwise the output is streamed into a temp file next to the original, which then replaces it with rename().
+  rename() is atomic: a reader sees the old file or the new one, never half of it.
+  The bytes that may still be the start of a match (at most the depth of the current state) are held back.
+  They are always the first bytes of the current state's string, so nothing has to be copied between blocks.
+
+--mmap (same length replacements only): the file is mapped MAP_SHARED and scanned as one big block,
+a match is patched with a memcpy() into the mapping, no syscall per match. MADV_SEQUENTIAL lets the kernel
+read ahead further and drop the pages behind us sooner. The dirty pages are written back with one msync(MS_SYNC)
+at the end. Needs the file to fit in the address space (matters on 32 bit, e.g. the RPi), otherwise pwrite() is used.
+
+--bench: same length replacements on a copy of the file (<file>.bench), once with pwrite() per match and once
+with --mmap. Both end with the data on disk (fdatasync() / msync()), so the two rows compare the same work.
+The interesting case is millions of matches, where pwrite() pays a syscall each.
+
+Usage:
+./main <file> [--block <size>] [--count] [--mmap] [--bench] <find> <replace> [<find> <replace> ...]
+--count only counts the matches, the file is not touched.
+
+Example:
+./main author.txt Rohan Mohan instructor teacher
+./main big.txt --bench e E
+
+*/
+
+/* ---------------- Libraries ------------------ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>    // open(), posix_fadvise()
+#include <unistd.h>   // read(), pwrite(), close(), fsync()
+#include <sys/stat.h> // fstat(), fchmod()
+#include <sys/mman.h> // mmap(), madvise(), msync()
+#include <stdio.h>    // snprintf(), rename()
+#include <stdlib.h>   // malloc(), mkstemp(), strtoul()
+#include <string.h>   // strerror(), strcmp(), strlen(), memchr()
+#include <stdint.h>   // uint8_t, int32_t
+#include <errno.h>    // errno
+#include <time.h>     // clock_gettime()
+
+/* ---------------- Enumerations, Defines and Constants ------------------ */
+
+#define FILE_MODES_IN_PLACE (O_RDWR)
+#define FILE_MODES_READ (O_RDONLY)
+#define FILE_MODES_COPY (O_WRONLY | O_CREAT | O_TRUNC)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+#define TEMP_FILE_SUFFIX ".XXXXXX" // mkstemp() template
+
+#define OPTION_BLOCK "--block"
+#define OPTION_COUNT "--count"
+#define OPTION_MMAP "--mmap"
+#define OPTION_BENCH "--bench"
+#define BENCH_FILE_SUFFIX ".bench"
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 256,
+    SIZE_BUF_ERROR_LOG = 256,
+    SIZE_ALPHABET = 256
+};
+
+enum SEARCH_SETTINGS
+{
+    BLOCK_SIZE_DEFAULT = 1024 * 1024,
+    BLOCK_SIZE_MIN = 4096,
+    AC_ROOT = 0,
+    AC_NO_MATCH = -1,
+    AC_NO_NODE = -1
+};
+
+enum FILE_DESCRIPTORS
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL_ERROR = -1,
+    ERR_FILE_OPEN = -2,
+    ERR_FILE_READ = -3,
+    ERR_FILE_WRITE = -4,
+    ERR_FILE_CLOSE = -5,
+    ERR_ARGS = -6,
+    ERR_ALLOC = -7
+
+} EXIT_TYPES;
+
+typedef enum
+{
+    REPLACE_COUNT = 0,
+    REPLACE_IN_PLACE = 1,
+    REPLACE_TEMP_FILE = 2,
+    REPLACE_MMAP = 3
+} REPLACE_MODES;
+
+typedef struct
+{
+    const uint8_t *find;
+    size_t find_len;
+    const uint8_t *replace;
+    size_t replace_len;
+} pattern_t;
+
+typedef struct
+{
+    const pattern_t *patterns;
+    int n_patterns;
+    int n_nodes;
+    int32_t *next;      // n_nodes * SIZE_ALPHABET, complete transition table
+    int32_t *fail;      // only needed while building, freed after
+    int32_t *match;     // longest pattern ending in this state, or AC_NO_MATCH
+    int32_t *depth;     // length of the state's string
+    int32_t *prefix_of; // a pattern whose first depth bytes are the state's string
+    uint8_t first_byte[SIZE_ALPHABET]; // 1 if some pattern starts with this byte
+    int n_first_bytes;
+    uint8_t only_first_byte;
+} ac_t;
+
+typedef EXIT_TYPES (*match_fn)(void *ctx, const pattern_t *pattern, size_t end); // end: index in the block, exclusive
+
+typedef struct
+{
+    const ac_t *ac;
+    REPLACE_MODES mode;
+    size_t block_size;
+    size_t matches;
+
+    off_t block_start; // file offset of buf[0]
+
+    // in place
+    int fd;
+    int sync;     // fdatasync() before close, for the benchmark
+    uint8_t *map; // --mmap
+
+    // temp file
+    int fd_out;
+    const uint8_t *block;
+    off_t emitted; // everything before this offset is in the output
+    const uint8_t *carry; // the held back bytes from the previous blocks, [carry_start, block_start)
+    off_t carry_start;
+    uint8_t *out;
+    size_t out_len;
+} replace_ctx_t;
+
+/* ---------------- Function Prototypes ------------------ */
+
+EXIT_TYPES ac_build(ac_t *ac, const pattern_t *patterns, int n_patterns);
+void ac_destroy(ac_t *ac);
+EXIT_TYPES ac_scan(const ac_t *ac, const uint8_t *buf, size_t len, int32_t *state, match_fn on_match, void *ctx);
+
+EXIT_TYPES replace_file(const char *path, replace_ctx_t *ctx);
+EXIT_TYPES replace_file_mmap(const char *path, replace_ctx_t *ctx);
+EXIT_TYPES run_bench(const char *path, replace_ctx_t *ctx);
+EXIT_TYPES copy_file(const char *path_src, const char *path_dst, size_t block_size);
+EXIT_TYPES on_match_count(void *ctx, const pattern_t *pattern, size_t end);
+EXIT_TYPES on_match_in_place(void *ctx, const pattern_t *pattern, size_t end);
+EXIT_TYPES on_match_temp_file(void *ctx, const pattern_t *pattern, size_t end);
+EXIT_TYPES on_match_mmap(void *ctx, const pattern_t *pattern, size_t end);
+EXIT_TYPES emit_until(replace_ctx_t *ctx, off_t until);
+EXIT_TYPES out_append(replace_ctx_t *ctx, const uint8_t *data, size_t len);
+EXIT_TYPES out_flush(replace_ctx_t *ctx);
+
+EXIT_TYPES write_all(int fd, const uint8_t *buf, size_t len);
+size_t parse_size(const char *text);
+double now_sec(void);
+void log_result(const char *mode, size_t bytes, size_t matches, double seconds);
+void log_error(const char *msg_prefix);
+EXIT_TYPES close_file_safer(int fd);
+
+/* ---------------- Globals ------------------ */
+
+static const char *MODE_NAMES[] = {"count", "pwrite", "temp_file", "mmap"};
+
+/* ---------------- Main Function ------------------ */
+
+int main(int argc, char *argv[])
+{
+    size_t block_size = BLOCK_SIZE_DEFAULT;
+    int count_only = 0;
+    int use_mmap = 0;
+    int bench = 0;
+    int arg = 2;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+    {
+        if (strcmp(argv[arg], OPTION_COUNT) == 0)
+        {
+            count_only = 1;
+        }
+        else if (strcmp(argv[arg], OPTION_MMAP) == 0)
+        {
+            use_mmap = 1;
+        }
+        else if (strcmp(argv[arg], OPTION_BENCH) == 0)
+        {
+            bench = 1;
+        }
+        else if (strcmp(argv[arg], OPTION_BLOCK) == 0 && arg + 1 < argc)
+        {
+            block_size = parse_size(argv[++arg]);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    const int n_patterns = (argc - arg) / 2;
+    if (argc < 2 || n_patterns == 0 || (argc - arg) % 2 != 0)
+    {
+        fprintf(stderr, "Usage: %s <file> [%s <size>] [%s] [%s] [%s] <find> <replace> [<find> <replace> ...]\n",
+                argv[0], OPTION_BLOCK, OPTION_COUNT, OPTION_MMAP, OPTION_BENCH);
+        return ERR_ARGS;
+    }
+    if (block_size < BLOCK_SIZE_MIN)
+    {
+        fprintf(stderr, "Block size must be at least %d bytes\n", BLOCK_SIZE_MIN);
+        return ERR_ARGS;
+    }
+
+    pattern_t *patterns = malloc((size_t)n_patterns * sizeof(pattern_t));
+    if (patterns == NULL)
+    {
+        log_error("Error allocating the patterns");
+        return ERR_ALLOC;
+    }
+
+    REPLACE_MODES mode = count_only ? REPLACE_COUNT : REPLACE_IN_PLACE;
+    for (int i = 0; i < n_patterns; i++)
+    {
+        patterns[i].find = (const uint8_t *)argv[arg + 2 * i];
+        patterns[i].find_len = strlen(argv[arg + 2 * i]);
+        patterns[i].replace = (const uint8_t *)argv[arg + 2 * i + 1];
+        patterns[i].replace_len = strlen(argv[arg + 2 * i + 1]);
+
+        if (patterns[i].find_len == 0)
+        {
+            fprintf(stderr, "Empty search pattern\n");
+            free(patterns);
+            return ERR_ARGS;
+        }
+        if (patterns[i].find_len != patterns[i].replace_len && mode == REPLACE_IN_PLACE)
+        {
+            mode = REPLACE_TEMP_FILE;
+        }
+    }
+
+    if ((use_mmap || bench) && mode != REPLACE_IN_PLACE)
+    {
+        fprintf(stderr, "%s / %s need same length replacements and no %s\n", OPTION_MMAP, OPTION_BENCH, OPTION_COUNT);
+        free(patterns);
+        return ERR_ARGS;
+    }
+
+    ac_t ac;
+    EXIT_TYPES ret = ac_build(&ac, patterns, n_patterns);
+    if (ret != SUCCESS)
+    {
+        free(patterns);
+        return ret;
+    }
+
+    replace_ctx_t ctx = {0};
+    ctx.ac = &ac;
+    ctx.mode = mode;
+    ctx.block_size = block_size;
+    ctx.fd = ctx.fd_out = ERR_GENERAL_ERROR;
+
+    printf("mode,bytes,matches,seconds,mb_per_s\n");
+    fflush(stdout); // log_result() writes to the fd directly
+
+    if (bench)
+    {
+        ret = run_bench(argv[1], &ctx);
+    }
+    else if (use_mmap)
+    {
+        ctx.mode = REPLACE_MMAP;
+        ret = replace_file_mmap(argv[1], &ctx);
+    }
+    else
+    {
+        ret = replace_file(argv[1], &ctx);
+    }
+
+    ac_destroy(&ac);
+    free(patterns);
+    return ret;
+}
+
+/* ---------------- Function Implementations ------------------ */
+
+EXIT_TYPES ac_build(ac_t *ac, const pattern_t *patterns, int n_patterns)
+{
+    memset(ac, 0, sizeof(*ac));
+    ac->patterns = patterns;
+    ac->n_patterns = n_patterns;
+
+    // Upper bound: one node per pattern byte + the root
+    size_t capacity = 1;
+    for (int i = 0; i < n_patterns; i++)
+    {
+        capacity += patterns[i].find_len;
+    }
+    ac->next = malloc(capacity * SIZE_ALPHABET * sizeof(int32_t));
+    ac->fail = malloc(capacity * sizeof(int32_t));
+    ac->match = malloc(capacity * sizeof(int32_t));
+    ac->depth = malloc(capacity * sizeof(int32_t));
+    ac->prefix_of = malloc(capacity * sizeof(int32_t));
+    if (ac->next == NULL || ac->fail == NULL || ac->match == NULL || ac->depth == NULL || ac->prefix_of == NULL)
+    {
+        log_error("Error allocating the automaton");
+        ac_destroy(ac);
+        return ERR_ALLOC;
+    }
+
+    // Trie
+    ac->n_nodes = 1;
+    for (size_t b = 0; b < SIZE_ALPHABET; b++)
+    {
+        ac->next[AC_ROOT * SIZE_ALPHABET + b] = AC_NO_NODE;
+    }
+    ac->match[AC_ROOT] = AC_NO_MATCH;
+    ac->depth[AC_ROOT] = 0;
+    ac->prefix_of[AC_ROOT] = 0;
+
+    for (int i = 0; i < n_patterns; i++)
+    {
+        int32_t node = AC_ROOT;
+        for (size_t k = 0; k < patterns[i].find_len; k++)
+        {
+            const uint8_t b = patterns[i].find[k];
+            if (ac->next[node * SIZE_ALPHABET + b] == AC_NO_NODE)
+            {
+                const int32_t child = ac->n_nodes++;
+                for (size_t c = 0; c < SIZE_ALPHABET; c++)
+                {
+                    ac->next[child * SIZE_ALPHABET + c] = AC_NO_NODE;
+                }
+                ac->match[child] = AC_NO_MATCH;
+                ac->depth[child] = (int32_t)(k + 1);
+                ac->prefix_of[child] = i;
+                ac->next[node * SIZE_ALPHABET + b] = child;
+            }
+            node = ac->next[node * SIZE_ALPHABET + b];
+        }
+        if (ac->match[node] != AC_NO_MATCH)
+        {
+            fprintf(stderr, "Pattern given twice: %s\n", (const char *)patterns[i].find);
+            ac_destroy(ac);
+            return ERR_ARGS;
+        }
+        ac->match[node] = i;
+    }
+
+    // Breadth first: a node's failure link is always closer to the root, so its row is complete before the node's
+    int32_t *queue = malloc((size_t)ac->n_nodes * sizeof(int32_t));
+    if (queue == NULL)
+    {
+        log_error("Error allocating the automaton");
+        ac_destroy(ac);
+        return ERR_ALLOC;
+    }
+    int head = 0;
+    int tail = 0;
+
+    ac->fail[AC_ROOT] = AC_ROOT;
+    for (size_t b = 0; b < SIZE_ALPHABET; b++)
+    {
+        int32_t child = ac->next[AC_ROOT * SIZE_ALPHABET + b];
+        if (child == AC_NO_NODE)
+        {
+            ac->next[AC_ROOT * SIZE_ALPHABET + b] = AC_ROOT;
+            continue;
+        }
+        ac->fail[child] = AC_ROOT;
+        queue[tail++] = child;
+
+        ac->first_byte[b] = 1;
+        ac->n_first_bytes++;
+        ac->only_first_byte = (uint8_t)b;
+    }
+
+    while (head < tail)
+    {
+        const int32_t node = queue[head++];
+
+        // The state's own pattern is the longest that ends here, otherwise the longest of its suffixes
+        if (ac->match[node] == AC_NO_MATCH)
+        {
+            ac->match[node] = ac->match[ac->fail[node]];
+        }
+
+        for (size_t b = 0; b < SIZE_ALPHABET; b++)
+        {
+            int32_t child = ac->next[node * SIZE_ALPHABET + b];
+            const int32_t via_fail = ac->next[ac->fail[node] * SIZE_ALPHABET + b];
+            if (child == AC_NO_NODE)
+            {
+                ac->next[node * SIZE_ALPHABET + b] = via_fail;
+                continue;
+            }
+            ac->fail[child] = via_fail;
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+    free(ac->fail);
+    ac->fail = NULL;
+    return SUCCESS;
+}
+
+void ac_destroy(ac_t *ac)
+{
+    free(ac->next);
+    free(ac->fail);
+    free(ac->match);
+    free(ac->depth);
+    free(ac->prefix_of);
+    memset(ac, 0, sizeof(*ac));
+}
+
+EXIT_TYPES ac_scan(const ac_t *ac, const uint8_t *buf, size_t len, int32_t *state, match_fn on_match, void *ctx)
+{
+    int32_t s = *state;
+    size_t i = 0;
+
+    while (i < len)
+    {
+        if (s == AC_ROOT)
+        {
+            // Nothing started yet: jump to the next byte that can start a pattern
+            if (ac->n_first_bytes == 1)
+            {
+                const uint8_t *hit = memchr(buf + i, ac->only_first_byte, len - i);
+                i = (hit != NULL) ? (size_t)(hit - buf) : len;
+            }
+            else
+            {
+                while (i < len && !ac->first_byte[buf[i]])
+                {
+                    i++;
+                }
+            }
+            if (i == len)
+            {
+                break;
+            }
+        }
+
+        s = ac->next[s * SIZE_ALPHABET + buf[i++]];
+        if (ac->match[s] != AC_NO_MATCH)
+        {
+            EXIT_TYPES ret = on_match(ctx, &ac->patterns[ac->match[s]], i);
+            if (ret != SUCCESS)
+            {
+                *state = s;
+                return ret;
+            }
+            s = AC_ROOT;
+        }
+    }
+
+    *state = s;
+    return SUCCESS;
+}
+
+EXIT_TYPES replace_file(const char *path, replace_ctx_t *ctx)
+{
+    const double t_start = now_sec();
+
+    ctx->fd = open(path, (ctx->mode == REPLACE_IN_PLACE) ? FILE_MODES_IN_PLACE : FILE_MODES_READ);
+    if (ctx->fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the file");
+        return ERR_FILE_OPEN;
+    }
+    posix_fadvise(ctx->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    struct stat st;
+    if (fstat(ctx->fd, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the file size");
+        close_file_safer(ctx->fd);
+        return ERR_FILE_READ;
+    }
+
+    char *temp_path = NULL;
+    if (ctx->mode == REPLACE_TEMP_FILE)
+    {
+        // Same directory as the original, rename() only works inside one file system
+        temp_path = malloc(strlen(path) + sizeof(TEMP_FILE_SUFFIX));
+        ctx->out = malloc(ctx->block_size);
+        if (temp_path == NULL || ctx->out == NULL)
+        {
+            log_error("Error allocating the output buffer");
+            free(temp_path);
+            free(ctx->out);
+            close_file_safer(ctx->fd);
+            return ERR_ALLOC;
+        }
+        strcpy(temp_path, path);
+        strcat(temp_path, TEMP_FILE_SUFFIX);
+
+        ctx->fd_out = mkstemp(temp_path);
+        if (ctx->fd_out == ERR_GENERAL_ERROR)
+        {
+            log_error("Error creating the temp file");
+            free(temp_path);
+            free(ctx->out);
+            close_file_safer(ctx->fd);
+            return ERR_FILE_OPEN;
+        }
+        fchmod(ctx->fd_out, st.st_mode & 07777); // mkstemp() creates it 0600
+    }
+
+    uint8_t *buf = malloc(ctx->block_size);
+    EXIT_TYPES ret = (buf != NULL) ? SUCCESS : ERR_ALLOC;
+    if (buf == NULL)
+    {
+        log_error("Error allocating the read buffer");
+    }
+
+    static const match_fn MATCH_FUNCTIONS[] = {on_match_count, on_match_in_place, on_match_temp_file};
+    int32_t state = AC_ROOT;
+    size_t total = 0;
+    while (ret == SUCCESS)
+    {
+        ssize_t bytes_read = read(ctx->fd, buf, ctx->block_size);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error reading the file");
+            ret = ERR_FILE_READ;
+            break;
+        }
+        else if (bytes_read == 0) // EOF
+        {
+            break;
+        }
+
+        ctx->block = buf;
+        ret = ac_scan(ctx->ac, buf, (size_t)bytes_read, &state, MATCH_FUNCTIONS[ctx->mode], ctx);
+        total += (size_t)bytes_read;
+
+        if (ret == SUCCESS && ctx->mode == REPLACE_TEMP_FILE)
+        {
+            // Everything but the partial match at the end can go out. The partial match is the first
+            // depth bytes of the state's string, so the next block doesn't need this buffer.
+            const off_t block_end = ctx->block_start + bytes_read;
+            ret = emit_until(ctx, block_end - ctx->ac->depth[state]);
+            ctx->carry = ctx->ac->patterns[ctx->ac->prefix_of[state]].find;
+            ctx->carry_start = block_end - ctx->ac->depth[state];
+        }
+        ctx->block_start += bytes_read;
+    }
+
+    if (ctx->mode == REPLACE_TEMP_FILE)
+    {
+        // EOF in the middle of a partial match: it wasn't one
+        if (ret == SUCCESS)
+        {
+            ret = emit_until(ctx, ctx->block_start);
+        }
+        if (ret == SUCCESS)
+        {
+            ret = out_flush(ctx);
+        }
+        if (ret == SUCCESS && fsync(ctx->fd_out) == ERR_GENERAL_ERROR) // the data must be on disk before the name points at it
+        {
+            log_error("Error flushing the temp file");
+            ret = ERR_FILE_WRITE;
+        }
+        if (close_file_safer(ctx->fd_out) != SUCCESS && ret == SUCCESS)
+        {
+            ret = ERR_FILE_CLOSE;
+        }
+        if (ret == SUCCESS && rename(temp_path, path) == ERR_GENERAL_ERROR)
+        {
+            log_error("Error replacing the file");
+            ret = ERR_FILE_WRITE;
+        }
+        if (ret != SUCCESS)
+        {
+            unlink(temp_path); // the original is untouched
+        }
+        free(temp_path);
+        free(ctx->out);
+    }
+    else if (ret == SUCCESS && ctx->sync && fdatasync(ctx->fd) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error flushing the file");
+        ret = ERR_FILE_WRITE;
+    }
+
+    free(buf);
+    if (close_file_safer(ctx->fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+
+    if (ret == SUCCESS)
+    {
+        log_result(MODE_NAMES[ctx->mode], total, ctx->matches, now_sec() - t_start);
+    }
+    return ret;
+}
+
+EXIT_TYPES replace_file_mmap(const char *path, replace_ctx_t *ctx)
+{
+    const double t_start = now_sec();
+
+    ctx->fd = open(path, FILE_MODES_IN_PLACE);
+    if (ctx->fd == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the file");
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(ctx->fd, &st) == ERR_GENERAL_ERROR)
+    {
+        log_error("Error reading the file size");
+        close_file_safer(ctx->fd);
+        return ERR_FILE_READ;
+    }
+
+    // Half the address space at most, the rest is the program, the heap, the stacks and the libraries
+    if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX / 2)
+    {
+        fprintf(stderr, "File too big to map, using pwrite()\n");
+        close_file_safer(ctx->fd);
+        ctx->mode = REPLACE_IN_PLACE;
+        return replace_file(path, ctx);
+    }
+
+    const size_t len = (size_t)st.st_size;
+    EXIT_TYPES ret = SUCCESS;
+    if (len > 0) // mmap() of 0 bytes fails
+    {
+        ctx->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd, 0);
+        if (ctx->map == MAP_FAILED)
+        {
+            log_error("Error mapping the file");
+            close_file_safer(ctx->fd);
+            return ERR_FILE_READ;
+        }
+        madvise(ctx->map, len, MADV_SEQUENTIAL);
+
+        // The whole file is one block, the state never has to survive a block boundary
+        int32_t state = AC_ROOT;
+        ret = ac_scan(ctx->ac, ctx->map, len, &state, on_match_mmap, ctx);
+
+        // One write back for all the matches. Only the pages that were patched are dirty.
+        if (ret == SUCCESS && msync(ctx->map, len, MS_SYNC) == ERR_GENERAL_ERROR)
+        {
+            log_error("Error writing back the mapping");
+            ret = ERR_FILE_WRITE;
+        }
+        munmap(ctx->map, len);
+        ctx->map = NULL;
+    }
+
+    if (close_file_safer(ctx->fd) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+
+    if (ret == SUCCESS)
+    {
+        log_result(MODE_NAMES[ctx->mode], len, ctx->matches, now_sec() - t_start);
+    }
+    return ret;
+}
+
+EXIT_TYPES run_bench(const char *path, replace_ctx_t *ctx)
+{
+    char *bench_path = malloc(strlen(path) + sizeof(BENCH_FILE_SUFFIX));
+    if (bench_path == NULL)
+    {
+        log_error("Error allocating the bench file name");
+        return ERR_ALLOC;
+    }
+    strcpy(bench_path, path);
+    strcat(bench_path, BENCH_FILE_SUFFIX);
+
+    const REPLACE_MODES modes[] = {REPLACE_IN_PLACE, REPLACE_MMAP};
+    EXIT_TYPES ret = SUCCESS;
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]) && ret == SUCCESS; m++)
+    {
+        // A fresh copy for every run, the previous one already replaced everything.
+        // The copy also leaves the file in the page cache, both runs start warm.
+        if ((ret = copy_file(path, bench_path, ctx->block_size)) != SUCCESS)
+        {
+            break;
+        }
+
+        ctx->mode = modes[m];
+        ctx->matches = 0;
+        ctx->block_start = 0;
+        ctx->sync = 1;
+        ret = (modes[m] == REPLACE_MMAP) ? replace_file_mmap(bench_path, ctx) : replace_file(bench_path, ctx);
+        unlink(bench_path);
+    }
+
+    free(bench_path);
+    return ret;
+}
+
+EXIT_TYPES copy_file(const char *path_src, const char *path_dst, size_t block_size)
+{
+    int fd_src = open(path_src, FILE_MODES_READ);
+    if (fd_src == ERR_GENERAL_ERROR)
+    {
+        log_error("Error opening the file");
+        return ERR_FILE_OPEN;
+    }
+    int fd_dst = open(path_dst, FILE_MODES_COPY, FILE_PERMISSIONS);
+    if (fd_dst == ERR_GENERAL_ERROR)
+    {
+        log_error("Error creating the bench file");
+        close_file_safer(fd_src);
+        return ERR_FILE_OPEN;
+    }
+
+    uint8_t *buf = malloc(block_size);
+    EXIT_TYPES ret = (buf != NULL) ? SUCCESS : ERR_ALLOC;
+    while (ret == SUCCESS)
+    {
+        ssize_t bytes_read = read(fd_src, buf, block_size);
+        if (bytes_read == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error reading the file");
+            ret = ERR_FILE_READ;
+        }
+        else if (bytes_read == 0) // EOF
+        {
+            break;
+        }
+        else
+        {
+            ret = write_all(fd_dst, buf, (size_t)bytes_read);
+        }
+    }
+
+    free(buf);
+    close_file_safer(fd_src);
+    if (close_file_safer(fd_dst) != SUCCESS && ret == SUCCESS)
+    {
+        ret = ERR_FILE_CLOSE;
+    }
+    return ret;
+}
+
+EXIT_TYPES on_match_count(void *ctx, const pattern_t *pattern, size_t end)
+{
+    (void)pattern;
+    (void)end;
+    ((replace_ctx_t *)ctx)->matches++;
+    return SUCCESS;
+}
+
+EXIT_TYPES on_match_in_place(void *ctx, const pattern_t *pattern, size_t end)
+{
+    replace_ctx_t *c = (replace_ctx_t *)ctx;
+    c->matches++;
+
+    // The match can start in an earlier block, the offset is taken from the end
+    const off_t offset = c->block_start + (off_t)end - (off_t)pattern->find_len;
+    size_t written = 0;
+    while (written < pattern->replace_len)
+    {
+        ssize_t ret = pwrite(c->fd, pattern->replace + written, pattern->replace_len - written, offset + (off_t)written);
+        if (ret == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error writing the replacement");
+            return ERR_FILE_WRITE;
+        }
+        written += (size_t)ret;
+    }
+    return SUCCESS;
+}
+
+EXIT_TYPES on_match_mmap(void *ctx, const pattern_t *pattern, size_t end)
+{
+    replace_ctx_t *c = (replace_ctx_t *)ctx;
+    c->matches++;
+
+    // Same length as the pattern, so the bytes behind it don't move
+    memcpy(c->map + end - pattern->find_len, pattern->replace, pattern->replace_len);
+    return SUCCESS;
+}
+
+EXIT_TYPES on_match_temp_file(void *ctx, const pattern_t *pattern, size_t end)
+{
+    replace_ctx_t *c = (replace_ctx_t *)ctx;
+    c->matches++;
+
+    const off_t match_end = c->block_start + (off_t)end;
+    EXIT_TYPES ret = emit_until(c, match_end - (off_t)pattern->find_len);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    c->emitted = match_end; // skip the pattern
+    return out_append(c, pattern->replace, pattern->replace_len);
+}
+
+EXIT_TYPES emit_until(replace_ctx_t *ctx, off_t until)
+{
+    EXIT_TYPES ret = SUCCESS;
+
+    // Held back bytes from before this block
+    if (ctx->emitted < ctx->block_start && ctx->emitted < until)
+    {
+        const off_t carry_end = (until < ctx->block_start) ? until : ctx->block_start;
+        ret = out_append(ctx, ctx->carry + (ctx->emitted - ctx->carry_start), (size_t)(carry_end - ctx->emitted));
+        ctx->emitted = carry_end;
+    }
+    if (ret == SUCCESS && ctx->emitted < until)
+    {
+        ret = out_append(ctx, ctx->block + (ctx->emitted - ctx->block_start), (size_t)(until - ctx->emitted));
+        ctx->emitted = until;
+    }
+    return ret;
+}
+
+EXIT_TYPES out_append(replace_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    if (ctx->out_len + len > ctx->block_size)
+    {
+        EXIT_TYPES ret = out_flush(ctx);
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+        if (len >= ctx->block_size) // bigger than the buffer, no point copying it
+        {
+            return write_all(ctx->fd_out, data, len);
+        }
+    }
+    memcpy(ctx->out + ctx->out_len, data, len);
+    ctx->out_len += len;
+    return SUCCESS;
+}
+
+EXIT_TYPES out_flush(replace_ctx_t *ctx)
+{
+    EXIT_TYPES ret = write_all(ctx->fd_out, ctx->out, ctx->out_len);
+    ctx->out_len = 0;
+    return ret;
+}
+
+EXIT_TYPES write_all(int fd, const uint8_t *buf, size_t len)
+{
+    size_t total_written = 0;
+
+    while (total_written < len)
+    {
+        ssize_t bytes_written = write(fd, buf + total_written, len - total_written);
+        if (bytes_written == ERR_GENERAL_ERROR)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log_error("Error writing to file");
+            return ERR_FILE_WRITE;
+        }
+        total_written += (size_t)bytes_written;
+    }
+    return SUCCESS;
+}
+
+size_t parse_size(const char *text)
+{
+    char *end = NULL;
+    size_t value = strtoul(text, &end, 10);
+
+    if (end != NULL && (*end == 'K' || *end == 'k'))
+    {
+        value *= 1024;
+    }
+    else if (end != NULL && (*end == 'M' || *end == 'm'))
+    {
+        value *= 1024 * 1024;
+    }
+    return value;
+}
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void log_result(const char *mode, size_t bytes, size_t matches, double seconds)
+{
+    char buf_log[SIZE_BUF_LOG] = {'\0'};
+    int len = snprintf(buf_log, sizeof(buf_log), "%s,%zu,%zu,%.4f,%.1f\n",
+                       mode, bytes, matches, seconds, (seconds > 0) ? (double)bytes / seconds / 1e6 : 0.0);
+    if (len > 0)
+    {
+        if (len > SIZE_BUF_LOG)
+        {
+            len = SIZE_BUF_LOG - 1;
+        }
+        (void)write(FD_STDOUT, buf_log, len);
+    }
+}
+
+EXIT_TYPES close_file_safer(int fd)
+{
+    if (close(fd) != SUCCESS)
+    {
+        log_error("Error closing file");
+        return ERR_FILE_CLOSE;
+    }
+    return SUCCESS;
+}
+
+void log_error(const char *msg_prefix)
+{
+    char buf[SIZE_BUF_ERROR_LOG] = {'\0'};
+    int len_written_to_buf = snprintf(buf, sizeof(buf), "%s: %s\n", msg_prefix, strerror(errno));
+    if (len_written_to_buf > 0)
+    {
+        if (len_written_to_buf > SIZE_BUF_ERROR_LOG)
+        {
+            len_written_to_buf = SIZE_BUF_ERROR_LOG - 1;
+        }
+        (void)write(FD_STDERR, buf, len_written_to_buf);
+    }
+}
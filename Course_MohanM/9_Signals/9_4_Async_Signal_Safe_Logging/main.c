@@ -0,0 +1,580 @@
+/* NOTES
+
+printer() in 9_2 / 9_3 is vsnprintf() + write(). write() may be called from a signal handler, vsnprintf() may not:
+it can take the locale lock, call malloc() for some conversions and isn't reentrant, so a signal that lands while
+the main code is inside printf() and whose handler calls printer() can deadlock or corrupt the stdio state.
+That's why 9_2 / 9_3 only set a flag in the handler.
+
+This example lets the handlers log for real:
+
+- Formatter: sig_fmt_t is a line on the stack, filled with sig_put_str() / sig_put_int() / sig_put_uint() /
+  sig_put_hex() / sig_put_pid() / sig_put_signame(). Only plain loops over the caller's bytes, no locale, no malloc,
+  no static state. Integers are rendered two digits at a time from a "00".."99" table.
+- Ring: SIG_RING_SLOTS preallocated lines. A producer (a handler, or the main code) reserves a slot with a
+  compare-and-swap on tail, copies its line in and publishes it through the slot's sequence number
+  (the bounded MPMC queue of D. Vyukov, here used with one consumer). Nothing ever waits:
+  a handler that interrupts another producer just takes the next slot, a full ring drops the line and counts it.
+  The atomics are lock free (checked at compile time), so they're fine in a handler, unlike a mutex.
+- Drain: sig_log_drain() runs outside the handlers (main loop). It writes out the published lines in order with
+  one writev() and gives the slots back. It stops at a slot that is reserved but not published yet.
+  Partial writes are resumed; on EAGAIN or an error the unwritten lines stay in the ring for the next call
+  (and if it stays that way, the ring fills and new lines are dropped and counted).
+
+The handlers of 9_2 / 9_3 stay as they are: they only set a volatile sig_atomic_t flag and printer() runs in the
+main flow after sigsuspend(), which is safe. This example is for when the handler itself has something to say.
+
+Demo: SIGALRM every millisecond (setitimer), children that send SIGUSR1 / SIGUSR2 bursts, SIGCHLD when they exit.
+Every handler logs a line, the main loop drains.
+
+--bench: the same line rendered + queued (and drained every 64 lines) vs the printer() way, outside of any handler.
+
+Usage: ./main [--bench]
+*/
+
+/* ---------- Libraries and Includes ---------- */
+
+#define _GNU_SOURCE // SA_SIGINFO fields, setitimer()
+#include <signal.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/uio.h>  // writev()
+#include <sys/time.h> // setitimer()
+#include <sys/wait.h>
+
+/* ---------- Enumerations and Defines ---------- */
+
+#define SIG_RING_SLOTS 256 // power of 2
+#define SIG_LINE_MAX 120   // slot = line + length + sequence, 128 bytes
+#define SIG_DRAIN_BATCH 64 // lines per writev()
+
+#define OPTION_BENCH "--bench"
+
+enum BUFFER_SIZES
+{
+    SIZE_BUF_LOG = 130,
+    SIZE_BUF_INT = 24 // 20 digits of 2^64 + sign
+};
+
+enum FD
+{
+    FD_STDIN = 0,
+    FD_STDOUT = 1,
+    FD_STDERR = 2
+};
+
+enum DEMO_SETTINGS
+{
+    DEMO_CHILDREN = 3,
+    DEMO_BURST = 20,           // signals per child
+    DEMO_TIMER_US = 1000,      // SIGALRM period
+    DEMO_RUN_MS = 200,
+    DEMO_DRAIN_PERIOD_US = 500,
+    BENCH_LINES = 1000000
+};
+
+_Static_assert(__atomic_always_lock_free(sizeof(size_t), 0), "the ring needs lock free size_t atomics to be used in a handler");
+
+/* ---------- Typedefs ---------- */
+
+typedef struct
+{
+    char text[SIG_LINE_MAX];
+    size_t len;
+} sig_fmt_t;
+
+typedef struct
+{
+    size_t seq; // == index: free for the producer of that lap, == index + 1: published
+    uint32_t len;
+    char text[SIG_LINE_MAX];
+} sig_slot_t;
+
+typedef struct
+{
+    sig_slot_t slots[SIG_RING_SLOTS];
+    size_t tail;        // next slot to reserve, shared by all producers
+    size_t head;        // next slot to drain, only the drainer
+    size_t head_offset; // bytes of the head slot written already (a partial write), only the drainer
+    size_t dropped;
+} sig_ring_t;
+
+/* ---------- Function Prototypes ---------- */
+
+static void sig_fmt_init(sig_fmt_t *f);
+static void sig_put_str(sig_fmt_t *f, const char *s);
+static void sig_put_int(sig_fmt_t *f, long long v);
+static void sig_put_uint(sig_fmt_t *f, unsigned long long v);
+static void sig_put_hex(sig_fmt_t *f, unsigned long long v);
+static void sig_put_pid(sig_fmt_t *f);
+static void sig_put_signame(sig_fmt_t *f, int signo);
+static int sig_log_commit(sig_ring_t *ring, const sig_fmt_t *f);
+static size_t sig_log_drain(sig_ring_t *ring, int fd);
+static void sig_ring_init(sig_ring_t *ring);
+
+static void signal_handler(int signo, siginfo_t *info, void *context);
+static int run_demo(void);
+static int run_bench(void);
+static void printer(const char *msg, ...);
+static double now_sec(void);
+
+/* ---------- Flags, Volatiles and Globals ---------- */
+
+static sig_ring_t g_ring; // static storage: preallocated before any handler can run
+static volatile sig_atomic_t children_left = DEMO_CHILDREN;
+static volatile sig_atomic_t alarm_count = 0;
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* ---------- Main Function ---------- */
+
+int main(int argc, char *argv[])
+{
+    sig_ring_init(&g_ring);
+
+    if (argc > 1 && strcmp(argv[1], OPTION_BENCH) == 0)
+    {
+        return run_bench();
+    }
+    return run_demo();
+}
+
+/* ---------- Function Implementations ---------- */
+
+static void signal_handler(int signo, siginfo_t *info, void *context)
+{
+    (void)context;
+    const int saved_errno = errno; // getpid() / waitpid() below must not change errno for the interrupted code
+
+    sig_fmt_t f;
+    sig_fmt_init(&f);
+    sig_put_str(&f, "[handler ");
+    sig_put_pid(&f);
+    sig_put_str(&f, "] ");
+    sig_put_signame(&f, signo);
+
+    switch (signo)
+    {
+    case SIGALRM:
+        alarm_count++;
+        sig_put_str(&f, " tick ");
+        sig_put_int(&f, alarm_count);
+        break;
+
+    case SIGUSR1:
+    case SIGUSR2:
+        sig_put_str(&f, " from pid ");
+        sig_put_int(&f, info->si_pid);
+        sig_put_str(&f, " value 0x");
+        sig_put_hex(&f, (unsigned long long)(uintptr_t)info->si_value.sival_ptr);
+        break;
+
+    case SIGCHLD:
+        // Reap here, several exits can be merged into one SIGCHLD
+        for (;;)
+        {
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, WNOHANG);
+            if (pid <= 0)
+            {
+                break;
+            }
+            children_left--;
+            sig_put_str(&f, " reaped ");
+            sig_put_int(&f, pid);
+            sig_put_str(&f, " status ");
+            sig_put_int(&f, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    sig_log_commit(&g_ring, &f);
+    errno = saved_errno;
+}
+
+static int run_demo(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = signal_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask); // handlers may interrupt each other, the ring is made for it
+
+    const int signals[] = {SIGALRM, SIGUSR1, SIGUSR2, SIGCHLD};
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++)
+    {
+        if (sigaction(signals[i], &sa, NULL) == -1)
+        {
+            printer("(%d) : Can't handle signal %d", getpid(), signals[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct itimerval timer = {.it_interval = {0, DEMO_TIMER_US}, .it_value = {0, DEMO_TIMER_US}};
+    if (setitimer(ITIMER_REAL, &timer, NULL) == -1)
+    {
+        printer("(%d) : Can't start the timer", getpid());
+        exit(EXIT_FAILURE);
+    }
+
+    const pid_t ppid = getpid();
+    for (int c = 0; c < DEMO_CHILDREN; c++)
+    {
+        pid_t cpid = fork();
+        switch (cpid)
+        {
+        case -1:
+            printer("(%d) : Fork failed", getpid());
+            exit(EXIT_FAILURE);
+
+        case 0:
+        {
+            struct itimerval off = {0};
+            setitimer(ITIMER_REAL, &off, NULL); // not inherited by fork(), but be explicit
+            for (int i = 0; i < DEMO_BURST; i++)
+            {
+                union sigval value = {.sival_ptr = (void *)(uintptr_t)((c << 8) | i)};
+                sigqueue(ppid, (i & 1) ? SIGUSR2 : SIGUSR1, value); // queued with a value, but still merged if pending
+                usleep(2000);
+            }
+            _exit(c);
+        }
+
+        default:
+            break;
+        }
+    }
+
+    // Main loop: only drains. nanosleep() returns early on every signal, that's fine.
+    const double t_end = now_sec() + DEMO_RUN_MS / 1000.0;
+    while (children_left > 0 || now_sec() < t_end)
+    {
+        struct timespec pause = {.tv_sec = 0, .tv_nsec = DEMO_DRAIN_PERIOD_US * 1000L};
+        nanosleep(&pause, NULL);
+        sig_log_drain(&g_ring, FD_STDOUT);
+    }
+
+    struct itimerval off = {0};
+    setitimer(ITIMER_REAL, &off, NULL);
+    sig_log_drain(&g_ring, FD_STDOUT);
+
+    printer("(%d) : %d ticks, %zu lines dropped (ring full), exiting.", getpid(), (int)alarm_count,
+            __atomic_load_n(&g_ring.dropped, __ATOMIC_RELAXED));
+    return EXIT_SUCCESS;
+}
+
+static int run_bench(void)
+{
+    int fd = FD_STDOUT;
+    if (isatty(FD_STDOUT))
+    {
+        printer("--bench writes %d lines, redirect stdout (e.g. > /dev/null)", BENCH_LINES);
+        return EXIT_FAILURE;
+    }
+
+    const pid_t pid = getpid();
+    double t_start = now_sec();
+    for (int i = 0; i < BENCH_LINES; i++)
+    {
+        sig_fmt_t f;
+        sig_fmt_init(&f);
+        sig_put_str(&f, "[bench ");
+        sig_put_int(&f, pid);
+        sig_put_str(&f, "] SIGUSR1 from pid ");
+        sig_put_int(&f, 4242);
+        sig_put_str(&f, " count ");
+        sig_put_int(&f, i);
+        sig_log_commit(&g_ring, &f);
+        if ((i & (SIG_DRAIN_BATCH - 1)) == SIG_DRAIN_BATCH - 1)
+        {
+            sig_log_drain(&g_ring, fd);
+        }
+    }
+    sig_log_drain(&g_ring, fd);
+    const double t_ring = now_sec() - t_start;
+
+    t_start = now_sec();
+    for (int i = 0; i < BENCH_LINES; i++)
+    {
+        printer("[bench %d] SIGUSR1 from pid %d count %d", pid, 4242, i);
+    }
+    const double t_printer = now_sec() - t_start;
+
+    fprintf(stderr, "path,lines,seconds,ns_per_line\nsig_fmt+ring,%d,%.4f,%.1f\nprinter,%d,%.4f,%.1f\n",
+            BENCH_LINES, t_ring, t_ring * 1e9 / BENCH_LINES, BENCH_LINES, t_printer, t_printer * 1e9 / BENCH_LINES);
+    return EXIT_SUCCESS;
+}
+
+static void sig_ring_init(sig_ring_t *ring)
+{
+    for (size_t i = 0; i < SIG_RING_SLOTS; i++)
+    {
+        ring->slots[i].seq = i;
+    }
+    ring->tail = ring->head = ring->head_offset = ring->dropped = 0;
+}
+
+static void sig_fmt_init(sig_fmt_t *f)
+{
+    f->len = 0;
+}
+
+static void sig_put_str(sig_fmt_t *f, const char *s)
+{
+    while (s != NULL && *s != '\0' && f->len < SIG_LINE_MAX - 1) // - 1: room for the '\n'
+    {
+        f->text[f->len++] = *s++;
+    }
+}
+
+static void sig_put_uint(sig_fmt_t *f, unsigned long long v)
+{
+    // Right to left into a small buffer, two digits per division
+    char buf[SIZE_BUF_INT];
+    size_t pos = sizeof(buf);
+    while (v >= 100)
+    {
+        const unsigned pair = (unsigned)(v % 100) * 2;
+        v /= 100;
+        buf[--pos] = DIGIT_PAIRS[pair + 1];
+        buf[--pos] = DIGIT_PAIRS[pair];
+    }
+    if (v >= 10)
+    {
+        buf[--pos] = DIGIT_PAIRS[v * 2 + 1];
+        buf[--pos] = DIGIT_PAIRS[v * 2];
+    }
+    else
+    {
+        buf[--pos] = (char)('0' + v);
+    }
+
+    while (pos < sizeof(buf) && f->len < SIG_LINE_MAX - 1)
+    {
+        f->text[f->len++] = buf[pos++];
+    }
+}
+
+static void sig_put_int(sig_fmt_t *f, long long v)
+{
+    if (v < 0)
+    {
+        sig_put_str(f, "-");
+        sig_put_uint(f, 0ULL - (unsigned long long)v); // also right for LLONG_MIN
+        return;
+    }
+    sig_put_uint(f, (unsigned long long)v);
+}
+
+static void sig_put_hex(sig_fmt_t *f, unsigned long long v)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    char buf[SIZE_BUF_INT];
+    size_t pos = sizeof(buf);
+    do
+    {
+        buf[--pos] = HEX_DIGITS[v & 0xf];
+        v >>= 4;
+    } while (v != 0);
+
+    while (pos < sizeof(buf) && f->len < SIG_LINE_MAX - 1)
+    {
+        f->text[f->len++] = buf[pos++];
+    }
+}
+
+static void sig_put_pid(sig_fmt_t *f)
+{
+    sig_put_int(f, getpid()); // getpid() is on the async-signal-safe list
+}
+
+static void sig_put_signame(sig_fmt_t *f, int signo)
+{
+    // strsignal() may use a static buffer and the locale, a switch of literals doesn't
+    switch (signo)
+    {
+    case SIGALRM:
+        sig_put_str(f, "SIGALRM");
+        break;
+    case SIGUSR1:
+        sig_put_str(f, "SIGUSR1");
+        break;
+    case SIGUSR2:
+        sig_put_str(f, "SIGUSR2");
+        break;
+    case SIGCHLD:
+        sig_put_str(f, "SIGCHLD");
+        break;
+    case SIGINT:
+        sig_put_str(f, "SIGINT");
+        break;
+    case SIGTERM:
+        sig_put_str(f, "SIGTERM");
+        break;
+    default:
+        sig_put_str(f, "signal ");
+        sig_put_int(f, signo);
+        break;
+    }
+}
+
+static int sig_log_commit(sig_ring_t *ring, const sig_fmt_t *f)
+{
+    size_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    sig_slot_t *slot;
+    for (;;)
+    {
+        slot = &ring->slots[pos & (SIG_RING_SLOTS - 1)];
+        const size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            // Free for this lap: take it. If another producer (or a handler on top of us) was faster, pos is reloaded.
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Still holds a line from the previous lap: full. Dropping beats waiting, a handler can't wait.
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+        else
+        {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    size_t len = 0;
+    for (; len < f->len; len++)
+    {
+        slot->text[len] = f->text[len];
+    }
+    slot->text[len++] = '\n';
+    slot->len = (uint32_t)len;
+
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE); // published, the drainer may read it now
+    return 0;
+}
+
+static size_t sig_log_drain(sig_ring_t *ring, int fd)
+{
+    size_t total = 0;
+    for (;;)
+    {
+        struct iovec iov[SIG_DRAIN_BATCH];
+        int count = 0;
+        size_t head = ring->head;
+
+        // In order, up to the first slot that is reserved but not published yet
+        while (count < SIG_DRAIN_BATCH)
+        {
+            sig_slot_t *slot = &ring->slots[head & (SIG_RING_SLOTS - 1)];
+            if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head + 1)
+            {
+                break;
+            }
+            iov[count].iov_base = slot->text;
+            iov[count].iov_len = slot->len;
+            count++;
+            head++;
+        }
+        if (count == 0)
+        {
+            return total;
+        }
+
+        // The first line may be half written by an earlier call
+        iov[0].iov_base = (char *)iov[0].iov_base + ring->head_offset;
+        iov[0].iov_len -= ring->head_offset;
+
+        // Partial writes are resumed, the handlers keep firing (EINTR) while we write
+        int first = 0;
+        int stalled = 0;
+        while (first < count)
+        {
+            ssize_t written = writev(fd, iov + first, count - first);
+            if (written == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                stalled = 1; // EAGAIN or an error: the rest stays queued for the next drain
+                break;
+            }
+            while (first < count && (size_t)written >= iov[first].iov_len)
+            {
+                written -= (ssize_t)iov[first].iov_len;
+                first++;
+            }
+            if (first < count)
+            {
+                iov[first].iov_base = (char *)iov[first].iov_base + written;
+                iov[first].iov_len -= (size_t)written;
+            }
+        }
+
+        // Give the written slots back for the next lap, remember how far into the next one we got
+        for (int i = 0; i < first; i++)
+        {
+            sig_slot_t *slot = &ring->slots[ring->head & (SIG_RING_SLOTS - 1)];
+            __atomic_store_n(&slot->seq, ring->head + SIG_RING_SLOTS, __ATOMIC_RELEASE);
+            ring->head++;
+        }
+        ring->head_offset = (first < count) ? ring->slots[ring->head & (SIG_RING_SLOTS - 1)].len - iov[first].iov_len : 0;
+        total += (size_t)first;
+
+        if (stalled)
+        {
+            return total;
+        }
+    }
+}
+
+static void printer(const char *msg, ...)
+{
+    va_list args;
+
+    char buf[SIZE_BUF_LOG] = {'\0'};
+
+    va_start(args, msg);
+    int bytes_written_to_buf = vsnprintf(buf, sizeof(buf), msg, args);
+    va_end(args);
+
+    if (bytes_written_to_buf > 0)
+    {
+        if (bytes_written_to_buf > SIZE_BUF_LOG)
+            bytes_written_to_buf = SIZE_BUF_LOG;
+
+        (void)write(FD_STDOUT, buf, bytes_written_to_buf);
+        (void)write(FD_STDOUT, "\n", 1);
+    }
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
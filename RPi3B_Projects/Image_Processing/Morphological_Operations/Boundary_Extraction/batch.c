@@ -0,0 +1,350 @@
+// ---- Libraries ----
+#include "batch.h"
+
+#include <dirent.h>   // opendir(), readdir()
+#include <fcntl.h>    // open(), posix_fadvise()
+#include <unistd.h>   // close()
+#include <sys/stat.h> // stat(), mkdir()
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread_pool.h"
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    char *name;
+    int base_len;   // name without the extension, the output is <base>.pgm
+    int out_taken;  // an earlier file (name order) already writes the same output
+    unsigned long long bytes;
+    RETURN_TYPES status;
+    double ms;
+} batch_file_t;
+
+typedef struct
+{
+    const batch_opts_t *opts;
+    batch_file_t *files;
+    unsigned long n_files;
+    unsigned long prefetch_depth;
+} batch_job_t;
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES batch_list_files(const batch_opts_t *opts, batch_file_t **files, unsigned long *n_files);
+static int batch_accepts(const batch_opts_t *opts, const char *name);
+static int batch_compare_names(const void *a, const void *b);
+static int batch_compare_bases(const void *a, const void *b);
+static RETURN_TYPES batch_mark_collisions(batch_file_t *files, const unsigned long n_files);
+static RETURN_TYPES batch_prepare_out_dir(const batch_opts_t *opts);
+static void batch_file_task(void *arg, unsigned long index);
+static void batch_prefetch(const batch_job_t *job, const unsigned long index);
+static RETURN_TYPES batch_write_summary(const batch_job_t *job, const batch_stats_t *stats);
+static void batch_free_files(batch_file_t *files, const unsigned long n_files);
+
+// ---- Function Implementations ----
+
+RETURN_TYPES batch_run(const batch_opts_t *opts, batch_stats_t *stats)
+{
+    if (opts == NULL || stats == NULL || opts->in_dir == NULL || opts->out_dir == NULL)
+    {
+        return ERR_ARGS;
+    }
+
+    batch_job_t job = {.opts = opts};
+    job.prefetch_depth = (opts->prefetch_depth > 0) ? opts->prefetch_depth : BATCH_PREFETCH_DEPTH_DEFAULT;
+
+    RETURN_TYPES ret = batch_prepare_out_dir(opts);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    if ((ret = batch_list_files(opts, &job.files, &job.n_files)) != SUCCESS)
+    {
+        return ret;
+    }
+    if ((ret = batch_mark_collisions(job.files, job.n_files)) != SUCCESS)
+    {
+        batch_free_files(job.files, job.n_files);
+        return ret;
+    }
+
+    thread_pool_t pool;
+    if ((ret = pool_create(&pool, opts->n_workers)) != SUCCESS)
+    {
+        batch_free_files(job.files, job.n_files);
+        return ret;
+    }
+
+    // The first window is prefetched up front, after that each task prefetches one file ahead
+    for (unsigned long i = 0; i < job.prefetch_depth && i < job.n_files; i++)
+    {
+        batch_prefetch(&job, i);
+    }
+
+    const double t0 = img_now_sec();
+    pool_run(&pool, batch_file_task, &job, job.n_files);
+    stats->seconds = img_now_sec() - t0;
+    pool_destroy(&pool);
+
+    unsigned long long bytes = 0;
+    stats->files_total = job.n_files;
+    stats->files_failed = 0;
+    for (unsigned long i = 0; i < job.n_files; i++)
+    {
+        // Like images_per_sec, only what was processed: a failed file may not have been read at all
+        if (job.files[i].status == SUCCESS)
+        {
+            bytes += job.files[i].bytes;
+        }
+        stats->files_failed += (job.files[i].status != SUCCESS);
+    }
+    stats->images_per_sec = (stats->seconds > 0) ? (double)(job.n_files - stats->files_failed) / stats->seconds : 0;
+    stats->mbytes_per_sec = (stats->seconds > 0) ? (double)bytes / stats->seconds / 1e6 : 0;
+
+    ret = batch_write_summary(&job, stats);
+    batch_free_files(job.files, job.n_files);
+    return ret;
+}
+
+static void batch_file_task(void *arg, unsigned long index)
+{
+    batch_job_t *job = arg;
+    batch_file_t *file = &job->files[index];
+
+    batch_prefetch(job, index + job->prefetch_depth);
+
+    // a.ppm and a.pgm would both end up as a.pgm, only the first one in name order is written
+    if (file->out_taken)
+    {
+        file->status = ERR_ARGS;
+        return;
+    }
+
+    char in_path[SIZE_BATCH_PATH] = {'\0'};
+    char out_path[SIZE_BATCH_PATH] = {'\0'};
+
+    // Output keeps the base name, always as PGM
+    int len_in = snprintf(in_path, sizeof(in_path), "%s/%s", job->opts->in_dir, file->name);
+    int len_out = snprintf(out_path, sizeof(out_path), "%s/%.*s.pgm", job->opts->out_dir, file->base_len, file->name);
+    if (len_in <= 0 || len_in >= SIZE_BATCH_PATH || len_out <= 0 || len_out >= SIZE_BATCH_PATH)
+    {
+        file->status = ERR_ARGS;
+        return;
+    }
+
+    const double t0 = img_now_sec();
+    file->status = pipeline_boundary_file(in_path, out_path, job->opts->raw, &job->opts->se);
+    file->ms = (img_now_sec() - t0) * 1e3;
+}
+
+static void batch_prefetch(const batch_job_t *job, const unsigned long index)
+{
+    if (index >= job->n_files)
+    {
+        return;
+    }
+
+    char path[SIZE_BATCH_PATH] = {'\0'};
+    int len = snprintf(path, sizeof(path), "%s/%s", job->opts->in_dir, job->files[index].name);
+    if (len <= 0 || len >= SIZE_BATCH_PATH)
+    {
+        return;
+    }
+
+    // WILLNEED starts async readahead of the whole file, the pages stay cached after close()
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return;
+    }
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+static RETURN_TYPES batch_list_files(const batch_opts_t *opts, batch_file_t **files, unsigned long *n_files)
+{
+    DIR *dir = opendir(opts->in_dir);
+    if (dir == NULL)
+    {
+        return ERR_FILE_OPEN;
+    }
+
+    unsigned long capacity = 64, count = 0;
+    batch_file_t *list = malloc(capacity * sizeof(batch_file_t));
+    if (list == NULL)
+    {
+        closedir(dir);
+        return ERR_ALLOC;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (!batch_accepts(opts, entry->d_name))
+        {
+            continue;
+        }
+
+        char path[SIZE_BATCH_PATH] = {'\0'};
+        int len = snprintf(path, sizeof(path), "%s/%s", opts->in_dir, entry->d_name);
+        struct stat st;
+        if (len <= 0 || len >= SIZE_BATCH_PATH || stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+        {
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            batch_file_t *grown = realloc(list, 2 * capacity * sizeof(batch_file_t));
+            if (grown == NULL)
+            {
+                batch_free_files(list, count);
+                closedir(dir);
+                return ERR_ALLOC;
+            }
+            list = grown;
+            capacity *= 2;
+        }
+
+        list[count].name = strdup(entry->d_name);
+        if (list[count].name == NULL)
+        {
+            batch_free_files(list, count);
+            closedir(dir);
+            return ERR_ALLOC;
+        }
+        const char *dot = strrchr(list[count].name, '.');
+        list[count].base_len = (dot != NULL) ? (int)(dot - list[count].name) : (int)strlen(list[count].name);
+        list[count].out_taken = 0;
+        list[count].bytes = (unsigned long long)st.st_size;
+        list[count].status = ERR_GENERAL; // not processed yet
+        list[count].ms = 0;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(list, count, sizeof(batch_file_t), batch_compare_names);
+    *files = list;
+    *n_files = count;
+    return SUCCESS;
+}
+
+static int batch_accepts(const batch_opts_t *opts, const char *name)
+{
+    if (name[0] == '.')
+    {
+        return 0;
+    }
+    if (opts->raw != NULL)
+    {
+        return 1;
+    }
+    const IMG_FORMATS format = img_format_from_path(name);
+    return format == IMG_FMT_PGM || format == IMG_FMT_PPM;
+}
+
+static int batch_compare_names(const void *a, const void *b)
+{
+    return strcmp(((const batch_file_t *)a)->name, ((const batch_file_t *)b)->name);
+}
+
+static int batch_compare_bases(const void *a, const void *b)
+{
+    const batch_file_t *fa = *(const batch_file_t *const *)a;
+    const batch_file_t *fb = *(const batch_file_t *const *)b;
+    const int len = (fa->base_len < fb->base_len) ? fa->base_len : fb->base_len;
+
+    int cmp = strncmp(fa->name, fb->name, (size_t)len);
+    if (cmp == 0)
+    {
+        cmp = (fa->base_len > fb->base_len) - (fa->base_len < fb->base_len);
+    }
+    return (cmp != 0) ? cmp : strcmp(fa->name, fb->name); // equal bases stay in name order
+}
+
+static RETURN_TYPES batch_mark_collisions(batch_file_t *files, const unsigned long n_files)
+{
+    if (n_files < 2)
+    {
+        return SUCCESS;
+    }
+
+    // Sorted by base name a.pgm / a.ppm are neighbours, everyone after the first of a run is skipped
+    batch_file_t **by_base = malloc(n_files * sizeof(batch_file_t *));
+    if (by_base == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    for (unsigned long i = 0; i < n_files; i++)
+    {
+        by_base[i] = &files[i];
+    }
+    qsort(by_base, n_files, sizeof(batch_file_t *), batch_compare_bases);
+
+    for (unsigned long i = 1; i < n_files; i++)
+    {
+        const batch_file_t *prev = by_base[i - 1];
+        by_base[i]->out_taken = (prev->base_len == by_base[i]->base_len && strncmp(prev->name, by_base[i]->name, (size_t)prev->base_len) == 0);
+    }
+    free(by_base);
+    return SUCCESS;
+}
+
+static RETURN_TYPES batch_prepare_out_dir(const batch_opts_t *opts)
+{
+    if (mkdir(opts->out_dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1 && errno != EEXIST)
+    {
+        return ERR_FILE_OPEN;
+    }
+
+    // Outputs inside in_dir would be picked up as inputs (raw mode) or overwrite them while mapped
+    struct stat st_in, st_out;
+    if (stat(opts->in_dir, &st_in) == -1 || stat(opts->out_dir, &st_out) == -1 || !S_ISDIR(st_out.st_mode))
+    {
+        return ERR_FILE_OPEN;
+    }
+    if (st_in.st_dev == st_out.st_dev && st_in.st_ino == st_out.st_ino)
+    {
+        return ERR_ARGS;
+    }
+    return SUCCESS;
+}
+
+static RETURN_TYPES batch_write_summary(const batch_job_t *job, const batch_stats_t *stats)
+{
+    char path[SIZE_BATCH_PATH] = {'\0'};
+    int len = snprintf(path, sizeof(path), "%s/%s", job->opts->out_dir, BATCH_SUMMARY_NAME);
+    if (len <= 0 || len >= SIZE_BATCH_PATH)
+    {
+        return ERR_ARGS;
+    }
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        return ERR_FILE_OPEN;
+    }
+
+    fprintf(f, "file,status,bytes,ms\n");
+    for (unsigned long i = 0; i < job->n_files; i++)
+    {
+        fprintf(f, "%s,%d,%llu,%.3f\n", job->files[i].name, job->files[i].status, job->files[i].bytes, job->files[i].ms);
+    }
+    fprintf(f, "# files=%lu failed=%lu seconds=%.3f images_per_sec=%.1f mb_per_sec=%.1f\n",
+            stats->files_total, stats->files_failed, stats->seconds, stats->images_per_sec, stats->mbytes_per_sec);
+
+    return (fclose(f) == 0) ? SUCCESS : ERR_GENERAL;
+}
+
+static void batch_free_files(batch_file_t *files, const unsigned long n_files)
+{
+    for (unsigned long i = 0; i < n_files; i++)
+    {
+        free(files[i].name);
+    }
+    free(files);
+}
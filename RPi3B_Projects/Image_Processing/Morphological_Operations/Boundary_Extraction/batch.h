@@ -0,0 +1,54 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* ------ Notes Section
+Batch mode: every image of a directory goes through pipeline_boundary_file() on the thread pool,
+one file per task. Files are handed out in name order, and whoever takes file i asks the kernel
+to start reading file i + prefetch_depth (posix_fadvise WILLNEED), so the disk works ahead of the CPUs.
+A CSV with one line per file (status, size, ms) is written next to the outputs.
+out_dir is created if missing and has to be a different directory than in_dir (ERR_ARGS otherwise).
+Outputs are <base>.pgm, so a.pgm and a.ppm collide: the first one in name order is processed,
+the others are listed with status ERR_ARGS.
+*/
+
+// ---- Libraries ----
+#include "img_common.h"
+#include "morph_gray.h"
+#include "pipeline.h"
+
+// ---- Enums and Defines ----
+
+#define BATCH_SUMMARY_NAME "batch_summary.csv"
+
+enum BATCH_SETTINGS
+{
+    BATCH_PREFETCH_DEPTH_DEFAULT = 4,
+    SIZE_BATCH_PATH = 4096
+};
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    const char *in_dir;
+    const char *out_dir;
+    unsigned long n_workers;      // 0 -> number of online cores
+    unsigned long prefetch_depth; // 0 -> BATCH_PREFETCH_DEPTH_DEFAULT
+    const img_raw_desc_t *raw;    // NULL -> only .pgm / .ppm files, otherwise every regular file is a raw frame
+    strel_t se;
+} batch_opts_t;
+
+typedef struct
+{
+    unsigned long files_total;
+    unsigned long files_failed;
+    double seconds;
+    double images_per_sec;
+    double mbytes_per_sec; // input bytes of the files that succeeded
+} batch_stats_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES batch_run(const batch_opts_t *opts, batch_stats_t *stats);
+
+#endif
@@ -0,0 +1,641 @@
+// ---- Libraries ----
+#include "bench.h"
+
+#include <linux/perf_event.h> // struct perf_event_attr
+#include <sys/syscall.h>      // SYS_perf_event_open, there is no glibc wrapper
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "img_gray.h"
+#include "img_color.h"
+#include "morph_bitpacked.h"
+#include "morph_gray.h"
+#include "morph_parallel.h"
+#include "morph_stream.h"
+#include "morph_derived.h"
+#include "morph_edt.h"
+#include "morph_rle.h"
+#include "thread_pool.h"
+#include "ccl.h"
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    unsigned long se_size;
+    strel_t se;
+
+    uint8_t *rgb; // also read as YUYV / RGB565, any bytes are valid pixels there
+    uint8_t *gray;
+    uint8_t *hsv;
+    uint8_t *out;
+    uint8_t *tmp;     // second frame for the chained two-pass references
+    uint8_t *mask_u8; // mask unpacked to 0 / 1
+    bitmask_t mask;
+    bitmask_t mask_out;
+    rle_mask_t rle;
+    rle_mask_t rle_out;
+    thread_pool_t *pool;
+    stream_boundary_t stream_gray;
+    stream_boundary_t stream_rgb;
+} bench_ctx_t;
+
+typedef void (*bench_fn)(bench_ctx_t *ctx);
+
+typedef struct
+{
+    const char *kernel;
+    const char *variant;
+    double bytes_per_pixel;
+    int threaded;
+    int only_3x3; // bit-packed engine is fixed to 3x3 elements
+    bench_fn fn;
+} bench_case_t;
+
+// ---- Function Prototypes ----
+
+static void run_erode(bench_ctx_t *ctx);
+static void run_dilate(bench_ctx_t *ctx);
+static void run_erode_threads(bench_ctx_t *ctx);
+static void run_dilate_threads(bench_ctx_t *ctx);
+static void run_erode_bitpacked(bench_ctx_t *ctx);
+static void run_boundary_bitpacked(bench_ctx_t *ctx);
+static void run_boundary_bitpacked_threads(bench_ctx_t *ctx);
+static void run_boundary_frame(bench_ctx_t *ctx);
+static void run_boundary_stream_gray(bench_ctx_t *ctx);
+static void run_boundary_stream_rgb(bench_ctx_t *ctx);
+static void run_rgb2gray(bench_ctx_t *ctx);
+static void run_yuyv2gray(bench_ctx_t *ctx);
+static void run_rgb5652gray(bench_ctx_t *ctx);
+static void run_rgb2hsv(bench_ctx_t *ctx);
+static void run_open_two_pass(bench_ctx_t *ctx);
+static void run_open_banded(bench_ctx_t *ctx);
+static void run_tophat_banded(bench_ctx_t *ctx);
+static void run_gradient_two_pass(bench_ctx_t *ctx);
+static void run_gradient_fused(bench_ctx_t *ctx);
+static void run_erode_disk_edt(bench_ctx_t *ctx);
+static void run_erode_disk_edt_threads(bench_ctx_t *ctx);
+static void run_erode_disk_direct(bench_ctx_t *ctx);
+static void run_erode_rle(bench_ctx_t *ctx);
+static void run_dilate_rle(bench_ctx_t *ctx);
+static void run_boundary_rle(bench_ctx_t *ctx);
+static void run_ccl_u8(bench_ctx_t *ctx);
+static void run_ccl_bitpacked(bench_ctx_t *ctx);
+static void run_ccl_bitpacked_threads(bench_ctx_t *ctx);
+
+static void bench_measure(bench_ctx_t *ctx, const bench_case_t *c, const int perf_fd, const unsigned long threads);
+static int perf_open_cycles(void);
+static RETURN_TYPES bench_ctx_create(bench_ctx_t *ctx, const unsigned long w, const unsigned long h);
+static void bench_ctx_destroy(bench_ctx_t *ctx);
+
+// ---- Globals ----
+
+static const unsigned long BENCH_SIZES[][2] = {{64, 64}, {256, 256}, {640, 480}, {1920, 1080}, {3840, 2160}, {7680, 4320}};
+static const unsigned long BENCH_SE_SIZES[] = {3, 7, 15, 31};
+
+// 3x3 square, same element as strel_rect(3, 3) so the bit-packed and grayscale rows compare 1:1
+static const bool SQUARE_3X3[SE_3X3][SE_3X3] = {{1, 1, 1}, {1, 1, 1}, {1, 1, 1}};
+
+static const bench_case_t BENCH_MORPH_CASES[] = {
+    {"erode", "vhgw", 2.0, 0, 0, run_erode},
+    {"erode", "vhgw_threads", 2.0, 1, 0, run_erode_threads},
+    {"erode", "bitpacked", 0.25, 0, 1, run_erode_bitpacked},
+    {"dilate", "vhgw", 2.0, 0, 0, run_dilate},
+    {"dilate", "vhgw_threads", 2.0, 1, 0, run_dilate_threads},
+    {"boundary", "frame_gray", 3.0, 0, 0, run_boundary_frame},
+    {"boundary", "stream_gray", 2.0, 0, 0, run_boundary_stream_gray},
+    {"boundary", "stream_rgb", 4.0, 0, 0, run_boundary_stream_rgb},
+    {"boundary", "bitpacked", 0.25, 0, 1, run_boundary_bitpacked},
+    {"boundary", "bitpacked_threads", 0.25, 1, 1, run_boundary_bitpacked_threads},
+    {"open", "two_pass", 4.0, 0, 0, run_open_two_pass},
+    {"open", "banded", 2.0, 0, 0, run_open_banded},
+    {"tophat_white", "banded", 2.0, 0, 0, run_tophat_banded},
+    {"gradient", "two_pass", 5.0, 0, 0, run_gradient_two_pass},
+    {"gradient", "fused", 2.0, 0, 0, run_gradient_fused},
+    {"erode_disk", "edt", 0.25, 0, 0, run_erode_disk_edt}, // disk radius = se_size / 2
+    {"erode_disk", "edt_threads", 0.25, 1, 0, run_erode_disk_edt_threads},
+    {"erode_disk", "direct_rows", 2.0, 0, 0, run_erode_disk_direct},
+    // RLE traffic follows the runs, not the pixels
+    {"erode", "rle", RLE_BENCH_BPP, 0, 0, run_erode_rle},
+    {"dilate", "rle", RLE_BENCH_BPP, 0, 0, run_dilate_rle},
+    {"boundary", "rle", RLE_BENCH_BPP, 0, 0, run_boundary_rle},
+};
+
+// Run once per implementation, the variant column is the implementation name
+static const bench_case_t BENCH_COLOR_CASES[] = {
+    {"yuyv2gray", NULL, 3.0, 0, 0, run_yuyv2gray},
+    {"rgb5652gray", NULL, 3.0, 0, 0, run_rgb5652gray},
+    {"rgb2hsv", NULL, 6.0, 0, 0, run_rgb2hsv},
+};
+
+// Labeling has no structuring element, it runs once per size on the thresholded blobs (8-connectivity, no label image)
+static const bench_case_t BENCH_CCL_CASES[] = {
+    {"ccl", "u8", 1.0, 0, 0, run_ccl_u8},
+    {"ccl", "bitpacked", 0.125, 0, 0, run_ccl_bitpacked},
+    {"ccl", "bitpacked_threads", 0.125, 1, 0, run_ccl_bitpacked_threads},
+};
+
+// ---- Function Implementations ----
+
+int bench_suite(const unsigned long max_width, const unsigned long n_threads)
+{
+    thread_pool_t pool;
+    if (pool_create(&pool, n_threads) != SUCCESS)
+    {
+        perror("pool_create");
+        return ERR_GENERAL;
+    }
+
+    const int perf_fd = perf_open_cycles();
+    if (perf_fd == -1)
+    {
+        fprintf(stderr, "perf_event_open not available, cycles_per_pixel stays empty\n");
+    }
+
+    printf("kernel,variant,width,height,se_size,threads,ms,mpix_per_s,bytes_per_pixel,gb_per_s,cycles_per_pixel\n");
+
+    for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]); s++)
+    {
+        const unsigned long w = BENCH_SIZES[s][0], h = BENCH_SIZES[s][1];
+        if (max_width > 0 && w > max_width)
+        {
+            break;
+        }
+
+        bench_ctx_t ctx;
+        if (bench_ctx_create(&ctx, w, h) != SUCCESS)
+        {
+            perror("bench_ctx_create");
+            break;
+        }
+        ctx.pool = &pool;
+
+        // rgb2gray: every implementation this CPU supports
+        ctx.se_size = 0;
+        for (int impl = 0; impl < GRAY_IMPL_COUNT; impl++)
+        {
+            if (rgb2gray_force_impl((GRAY_IMPLS)impl) != 0)
+            {
+                continue;
+            }
+            const bench_case_t c = {"rgb2gray", rgb2gray_impl_name((GRAY_IMPLS)impl), 4.0, 0, 0, run_rgb2gray};
+            bench_measure(&ctx, &c, perf_fd, 1);
+        }
+        rgb2gray_init();
+
+        for (int impl = 0; impl < GRAY_IMPL_COUNT; impl++)
+        {
+            if (color_force_impl((GRAY_IMPLS)impl) != 0)
+            {
+                continue;
+            }
+            for (size_t i = 0; i < sizeof(BENCH_COLOR_CASES) / sizeof(BENCH_COLOR_CASES[0]); i++)
+            {
+                bench_case_t c = BENCH_COLOR_CASES[i];
+                c.variant = rgb2gray_impl_name((GRAY_IMPLS)impl);
+                bench_measure(&ctx, &c, perf_fd, 1);
+            }
+        }
+        color_init();
+
+        for (size_t i = 0; i < sizeof(BENCH_CCL_CASES) / sizeof(BENCH_CCL_CASES[0]); i++)
+        {
+            const bench_case_t *c = &BENCH_CCL_CASES[i];
+            bench_measure(&ctx, c, perf_fd, c->threaded ? pool.n_threads : 1);
+        }
+
+        for (size_t k = 0; k < sizeof(BENCH_SE_SIZES) / sizeof(BENCH_SE_SIZES[0]); k++)
+        {
+            ctx.se_size = BENCH_SE_SIZES[k];
+            ctx.se = strel_rect(ctx.se_size, ctx.se_size);
+            if (ctx.se_size >= h)
+            {
+                continue;
+            }
+
+            if (stream_boundary_create(&ctx.stream_gray, w, h, CH_GRAY, &ctx.se) != SUCCESS ||
+                stream_boundary_create(&ctx.stream_rgb, w, h, CH_RGB, &ctx.se) != SUCCESS)
+            {
+                perror("stream_boundary_create");
+                stream_boundary_destroy(&ctx.stream_gray);
+                continue;
+            }
+
+            for (size_t i = 0; i < sizeof(BENCH_MORPH_CASES) / sizeof(BENCH_MORPH_CASES[0]); i++)
+            {
+                const bench_case_t *c = &BENCH_MORPH_CASES[i];
+                if (c->only_3x3 && ctx.se_size != SE_3X3)
+                {
+                    continue;
+                }
+                bench_measure(&ctx, c, perf_fd, c->threaded ? pool.n_threads : 1);
+            }
+
+            stream_boundary_destroy(&ctx.stream_gray);
+            stream_boundary_destroy(&ctx.stream_rgb);
+        }
+
+        bench_ctx_destroy(&ctx);
+        fflush(stdout);
+    }
+
+    if (perf_fd != -1)
+    {
+        close(perf_fd);
+    }
+    pool_destroy(&pool);
+    return SUCCESS;
+}
+
+int bench_thread_scaling(const unsigned long max_threads)
+{
+    const unsigned long w = BENCH_SCALING_W, h = BENCH_SCALING_H, n = w * h;
+    const strel_t se = strel_rect(BENCH_SCALING_SE_SIZE, BENCH_SCALING_SE_SIZE);
+
+    uint8_t *src = malloc(n);
+    uint8_t *ref = malloc(n);
+    uint8_t *dst = malloc(n);
+    if (src == NULL || ref == NULL || dst == NULL)
+    {
+        perror("malloc");
+        free(src);
+        free(ref);
+        free(dst);
+        return ERR_ALLOC;
+    }
+
+    srand(1);
+    for (unsigned long i = 0; i < n; i++)
+    {
+        src[i] = (uint8_t)rand();
+    }
+    gray_erode(src, ref, w, h, &se);
+
+    printf("threads,ms_per_frame,mpix_per_s,speedup,matches_single_thread\n");
+
+    double t_single = 0;
+    for (unsigned long t = 1; t <= max_threads; t++)
+    {
+        thread_pool_t pool;
+        if (pool_create(&pool, t) != SUCCESS)
+        {
+            perror("pool_create");
+            break;
+        }
+
+        gray_morph_parallel(&pool, src, dst, w, h, &se, MORPH_ERODE); // warm-up, also faults the pages in
+
+        const double t0 = img_now_sec();
+        for (int r = 0; r < BENCH_SCALING_REPEAT; r++)
+        {
+            gray_morph_parallel(&pool, src, dst, w, h, &se, MORPH_ERODE);
+        }
+        const double per_frame = (img_now_sec() - t0) / BENCH_SCALING_REPEAT;
+        if (t == 1)
+        {
+            t_single = per_frame;
+        }
+
+        printf("%lu,%.3f,%.1f,%.2f,%s\n", t, per_frame * 1e3, (double)n / per_frame / 1e6, t_single / per_frame, (memcmp(ref, dst, n) == 0) ? "yes" : "no");
+        pool_destroy(&pool);
+    }
+
+    free(src);
+    free(ref);
+    free(dst);
+    return SUCCESS;
+}
+
+static void bench_measure(bench_ctx_t *ctx, const bench_case_t *c, const int perf_fd, const unsigned long threads)
+{
+    c->fn(ctx); // warm-up
+
+    double best = 1e30, total = 0;
+    long long best_cycles = -1;
+
+    for (int rep = 0; rep < BENCH_MAX_REPS && total < BENCH_MIN_SECONDS; rep++)
+    {
+        if (perf_fd != -1)
+        {
+            ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        const double t0 = img_now_sec();
+        c->fn(ctx);
+        const double dt = img_now_sec() - t0;
+
+        long long cycles = -1;
+        if (perf_fd != -1)
+        {
+            ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(perf_fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+            {
+                cycles = -1;
+            }
+        }
+
+        total += dt;
+        if (dt < best)
+        {
+            best = dt;
+            best_cycles = cycles;
+        }
+    }
+
+    const double pixels = (double)ctx->w * (double)ctx->h;
+    const double mpix_per_s = pixels / best / 1e6;
+
+    printf("%s,%s,%lu,%lu,%lu,%lu,%.4f,%.1f,%.2f,%.2f,", c->kernel, c->variant, ctx->w, ctx->h, ctx->se_size, threads,
+           best * 1e3, mpix_per_s, c->bytes_per_pixel, mpix_per_s * c->bytes_per_pixel / 1e3);
+    if (best_cycles >= 0 && !c->threaded)
+    {
+        printf("%.2f", (double)best_cycles / pixels);
+    }
+    printf("\n");
+}
+
+static int perf_open_cycles(void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // this thread, any CPU
+}
+
+static RETURN_TYPES bench_ctx_create(bench_ctx_t *ctx, const unsigned long w, const unsigned long h)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->w = w;
+    ctx->h = h;
+    ctx->rgb = malloc(w * h * CH_RGB);
+    ctx->gray = malloc(w * h);
+    ctx->hsv = malloc(w * h * CH_RGB);
+    ctx->out = malloc(w * h);
+    ctx->tmp = malloc(w * h);
+    ctx->mask_u8 = malloc(w * h);
+    if (ctx->rgb == NULL || ctx->gray == NULL || ctx->hsv == NULL || ctx->out == NULL || ctx->tmp == NULL || ctx->mask_u8 == NULL ||
+        bitmask_create(&ctx->mask, w, h) != SUCCESS || bitmask_create(&ctx->mask_out, w, h) != SUCCESS ||
+        rle_create(&ctx->rle, w, h) != SUCCESS || rle_create(&ctx->rle_out, w, h) != SUCCESS)
+    {
+        bench_ctx_destroy(ctx);
+        return ERR_ALLOC;
+    }
+
+    // Blobs rather than noise, so the binary mask has real objects with boundaries
+    srand(1);
+    for (unsigned long i = 0; i < w * h * CH_RGB; i++)
+    {
+        ctx->rgb[i] = (uint8_t)rand();
+    }
+    for (unsigned long y = 0; y < h; y++)
+    {
+        for (unsigned long x = 0; x < w; x++)
+        {
+            ctx->gray[y * w + x] = (uint8_t)((((x / BENCH_CELL_W) ^ (y / BENCH_CELL_H)) & 1u) ? 200 + (rand() & 31) : (rand() & 31));
+        }
+    }
+    // bitmask_pack_u8() takes any non-zero byte as foreground: threshold first, or the dark noise counts too
+    for (unsigned long i = 0; i < w * h; i++)
+    {
+        ctx->mask_u8[i] = (ctx->gray[i] >= 128) ? 1 : 0;
+    }
+    bitmask_pack_u8(ctx->mask_u8, &ctx->mask);
+    if (rle_from_bitmask(&ctx->mask, &ctx->rle) != SUCCESS)
+    {
+        bench_ctx_destroy(ctx);
+        return ERR_ALLOC;
+    }
+    return SUCCESS;
+}
+
+static void bench_ctx_destroy(bench_ctx_t *ctx)
+{
+    free(ctx->rgb);
+    free(ctx->gray);
+    free(ctx->hsv);
+    free(ctx->out);
+    free(ctx->tmp);
+    free(ctx->mask_u8);
+    bitmask_destroy(&ctx->mask);
+    bitmask_destroy(&ctx->mask_out);
+    rle_destroy(&ctx->rle);
+    rle_destroy(&ctx->rle_out);
+    ctx->rgb = ctx->gray = ctx->hsv = ctx->out = ctx->tmp = ctx->mask_u8 = NULL;
+}
+
+static void run_rgb2gray(bench_ctx_t *ctx)
+{
+    rgb2gray_u8(ctx->rgb, ctx->out, ctx->w, ctx->h);
+}
+
+static void run_yuyv2gray(bench_ctx_t *ctx)
+{
+    yuyv2gray_u8(ctx->rgb, ctx->out, ctx->w, ctx->h);
+}
+
+static void run_rgb5652gray(bench_ctx_t *ctx)
+{
+    rgb5652gray_u8(ctx->rgb, ctx->out, ctx->w, ctx->h);
+}
+
+static void run_rgb2hsv(bench_ctx_t *ctx)
+{
+    rgb2hsv_u8(ctx->rgb, ctx->hsv, ctx->w, ctx->h);
+}
+
+static void run_erode(bench_ctx_t *ctx)
+{
+    gray_erode(ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se);
+}
+
+static void run_dilate(bench_ctx_t *ctx)
+{
+    gray_dilate(ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se);
+}
+
+static void run_erode_threads(bench_ctx_t *ctx)
+{
+    gray_morph_parallel(ctx->pool, ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se, MORPH_ERODE);
+}
+
+static void run_dilate_threads(bench_ctx_t *ctx)
+{
+    gray_morph_parallel(ctx->pool, ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se, MORPH_DILATE);
+}
+
+static void run_erode_bitpacked(bench_ctx_t *ctx)
+{
+    bitmask_erode(&ctx->mask, &ctx->mask_out, SQUARE_3X3);
+}
+
+static void run_boundary_bitpacked(bench_ctx_t *ctx)
+{
+    bitmask_boundary(&ctx->mask, &ctx->mask_out, SQUARE_3X3, BOUNDARY_INNER);
+}
+
+static void run_boundary_bitpacked_threads(bench_ctx_t *ctx)
+{
+    bitmask_boundary_parallel(ctx->pool, &ctx->mask, &ctx->mask_out, SQUARE_3X3, BOUNDARY_INNER);
+}
+
+static void run_boundary_frame(bench_ctx_t *ctx)
+{
+    // Full-frame reference: eroded frame first, then a second sweep for the subtraction
+    gray_erode(ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se);
+    const unsigned long n = ctx->w * ctx->h;
+    for (unsigned long i = 0; i < n; i++)
+    {
+        ctx->out[i] = (uint8_t)(ctx->gray[i] - ctx->out[i]);
+    }
+}
+
+static void run_open_two_pass(bench_ctx_t *ctx)
+{
+    gray_erode(ctx->gray, ctx->tmp, ctx->w, ctx->h, &ctx->se);
+    gray_dilate(ctx->tmp, ctx->out, ctx->w, ctx->h, &ctx->se);
+}
+
+static void run_open_banded(bench_ctx_t *ctx)
+{
+    gray_morph_derived(NULL, ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se, MORPH_OPEN);
+}
+
+static void run_tophat_banded(bench_ctx_t *ctx)
+{
+    gray_morph_derived(NULL, ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se, MORPH_TOPHAT_WHITE);
+}
+
+static void run_gradient_two_pass(bench_ctx_t *ctx)
+{
+    gray_erode(ctx->gray, ctx->tmp, ctx->w, ctx->h, &ctx->se);
+    gray_dilate(ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se);
+    const unsigned long n = ctx->w * ctx->h;
+    for (unsigned long i = 0; i < n; i++)
+    {
+        ctx->out[i] = (uint8_t)(ctx->out[i] - ctx->tmp[i]);
+    }
+}
+
+static void run_gradient_fused(bench_ctx_t *ctx)
+{
+    gray_gradient(ctx->gray, ctx->out, ctx->w, ctx->h, &ctx->se);
+}
+
+static void run_erode_disk_edt(bench_ctx_t *ctx)
+{
+    bitmask_erode_disk(NULL, &ctx->mask, &ctx->mask_out, ctx->se_size / 2);
+}
+
+static void run_erode_disk_edt_threads(bench_ctx_t *ctx)
+{
+    bitmask_erode_disk(ctx->pool, &ctx->mask, &ctx->mask_out, ctx->se_size / 2);
+}
+
+static void run_erode_disk_direct(bench_ctx_t *ctx)
+{
+    // Reference: the disk as 2r + 1 horizontal lines, one van Herk/Gil-Werman erosion per line, O(r) per pixel
+    const unsigned long w = ctx->w, h = ctx->h, r = ctx->se_size / 2;
+    uint8_t *scratch = malloc(gray_line_scratch_size(w, 2 * r + 1));
+    uint8_t *line = malloc(w);
+    if (scratch == NULL || line == NULL)
+    {
+        free(scratch);
+        free(line);
+        return;
+    }
+
+    for (unsigned long y = 0; y < h; y++)
+    {
+        uint8_t *out = ctx->out + y * w;
+        memset(out, 1, w);
+
+        for (long dy = -(long)r; dy <= (long)r; dy++)
+        {
+            const long yy = (long)y + dy;
+            if (yy < 0 || yy >= (long)h)
+            {
+                continue; // outside of the image is foreground for erosion
+            }
+
+            unsigned long a = r;
+            while (a * a > r * r - (unsigned long)(dy * dy))
+            {
+                a--;
+            }
+            gray_line_1d(ctx->mask_u8 + (unsigned long)yy * w, line, w, 2 * a + 1, MORPH_ERODE, scratch);
+            for (unsigned long x = 0; x < w; x++)
+            {
+                out[x] = (line[x] < out[x]) ? line[x] : out[x];
+            }
+        }
+    }
+
+    free(scratch);
+    free(line);
+}
+
+static void run_boundary_stream_gray(bench_ctx_t *ctx)
+{
+    stream_boundary_frame(&ctx->stream_gray, ctx->gray, ctx->out);
+}
+
+static void run_boundary_stream_rgb(bench_ctx_t *ctx)
+{
+    stream_boundary_frame(&ctx->stream_rgb, ctx->rgb, ctx->out);
+}
+
+static void run_erode_rle(bench_ctx_t *ctx)
+{
+    rle_erode(&ctx->rle, &ctx->rle_out, &ctx->se);
+}
+
+static void run_dilate_rle(bench_ctx_t *ctx)
+{
+    rle_dilate(&ctx->rle, &ctx->rle_out, &ctx->se);
+}
+
+static void run_boundary_rle(bench_ctx_t *ctx)
+{
+    rle_boundary(&ctx->rle, &ctx->rle_out, &ctx->se, BOUNDARY_INNER);
+}
+
+static void run_ccl_u8(bench_ctx_t *ctx)
+{
+    // Any non-zero pixel is foreground for the labeler, so it reads the unpacked mask, not the gray blobs
+    ccl_result_t res;
+    if (ccl_label_u8(NULL, ctx->mask_u8, ctx->w, ctx->h, CCL_CONN_8, NULL, &res) == SUCCESS)
+    {
+        ccl_result_destroy(&res);
+    }
+}
+
+static void run_ccl_bitpacked(bench_ctx_t *ctx)
+{
+    ccl_result_t res;
+    if (ccl_label_bitmask(NULL, &ctx->mask, CCL_CONN_8, NULL, &res) == SUCCESS)
+    {
+        ccl_result_destroy(&res);
+    }
+}
+
+static void run_ccl_bitpacked_threads(bench_ctx_t *ctx)
+{
+    ccl_result_t res;
+    if (ccl_label_bitmask(ctx->pool, &ctx->mask, CCL_CONN_8, NULL, &res) == SUCCESS)
+    {
+        ccl_result_destroy(&res);
+    }
+}
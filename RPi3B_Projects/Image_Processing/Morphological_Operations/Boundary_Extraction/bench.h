@@ -0,0 +1,40 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/* ------ Notes Section
+Benchmarks on synthetic frames, CSV on stdout so runs can be diffed / plotted.
+Columns: kernel,variant,width,height,se_size,threads,ms,mpix_per_s,bytes_per_pixel,gb_per_s,cycles_per_pixel
+- ms is the best of the repetitions (the least disturbed run)
+- bytes_per_pixel is the minimum traffic of the kernel (input read once + output written once),
+  so gb_per_s can be put next to the memory bandwidth of the machine, roofline-style
+- cycles_per_pixel comes from perf_event_open (user-space cycles of the calling thread),
+  empty when perf events are not allowed (perf_event_paranoid) or for multi-threaded variants
+*/
+
+// ---- Libraries ----
+#include "img_common.h"
+
+// ---- Enums ----
+
+enum BENCH_SETTINGS
+{
+    BENCH_SCALING_W = 3840, // 4K UHD
+    BENCH_SCALING_H = 2160,
+    BENCH_SCALING_SE_SIZE = 15,
+    BENCH_SCALING_REPEAT = 5,
+    BENCH_MAX_REPS = 50,
+    BENCH_CELL_W = 17, // the synthetic frame is a checkerboard of bright / dark cells, this size
+    BENCH_CELL_H = 13
+};
+
+#define BENCH_MIN_SECONDS 0.2
+// Bright cells alternate with dark ones along a row, so one foreground run per 2 * BENCH_CELL_W pixels,
+// an 8 byte rle_run_t read and one written per run (~0.47 B/px)
+#define RLE_BENCH_BPP (2.0 * 8.0 / (2.0 * BENCH_CELL_W))
+
+// ---- Function Prototypes ----
+
+int bench_suite(const unsigned long max_width, const unsigned long n_threads); // max_width 0 -> up to 8K, n_threads 0 -> all cores
+int bench_thread_scaling(const unsigned long max_threads);                     // 4K erosion, 1..max_threads workers
+
+#endif
@@ -0,0 +1,449 @@
+// ---- Libraries ----
+#include "ccl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "morph_parallel.h" // band_rows_for()
+
+// ---- Enums ----
+
+enum CCL_SETTINGS
+{
+    CCL_RUNS_INITIAL = 256 // per band, doubled when full
+};
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    uint32_t x0;
+    uint32_t x1; // exclusive
+    uint32_t y;
+    uint32_t overlap_up; // pixels of the run with a foreground pixel right above it
+} ccl_run_t;
+
+typedef struct
+{
+    unsigned long y0;
+    unsigned long y1;
+    ccl_run_t *runs;
+    uint32_t *parent; // band-local run ids in pass 1
+    unsigned long n_runs;
+    unsigned long capacity;
+    unsigned long first_row_end;  // runs of row y0 are [0, first_row_end)
+    unsigned long last_row_begin; // runs of row y1 - 1 are [last_row_begin, n_runs)
+    unsigned long base;           // global id of runs[0]
+    RETURN_TYPES result;
+} ccl_band_t;
+
+typedef struct
+{
+    const uint8_t *img;    // u8 input
+    const bitmask_t *mask; // or bit-packed input
+    unsigned long w;
+    unsigned long h;
+    uint32_t touch; // 0: runs must share a column (4-conn), 1: a diagonal is enough (8-conn)
+    unsigned long band_rows;
+    unsigned long n_bands;
+    ccl_band_t *bands;
+    const uint32_t *run_labels; // pass 2, global run id -> label
+    uint32_t *labels;
+} ccl_job_t;
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES ccl_label(thread_pool_t *pool, ccl_job_t *job, const unsigned long bytes_per_row, ccl_result_t *res);
+static void ccl_run_tasks(thread_pool_t *pool, pool_task_fn fn, ccl_job_t *job);
+static void ccl_band_task(void *arg, unsigned long index);
+static void ccl_paint_task(void *arg, unsigned long index);
+static RETURN_TYPES band_push_run(ccl_band_t *band, const unsigned long x0, const unsigned long x1, const unsigned long y);
+static RETURN_TYPES band_runs_u8(ccl_band_t *band, const uint8_t *row, const unsigned long w, const unsigned long y);
+static RETURN_TYPES band_runs_bitmask(ccl_band_t *band, const bitmask_t *mask, const unsigned long y);
+static void merge_rows(const ccl_run_t *prev, const unsigned long n_prev, const unsigned long prev_id, ccl_run_t *cur, const unsigned long n_cur, const unsigned long cur_id, uint32_t *parent, const uint32_t touch);
+static RETURN_TYPES collect_components(const ccl_job_t *job, const uint32_t *run_labels, const unsigned long n_labels, ccl_result_t *res);
+static void ccl_free_bands(ccl_job_t *job);
+
+static inline uint32_t uf_find(uint32_t *parent, uint32_t i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]]; // path halving
+        i = parent[i];
+    }
+    return i;
+}
+
+static inline void uf_union(uint32_t *parent, const uint32_t a, const uint32_t b)
+{
+    const uint32_t ra = uf_find(parent, a);
+    const uint32_t rb = uf_find(parent, b);
+
+    // The smaller id stays the root, so parent[i] <= i always holds
+    if (ra < rb)
+    {
+        parent[rb] = ra;
+    }
+    else if (rb < ra)
+    {
+        parent[ra] = rb;
+    }
+}
+
+// ---- Function Implementations ----
+
+RETURN_TYPES ccl_label_u8(thread_pool_t *pool, const uint8_t *img, const unsigned long w, const unsigned long h, CCL_CONNECTIVITY conn, uint32_t *labels, ccl_result_t *res)
+{
+    if (img == NULL || res == NULL || w == 0 || h == 0 || w >= UINT32_MAX || h >= UINT32_MAX || (conn != CCL_CONN_4 && conn != CCL_CONN_8))
+    {
+        return ERR_ARGS;
+    }
+
+    ccl_job_t job = {.img = img, .w = w, .h = h, .touch = (conn == CCL_CONN_8), .labels = labels};
+    return ccl_label(pool, &job, w, res);
+}
+
+RETURN_TYPES ccl_label_bitmask(thread_pool_t *pool, const bitmask_t *mask, CCL_CONNECTIVITY conn, uint32_t *labels, ccl_result_t *res)
+{
+    if (mask == NULL || res == NULL || mask->w == 0 || mask->h == 0 || mask->w >= UINT32_MAX || mask->h >= UINT32_MAX ||
+        (conn != CCL_CONN_4 && conn != CCL_CONN_8))
+    {
+        return ERR_ARGS;
+    }
+
+    ccl_job_t job = {.mask = mask, .w = mask->w, .h = mask->h, .touch = (conn == CCL_CONN_8), .labels = labels};
+    return ccl_label(pool, &job, mask->words_per_row * sizeof(uint64_t), res);
+}
+
+void ccl_result_destroy(ccl_result_t *res)
+{
+    free(res->components);
+    res->components = NULL;
+    res->n_components = 0;
+}
+
+static RETURN_TYPES ccl_label(thread_pool_t *pool, ccl_job_t *job, const unsigned long bytes_per_row, ccl_result_t *res)
+{
+    res->n_components = 0;
+    res->components = NULL;
+
+    job->band_rows = band_rows_for(bytes_per_row, 1);
+    job->n_bands = (job->h + job->band_rows - 1) / job->band_rows;
+    job->bands = calloc(job->n_bands, sizeof(ccl_band_t));
+    if (job->bands == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    // ----- Pass 1, every band on its own
+    ccl_run_tasks(pool, ccl_band_task, job);
+
+    unsigned long n_runs = 0;
+    for (unsigned long b = 0; b < job->n_bands; b++)
+    {
+        if (job->bands[b].result != SUCCESS)
+        {
+            RETURN_TYPES ret = job->bands[b].result;
+            ccl_free_bands(job);
+            return ret;
+        }
+        job->bands[b].base = n_runs;
+        n_runs += job->bands[b].n_runs;
+    }
+    if (n_runs >= UINT32_MAX)
+    {
+        ccl_free_bands(job);
+        return ERR_GENERAL;
+    }
+
+    uint32_t *parent = malloc((n_runs + 1) * sizeof(uint32_t)); // + 1, an empty image still gets a valid pointer
+    if (parent == NULL)
+    {
+        ccl_free_bands(job);
+        return ERR_ALLOC;
+    }
+    for (unsigned long b = 0; b < job->n_bands; b++)
+    {
+        const ccl_band_t *band = &job->bands[b];
+        for (unsigned long i = 0; i < band->n_runs; i++)
+        {
+            parent[band->base + i] = (uint32_t)(band->base + band->parent[i]);
+        }
+    }
+
+    // ----- Seams between neighbouring bands
+    for (unsigned long b = 1; b < job->n_bands; b++)
+    {
+        const ccl_band_t *above = &job->bands[b - 1];
+        ccl_band_t *below = &job->bands[b];
+        merge_rows(above->runs + above->last_row_begin, above->n_runs - above->last_row_begin, above->base + above->last_row_begin,
+                   below->runs, below->first_row_end, below->base, parent, job->touch);
+    }
+
+    // ----- Roots -> labels 1..n in raster order. parent[i] < i for non-roots, so it already holds a label here.
+    unsigned long n_labels = 0;
+    for (unsigned long i = 0; i < n_runs; i++)
+    {
+        parent[i] = (parent[i] == i) ? (uint32_t)++n_labels : parent[parent[i]];
+    }
+
+    RETURN_TYPES ret = collect_components(job, parent, n_labels, res);
+
+    // ----- Pass 2, painting the runs
+    if (ret == SUCCESS && job->labels != NULL)
+    {
+        job->run_labels = parent;
+        ccl_run_tasks(pool, ccl_paint_task, job);
+    }
+
+    free(parent);
+    ccl_free_bands(job);
+    return ret;
+}
+
+static void ccl_run_tasks(thread_pool_t *pool, pool_task_fn fn, ccl_job_t *job)
+{
+    if (pool != NULL)
+    {
+        pool_run(pool, fn, job, job->n_bands);
+        return;
+    }
+    for (unsigned long b = 0; b < job->n_bands; b++)
+    {
+        fn(job, b);
+    }
+}
+
+static void ccl_band_task(void *arg, unsigned long index)
+{
+    ccl_job_t *job = arg;
+    ccl_band_t *band = &job->bands[index];
+
+    band->y0 = index * job->band_rows;
+    band->y1 = (band->y0 + job->band_rows < job->h) ? (band->y0 + job->band_rows) : job->h;
+
+    unsigned long prev_begin = 0;
+    for (unsigned long y = band->y0; y < band->y1; y++)
+    {
+        const unsigned long row_begin = band->n_runs;
+
+        RETURN_TYPES ret = (job->mask != NULL) ? band_runs_bitmask(band, job->mask, y) : band_runs_u8(band, job->img + y * job->w, job->w, y);
+        if (ret != SUCCESS)
+        {
+            band->result = ret;
+            return;
+        }
+
+        if (y == band->y0)
+        {
+            band->first_row_end = band->n_runs;
+        }
+        else
+        {
+            merge_rows(band->runs + prev_begin, row_begin - prev_begin, prev_begin,
+                       band->runs + row_begin, band->n_runs - row_begin, row_begin, band->parent, job->touch);
+        }
+        prev_begin = row_begin;
+    }
+    band->last_row_begin = prev_begin;
+    band->result = SUCCESS;
+}
+
+static void ccl_paint_task(void *arg, unsigned long index)
+{
+    ccl_job_t *job = arg;
+    const ccl_band_t *band = &job->bands[index];
+
+    memset(job->labels + band->y0 * job->w, 0, (band->y1 - band->y0) * job->w * sizeof(uint32_t));
+    for (unsigned long i = 0; i < band->n_runs; i++)
+    {
+        const ccl_run_t *run = &band->runs[i];
+        const uint32_t label = job->run_labels[band->base + i];
+        uint32_t *row = job->labels + (unsigned long)run->y * job->w;
+        for (uint32_t x = run->x0; x < run->x1; x++)
+        {
+            row[x] = label;
+        }
+    }
+}
+
+static RETURN_TYPES band_push_run(ccl_band_t *band, const unsigned long x0, const unsigned long x1, const unsigned long y)
+{
+    if (band->n_runs == band->capacity)
+    {
+        const unsigned long capacity = (band->capacity > 0) ? 2 * band->capacity : CCL_RUNS_INITIAL;
+        if (capacity >= UINT32_MAX)
+        {
+            return ERR_GENERAL;
+        }
+
+        ccl_run_t *runs = realloc(band->runs, capacity * sizeof(ccl_run_t));
+        if (runs == NULL)
+        {
+            return ERR_ALLOC;
+        }
+        band->runs = runs;
+
+        uint32_t *parent = realloc(band->parent, capacity * sizeof(uint32_t));
+        if (parent == NULL)
+        {
+            return ERR_ALLOC;
+        }
+        band->parent = parent;
+        band->capacity = capacity;
+    }
+
+    const unsigned long id = band->n_runs++;
+    band->runs[id] = (ccl_run_t){.x0 = (uint32_t)x0, .x1 = (uint32_t)x1, .y = (uint32_t)y, .overlap_up = 0};
+    band->parent[id] = (uint32_t)id;
+    return SUCCESS;
+}
+
+static RETURN_TYPES band_runs_u8(ccl_band_t *band, const uint8_t *row, const unsigned long w, const unsigned long y)
+{
+    unsigned long x = 0;
+    while (x < w)
+    {
+        while (x < w && row[x] == 0)
+        {
+            x++;
+        }
+        if (x == w)
+        {
+            break;
+        }
+
+        const unsigned long x0 = x;
+        while (x < w && row[x] != 0)
+        {
+            x++;
+        }
+
+        RETURN_TYPES ret = band_push_run(band, x0, x, y);
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+    }
+    return SUCCESS;
+}
+
+static RETURN_TYPES band_runs_bitmask(ccl_band_t *band, const bitmask_t *mask, const unsigned long y)
+{
+    // Whole background / foreground words are skipped 64 pixels at a time, run ends come from ctz.
+    // Bits past w are 0, so no run can leave the image.
+    const uint64_t *row = bitmask_row(mask, y);
+    const unsigned long n_words = mask->words_per_row;
+
+    unsigned long x = 0;
+    while (x < mask->w)
+    {
+        unsigned long i = x / BITS_PER_WORD;
+        uint64_t bits = row[i] & (~0ull << (x % BITS_PER_WORD));
+        while (bits == 0)
+        {
+            if (++i == n_words)
+            {
+                return SUCCESS;
+            }
+            bits = row[i];
+        }
+        const unsigned long x0 = i * BITS_PER_WORD + (unsigned long)__builtin_ctzll(bits);
+
+        bits = ~row[i] & (~0ull << (x0 % BITS_PER_WORD));
+        while (bits == 0 && ++i < n_words)
+        {
+            bits = ~row[i];
+        }
+        x = (i < n_words) ? i * BITS_PER_WORD + (unsigned long)__builtin_ctzll(bits) : mask->w;
+
+        RETURN_TYPES ret = band_push_run(band, x0, x, y);
+        if (ret != SUCCESS)
+        {
+            return ret;
+        }
+    }
+    return SUCCESS;
+}
+
+static void merge_rows(const ccl_run_t *prev, const unsigned long n_prev, const unsigned long prev_id, ccl_run_t *cur, const unsigned long n_cur, const unsigned long cur_id, uint32_t *parent, const uint32_t touch)
+{
+    // Both rows are sorted by x, so one sweep finds every touching pair
+    unsigned long j = 0;
+    for (unsigned long c = 0; c < n_cur; c++)
+    {
+        while (j < n_prev && prev[j].x1 + touch <= cur[c].x0)
+        {
+            j++;
+        }
+
+        for (unsigned long k = j; k < n_prev && prev[k].x0 < cur[c].x1 + touch; k++)
+        {
+            uf_union(parent, (uint32_t)(prev_id + k), (uint32_t)(cur_id + c));
+
+            const uint32_t lo = (prev[k].x0 > cur[c].x0) ? prev[k].x0 : cur[c].x0;
+            const uint32_t hi = (prev[k].x1 < cur[c].x1) ? prev[k].x1 : cur[c].x1;
+            if (hi > lo)
+            {
+                cur[c].overlap_up += hi - lo;
+            }
+        }
+    }
+}
+
+static RETURN_TYPES collect_components(const ccl_job_t *job, const uint32_t *run_labels, const unsigned long n_labels, ccl_result_t *res)
+{
+    if (n_labels == 0)
+    {
+        return SUCCESS;
+    }
+
+    ccl_component_t *comps = calloc(n_labels, sizeof(ccl_component_t));
+    if (comps == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    for (unsigned long b = 0; b < job->n_bands; b++)
+    {
+        const ccl_band_t *band = &job->bands[b];
+        for (unsigned long i = 0; i < band->n_runs; i++)
+        {
+            const ccl_run_t *run = &band->runs[i];
+            ccl_component_t *comp = &comps[run_labels[band->base + i] - 1];
+            const unsigned long len = run->x1 - run->x0;
+
+            if (comp->area == 0)
+            {
+                comp->x_min = run->x0;
+                comp->x_max = run->x1 - 1;
+                comp->y_min = comp->y_max = run->y;
+            }
+            else
+            {
+                comp->x_min = (run->x0 < comp->x_min) ? run->x0 : comp->x_min;
+                comp->x_max = (run->x1 - 1 > comp->x_max) ? run->x1 - 1 : comp->x_max;
+                comp->y_max = run->y; // runs are visited in raster order
+            }
+            comp->area += len;
+
+            // Left + right edge, top and bottom edges minus the ones shared with the row above (counted on both runs)
+            comp->perimeter += 2 + 2 * len - 2 * (unsigned long)run->overlap_up;
+        }
+    }
+
+    res->components = comps;
+    res->n_components = n_labels;
+    return SUCCESS;
+}
+
+static void ccl_free_bands(ccl_job_t *job)
+{
+    for (unsigned long b = 0; b < job->n_bands; b++)
+    {
+        free(job->bands[b].runs);
+        free(job->bands[b].parent);
+    }
+    free(job->bands);
+    job->bands = NULL;
+}
@@ -0,0 +1,56 @@
+#ifndef CCL_H
+#define CCL_H
+
+/* ------ Notes Section
+Connected-component labeling, two passes over runs of foreground pixels instead of single pixels.
+Pass 1: every row is turned into runs [x0, x1), each run is joined (union-find, path halving)
+        with the runs of the previous row it touches. The root of a set is always its smallest run id,
+        so labels come out in raster order of the first pixel of each component.
+Pass 2: runs are painted into the label image (optional).
+The image is cut into the same bands as morph_parallel.c, each band does pass 1 on its own,
+then only the seams (last row of a band vs. first row of the next) are joined on the calling thread.
+
+Perimeter is the crack length: number of pixel edges between the component and background / outside of the image.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_common.h"
+#include "thread_pool.h"
+#include "morph_bitpacked.h"
+
+// ---- Enums ----
+
+typedef enum
+{
+    CCL_CONN_4 = 4,
+    CCL_CONN_8 = 8
+} CCL_CONNECTIVITY;
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long x_min;
+    unsigned long y_min;
+    unsigned long x_max; // inclusive
+    unsigned long y_max;
+    unsigned long area;
+    unsigned long perimeter;
+} ccl_component_t;
+
+typedef struct
+{
+    unsigned long n_components;
+    ccl_component_t *components; // components[i] has label i + 1, label 0 is background
+} ccl_result_t;
+
+// ---- Function Prototypes ----
+
+// pool may be NULL (single-threaded), labels may be NULL (statistics only), otherwise w * h labels are written
+RETURN_TYPES ccl_label_u8(thread_pool_t *pool, const uint8_t *img, const unsigned long w, const unsigned long h, CCL_CONNECTIVITY conn, uint32_t *labels, ccl_result_t *res);
+RETURN_TYPES ccl_label_bitmask(thread_pool_t *pool, const bitmask_t *mask, CCL_CONNECTIVITY conn, uint32_t *labels, ccl_result_t *res);
+void ccl_result_destroy(ccl_result_t *res);
+
+#endif
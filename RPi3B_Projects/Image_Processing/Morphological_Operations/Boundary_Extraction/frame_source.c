@@ -0,0 +1,333 @@
+// ---- Libraries ----
+#include "frame_source.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h> // fmin()
+
+#include "img_io.h"
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long *slots; // buffer indexes, FIFO
+    unsigned long head;
+    unsigned long count;
+    unsigned long capacity;
+} buf_queue_t;
+
+typedef struct
+{
+    img_mapped_t file;
+    unsigned long frame_bytes;
+    unsigned long n_frames_file;
+    unsigned long max_frames;
+    bool loop;
+
+    pthread_t thread;
+    bool thread_started;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_ready;
+    pthread_cond_t cond_free; // only waited on without a frame rate
+
+    buf_queue_t free_q;  // waiting to be filled
+    buf_queue_t ready_q; // filled, waiting for dequeue()
+    bool eof;
+    bool stop;
+} file_source_t;
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES file_start(frame_source_t *src);
+static RETURN_TYPES file_dequeue(frame_source_t *src, frame_buf_t **buf);
+static RETURN_TYPES file_enqueue(frame_source_t *src, frame_buf_t *buf);
+static void file_close(frame_source_t *src);
+static void *file_capture_thread(void *arg);
+static void sleep_until(const double t);
+
+static inline void queue_push(buf_queue_t *q, const unsigned long slot)
+{
+    q->slots[(q->head + q->count) % q->capacity] = slot;
+    q->count++;
+}
+
+static inline unsigned long queue_pop(buf_queue_t *q)
+{
+    const unsigned long slot = q->slots[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    return slot;
+}
+
+// ---- Globals ----
+
+static const frame_source_ops_t FILE_SOURCE_OPS = {
+    .start = file_start,
+    .dequeue = file_dequeue,
+    .enqueue = file_enqueue,
+    .close = file_close,
+};
+
+// ---- Function Implementations ----
+
+RETURN_TYPES frame_source_open_file(frame_source_t *src, const frame_file_opts_t *opts)
+{
+    if (src == NULL || opts == NULL || opts->path == NULL || opts->fps < 0 || opts->format < 0 || opts->format >= PIX_FMT_COUNT ||
+        (opts->n_bufs != 0 && (opts->n_bufs < FRAME_BUFFERS_MIN || opts->n_bufs > FRAME_BUFFERS_MAX)))
+    {
+        return ERR_ARGS;
+    }
+
+    memset(src, 0, sizeof(*src));
+    src->ops = &FILE_SOURCE_OPS;
+    src->w = opts->w;
+    src->h = opts->h;
+    src->format = opts->format;
+    src->fps = opts->fps;
+    src->n_bufs = (opts->n_bufs != 0) ? opts->n_bufs : FRAME_BUFFERS_DEFAULT;
+
+    file_source_t *fs = calloc(1, sizeof(file_source_t));
+    if (fs == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    src->priv = fs;
+    fs->file.fd = -1; // nothing mapped yet, close() must not touch fd 0
+    pthread_mutex_init(&fs->mutex, NULL);
+    pthread_cond_init(&fs->cond_ready, NULL);
+    pthread_cond_init(&fs->cond_free, NULL);
+
+    fs->frame_bytes = color_frame_bytes(opts->format, opts->w, opts->h);
+    RETURN_TYPES ret = img_map_read_packed(opts->path, opts->w, opts->h, fs->frame_bytes, &fs->file);
+    if (ret != SUCCESS)
+    {
+        file_close(src);
+        return ret;
+    }
+    fs->n_frames_file = fs->file.map_len / fs->frame_bytes;
+    fs->max_frames = opts->max_frames;
+    fs->loop = opts->loop;
+
+    // All buffers up front, the capture thread only ever copies into them
+    src->bufs = calloc(src->n_bufs, sizeof(frame_buf_t));
+    fs->free_q.slots = malloc(src->n_bufs * sizeof(unsigned long));
+    fs->ready_q.slots = malloc(src->n_bufs * sizeof(unsigned long));
+    if (src->bufs == NULL || fs->free_q.slots == NULL || fs->ready_q.slots == NULL)
+    {
+        file_close(src);
+        return ERR_ALLOC;
+    }
+    fs->free_q.capacity = fs->ready_q.capacity = src->n_bufs;
+
+    for (unsigned long i = 0; i < src->n_bufs; i++)
+    {
+        src->bufs[i].index = i;
+        src->bufs[i].data = malloc(fs->frame_bytes);
+        if (src->bufs[i].data == NULL)
+        {
+            file_close(src);
+            return ERR_ALLOC;
+        }
+        queue_push(&fs->free_q, i);
+    }
+    return SUCCESS;
+}
+
+void frame_latency_reset(frame_latency_t *lat)
+{
+    memset(lat, 0, sizeof(*lat));
+}
+
+void frame_latency_add(frame_latency_t *lat, const double ms)
+{
+    if (lat->frames == 0 || ms < lat->min_ms)
+    {
+        lat->min_ms = ms;
+    }
+    if (lat->frames == 0 || ms > lat->max_ms)
+    {
+        lat->max_ms = ms;
+    }
+    lat->sum_ms += ms;
+    lat->frames++;
+
+    unsigned long bin = (ms > 0) ? (unsigned long)(ms / LATENCY_BIN_MS) : 0;
+    lat->bins[(bin < LATENCY_BINS) ? bin : (LATENCY_BINS - 1)]++;
+}
+
+double frame_latency_percentile(const frame_latency_t *lat, const double p)
+{
+    if (lat->frames == 0)
+    {
+        return 0;
+    }
+
+    const double target = p / 100.0 * (double)lat->frames;
+    unsigned long seen = 0;
+    for (unsigned long b = 0; b < LATENCY_BINS; b++)
+    {
+        seen += lat->bins[b];
+        if ((double)seen >= target && seen > 0)
+        {
+            // Upper edge of the bin, but never above what was actually measured
+            return (b + 1 < LATENCY_BINS) ? fmin((double)(b + 1) * LATENCY_BIN_MS, lat->max_ms) : lat->max_ms;
+        }
+    }
+    return lat->max_ms;
+}
+
+static RETURN_TYPES file_start(frame_source_t *src)
+{
+    file_source_t *fs = src->priv;
+    if (fs->thread_started)
+    {
+        return ERR_ARGS;
+    }
+    if (pthread_create(&fs->thread, NULL, file_capture_thread, src) != 0)
+    {
+        return ERR_GENERAL;
+    }
+    fs->thread_started = true;
+    return SUCCESS;
+}
+
+static RETURN_TYPES file_dequeue(frame_source_t *src, frame_buf_t **buf)
+{
+    file_source_t *fs = src->priv;
+
+    pthread_mutex_lock(&fs->mutex);
+    while (fs->ready_q.count == 0 && !fs->eof)
+    {
+        pthread_cond_wait(&fs->cond_ready, &fs->mutex);
+    }
+    if (fs->ready_q.count == 0)
+    {
+        pthread_mutex_unlock(&fs->mutex);
+        return ERR_END_OF_STREAM;
+    }
+    *buf = &src->bufs[queue_pop(&fs->ready_q)];
+    pthread_mutex_unlock(&fs->mutex);
+    return SUCCESS;
+}
+
+static RETURN_TYPES file_enqueue(frame_source_t *src, frame_buf_t *buf)
+{
+    file_source_t *fs = src->priv;
+    if (buf == NULL || buf->index >= src->n_bufs || &src->bufs[buf->index] != buf)
+    {
+        return ERR_ARGS;
+    }
+
+    pthread_mutex_lock(&fs->mutex);
+    queue_push(&fs->free_q, buf->index);
+    pthread_cond_signal(&fs->cond_free);
+    pthread_mutex_unlock(&fs->mutex);
+    return SUCCESS;
+}
+
+static void file_close(frame_source_t *src)
+{
+    file_source_t *fs = src->priv;
+    if (fs == NULL)
+    {
+        return;
+    }
+
+    if (fs->thread_started)
+    {
+        pthread_mutex_lock(&fs->mutex);
+        fs->stop = true;
+        pthread_cond_broadcast(&fs->cond_free);
+        pthread_mutex_unlock(&fs->mutex);
+        pthread_join(fs->thread, NULL);
+    }
+    pthread_mutex_destroy(&fs->mutex);
+    pthread_cond_destroy(&fs->cond_ready);
+    pthread_cond_destroy(&fs->cond_free);
+
+    for (unsigned long i = 0; src->bufs != NULL && i < src->n_bufs; i++)
+    {
+        free(src->bufs[i].data);
+    }
+    free(src->bufs);
+    free(fs->free_q.slots);
+    free(fs->ready_q.slots);
+    img_unmap(&fs->file);
+    free(fs);
+    src->bufs = NULL;
+    src->priv = NULL;
+}
+
+static void *file_capture_thread(void *arg)
+{
+    frame_source_t *src = arg;
+    file_source_t *fs = src->priv;
+    const double period = (src->fps > 0) ? 1.0 / src->fps : 0;
+    double t_next = img_now_sec();
+
+    for (unsigned long seq = 0;; seq++)
+    {
+        if ((!fs->loop && seq >= fs->n_frames_file) || (fs->max_frames > 0 && seq >= fs->max_frames))
+        {
+            break;
+        }
+
+        // The sensor does not wait: at a fixed rate the frame is due whether a buffer is free or not
+        if (period > 0)
+        {
+            sleep_until(t_next);
+            t_next += period;
+        }
+
+        pthread_mutex_lock(&fs->mutex);
+        while (period == 0 && fs->free_q.count == 0 && !fs->stop) // without a rate, wait for the consumer instead
+        {
+            pthread_cond_wait(&fs->cond_free, &fs->mutex);
+        }
+        if (fs->stop)
+        {
+            pthread_mutex_unlock(&fs->mutex);
+            break;
+        }
+        if (fs->free_q.count == 0)
+        {
+            src->frames_dropped++;
+            pthread_mutex_unlock(&fs->mutex);
+            continue;
+        }
+        frame_buf_t *buf = &src->bufs[queue_pop(&fs->free_q)];
+        pthread_mutex_unlock(&fs->mutex);
+
+        // Stand-in for the DMA into the capture buffer
+        memcpy(buf->data, fs->file.pixels + (seq % fs->n_frames_file) * fs->frame_bytes, fs->frame_bytes);
+        buf->sequence = seq;
+        buf->t_capture = img_now_sec();
+
+        pthread_mutex_lock(&fs->mutex);
+        queue_push(&fs->ready_q, buf->index);
+        src->frames_captured++;
+        pthread_cond_signal(&fs->cond_ready);
+        pthread_mutex_unlock(&fs->mutex);
+    }
+
+    pthread_mutex_lock(&fs->mutex);
+    fs->eof = true;
+    pthread_cond_broadcast(&fs->cond_ready);
+    pthread_mutex_unlock(&fs->mutex);
+    return NULL;
+}
+
+static void sleep_until(const double t)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1e9);
+
+    // Absolute deadline, so the sleeps don't add up drift; restart after signals
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+/* ------ Notes Section
+Frame sources follow the V4L2 streaming I/O model (VIDIOC_QBUF / VIDIOC_DQBUF):
+- the source owns a ring of preallocated buffers, nothing is allocated per frame
+- dequeue() blocks until the next filled buffer is there and lends it out,
+  the stages read it in place and enqueue() hands it back to be filled again
+- when the consumer is too slow and no buffer is free, the frame is dropped (sequence gap), like a camera does
+- every buffer carries the time the frame was complete, so capture -> output latency can be measured
+
+frame_source_open_file() is the stand-in for the camera: a file of concatenated raw frames
+(e.g. ffmpeg -f rawvideo -pix_fmt gray / rgb24 / yuyv422 / nv12 / rgb565le) is mmap'd and replayed at a fixed FPS by a capture thread.
+A V4L2 backend only has to provide the same ops.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "img_common.h"
+#include "img_color.h"
+
+// ---- Enums ----
+
+enum FRAME_SOURCE_SETTINGS
+{
+    FRAME_BUFFERS_DEFAULT = 4,
+    FRAME_BUFFERS_MIN = 2, // one being filled, one being processed
+    FRAME_BUFFERS_MAX = 32,
+    LATENCY_BINS = 2000 // 0.1 ms each, last bin collects everything above 200 ms
+};
+
+#define LATENCY_BIN_MS 0.1
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    uint8_t *data;          // color_frame_bytes(format, w, h) bytes
+    unsigned long index;    // slot in the ring
+    unsigned long sequence; // frame number at the source, gaps are dropped frames
+    double t_capture;       // img_now_sec() when the frame was complete
+} frame_buf_t;
+
+typedef struct frame_source frame_source_t;
+
+typedef struct
+{
+    RETURN_TYPES (*start)(frame_source_t *src);
+    RETURN_TYPES (*dequeue)(frame_source_t *src, frame_buf_t **buf); // ERR_END_OF_STREAM once the source ran dry
+    RETURN_TYPES (*enqueue)(frame_source_t *src, frame_buf_t *buf);
+    void (*close)(frame_source_t *src);
+} frame_source_ops_t;
+
+struct frame_source
+{
+    const frame_source_ops_t *ops;
+    unsigned long w;
+    unsigned long h;
+    PIX_FORMATS format;
+    double fps;
+
+    frame_buf_t *bufs;
+    unsigned long n_bufs;
+
+    unsigned long frames_captured;
+    unsigned long frames_dropped;
+    void *priv; // backend state
+};
+
+typedef struct
+{
+    const char *path;
+    unsigned long w;
+    unsigned long h;
+    PIX_FORMATS format;
+    double fps;               // 0 -> as fast as the consumer takes them
+    unsigned long n_bufs;     // 0 -> FRAME_BUFFERS_DEFAULT
+    unsigned long max_frames; // 0 -> the file once (or forever with loop)
+    bool loop;
+} frame_file_opts_t;
+
+typedef struct
+{
+    unsigned long frames;
+    double min_ms;
+    double max_ms;
+    double sum_ms;
+    unsigned long bins[LATENCY_BINS];
+} frame_latency_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES frame_source_open_file(frame_source_t *src, const frame_file_opts_t *opts);
+
+void frame_latency_reset(frame_latency_t *lat);
+void frame_latency_add(frame_latency_t *lat, const double ms);
+double frame_latency_percentile(const frame_latency_t *lat, const double p); // upper edge of the bin, p in [0, 100]
+
+static inline RETURN_TYPES frame_source_start(frame_source_t *src)
+{
+    return src->ops->start(src);
+}
+
+static inline RETURN_TYPES frame_source_dequeue(frame_source_t *src, frame_buf_t **buf)
+{
+    return src->ops->dequeue(src, buf);
+}
+
+static inline RETURN_TYPES frame_source_enqueue(frame_source_t *src, frame_buf_t *buf)
+{
+    return src->ops->enqueue(src, buf);
+}
+
+static inline void frame_source_close(frame_source_t *src)
+{
+    src->ops->close(src);
+}
+
+#endif
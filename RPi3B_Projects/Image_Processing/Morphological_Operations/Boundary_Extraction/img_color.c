@@ -0,0 +1,561 @@
+/* ------ Notes Section
+1) YUYV
+Y sits in the even bytes: SSE masks the odd ones away and packus squeezes 16-bit lanes to bytes,
+AVX2 needs one permute afterwards because packus works per 128-bit lane. NEON's vld2q_u8 splits even / odd directly.
+2) RGB565
+8 (SSE, NEON) or 16 (AVX2) pixels per 16-bit vector, fields pulled out with shifts and masks and widened in place.
+The weighted sum stays below 255 * 256 like in img_gray.c, so 16-bit lanes are enough.
+3) HSV
+The scalar loop does one table lookup per division. AVX2 does 8 pixels in 32-bit lanes:
+RGB comes in with a byte-offset gather (4 bytes from 3p, the 4th one is dropped), the tables with two more gathers.
+The gather of the last pixel reads one byte past it, so the vector loop stops 9 pixels before the end.
+4) The tail always goes through the scalar loop.
+*/
+
+// ---- Libraries ----
+#include "img_color.h"
+
+#include <stddef.h>
+#include <limits.h> // ULONG_MAX
+#include <string.h>
+
+#include "img_common.h" // CH_RGB
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GRAY_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GRAY_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// ---- Enums ----
+
+enum RGB565_FIELDS
+{
+    RGB565_R_SHIFT = 11,
+    RGB565_G_SHIFT = 5,
+    RGB565_5_MASK = 0x1F,
+    RGB565_6_MASK = 0x3F
+};
+
+// ---- Typedefs ----
+
+typedef void (*color_fn)(const uint8_t *src, uint8_t *dst, const unsigned long n);
+
+// ---- Function Prototypes ----
+
+static void yuyv2gray_run_scalar(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void rgb5652gray_run_scalar(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void rgb2hsv_run_scalar(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void hsv_tables_init(void);
+#ifdef GRAY_HAVE_X86
+static void yuyv2gray_run_ssse3(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void yuyv2gray_run_avx2(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void rgb5652gray_run_ssse3(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void rgb5652gray_run_avx2(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void rgb2hsv_run_avx2(const uint8_t *src, uint8_t *dst, const unsigned long n);
+#endif
+#ifdef GRAY_HAVE_NEON
+static void yuyv2gray_run_neon(const uint8_t *src, uint8_t *dst, const unsigned long n);
+static void rgb5652gray_run_neon(const uint8_t *src, uint8_t *dst, const unsigned long n);
+#endif
+
+static inline uint16_t load_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// ---- Globals ----
+
+static color_fn yuyv2gray_active = yuyv2gray_run_scalar;
+static color_fn rgb5652gray_active = rgb5652gray_run_scalar;
+static color_fn rgb2hsv_active = rgb2hsv_run_scalar;
+static GRAY_IMPLS color_active_id = GRAY_IMPL_SCALAR;
+
+// Q12 reciprocals: HSV_SDIV[v] = 255 / v, HSV_HDIV[d] = 30 / d, index 0 -> 0
+static int32_t HSV_SDIV[256];
+static int32_t HSV_HDIV[256];
+static int hsv_tables_ready = 0;
+
+static const char *PIX_FORMAT_NAMES[PIX_FMT_COUNT] = {"gray", "rgb", "yuyv", "nv12", "rgb565"};
+
+// ---- Function Implementations ----
+
+void color_init(void)
+{
+    static const GRAY_IMPLS preference[] = {GRAY_IMPL_AVX2, GRAY_IMPL_NEON, GRAY_IMPL_SSSE3};
+
+    hsv_tables_init();
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++)
+    {
+        if (color_force_impl(preference[i]) == 0)
+        {
+            return;
+        }
+    }
+    color_force_impl(GRAY_IMPL_SCALAR);
+}
+
+int color_force_impl(GRAY_IMPLS impl)
+{
+    if (!rgb2gray_impl_supported(impl))
+    {
+        return -1;
+    }
+
+    yuyv2gray_active = yuyv2gray_run_scalar;
+    rgb5652gray_active = rgb5652gray_run_scalar;
+    rgb2hsv_active = rgb2hsv_run_scalar;
+
+    switch (impl)
+    {
+#ifdef GRAY_HAVE_X86
+    case GRAY_IMPL_SSSE3:
+        yuyv2gray_active = yuyv2gray_run_ssse3;
+        rgb5652gray_active = rgb5652gray_run_ssse3;
+        break;
+
+    case GRAY_IMPL_AVX2:
+        yuyv2gray_active = yuyv2gray_run_avx2;
+        rgb5652gray_active = rgb5652gray_run_avx2;
+        rgb2hsv_active = rgb2hsv_run_avx2;
+        break;
+#endif
+
+#ifdef GRAY_HAVE_NEON
+    case GRAY_IMPL_NEON:
+        yuyv2gray_active = yuyv2gray_run_neon;
+        rgb5652gray_active = rgb5652gray_run_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    color_active_id = impl;
+    return 0;
+}
+
+GRAY_IMPLS color_active_impl(void)
+{
+    return color_active_id;
+}
+
+void yuyv2gray_u8(const uint8_t *img_yuyv, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    yuyv2gray_active(img_yuyv, img_gray, w * h);
+}
+
+void rgb5652gray_u8(const uint8_t *img_rgb565, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    rgb5652gray_active(img_rgb565, img_gray, w * h);
+}
+
+void rgb2hsv_u8(const uint8_t *img_rgb, uint8_t *img_hsv, const unsigned long w, const unsigned long h)
+{
+    if (!hsv_tables_ready)
+    {
+        hsv_tables_init();
+    }
+    rgb2hsv_active(img_rgb, img_hsv, w * h);
+}
+
+void yuyv2gray_u8_scalar(const uint8_t *img_yuyv, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    yuyv2gray_run_scalar(img_yuyv, img_gray, w * h);
+}
+
+void rgb5652gray_u8_scalar(const uint8_t *img_rgb565, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    rgb5652gray_run_scalar(img_rgb565, img_gray, w * h);
+}
+
+void rgb2hsv_u8_scalar(const uint8_t *img_rgb, uint8_t *img_hsv, const unsigned long w, const unsigned long h)
+{
+    if (!hsv_tables_ready)
+    {
+        hsv_tables_init();
+    }
+    rgb2hsv_run_scalar(img_rgb, img_hsv, w * h);
+}
+
+void color_to_gray_u8(const PIX_FORMATS format, const uint8_t *src, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    switch (format)
+    {
+    case PIX_FMT_RGB24:
+        rgb2gray_u8(src, img_gray, w, h);
+        break;
+
+    case PIX_FMT_YUYV:
+        yuyv2gray_u8(src, img_gray, w, h);
+        break;
+
+    case PIX_FMT_RGB565:
+        rgb5652gray_u8(src, img_gray, w, h);
+        break;
+
+    default: // GRAY8 and NV12: the source already is the gray plane
+        if (src != img_gray)
+        {
+            memcpy(img_gray, src, w * h);
+        }
+        break;
+    }
+}
+
+const uint8_t *color_gray_view(const PIX_FORMATS format, const uint8_t *frame)
+{
+    return (format == PIX_FMT_GRAY8 || format == PIX_FMT_NV12) ? frame : NULL;
+}
+
+unsigned long color_frame_bytes(const PIX_FORMATS format, const unsigned long w, const unsigned long h)
+{
+    // 0 when the frame doesn't fit in memory: img_map_read_packed() refuses that as ERR_ARGS
+    size_t bytes = 0;
+    size_t chroma = 0;
+    switch (format)
+    {
+    case PIX_FMT_RGB24:
+        return img_frame_size(w, h, CH_RGB, &bytes) && bytes <= ULONG_MAX ? (unsigned long)bytes : 0;
+    case PIX_FMT_YUYV:
+    case PIX_FMT_RGB565:
+        return img_frame_size(w, h, 2, &bytes) && bytes <= ULONG_MAX ? (unsigned long)bytes : 0;
+    case PIX_FMT_NV12:
+        // UV at half resolution both ways
+        if (!img_frame_size(w, h, 1, &bytes) || !img_frame_size((w + 1) / 2, (h + 1) / 2, 2, &chroma) || bytes > SIZE_MAX - chroma ||
+            bytes + chroma > ULONG_MAX)
+        {
+            return 0;
+        }
+        return (unsigned long)(bytes + chroma);
+    default:
+        return img_frame_size(w, h, 1, &bytes) && bytes <= ULONG_MAX ? (unsigned long)bytes : 0;
+    }
+}
+
+unsigned long color_row_bytes(const PIX_FORMATS format, const unsigned long w)
+{
+    switch (format)
+    {
+    case PIX_FMT_RGB24:
+        return w * CH_RGB;
+    case PIX_FMT_YUYV:
+    case PIX_FMT_RGB565:
+        return w * 2;
+    default:
+        return w;
+    }
+}
+
+const char *color_format_name(const PIX_FORMATS format)
+{
+    if (format < 0 || format >= PIX_FMT_COUNT)
+    {
+        return "unknown";
+    }
+    return PIX_FORMAT_NAMES[format];
+}
+
+int color_format_from_name(const char *name, PIX_FORMATS *format)
+{
+    // Channel counts too, so the older "w h ch" command lines keep working
+    if (strcmp(name, "1") == 0)
+    {
+        *format = PIX_FMT_GRAY8;
+        return 0;
+    }
+    if (strcmp(name, "3") == 0)
+    {
+        *format = PIX_FMT_RGB24;
+        return 0;
+    }
+
+    for (int f = 0; f < PIX_FMT_COUNT; f++)
+    {
+        if (strcmp(name, PIX_FORMAT_NAMES[f]) == 0)
+        {
+            *format = (PIX_FORMATS)f;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void hsv_tables_init(void)
+{
+    HSV_SDIV[0] = 0;
+    HSV_HDIV[0] = 0;
+    for (int i = 1; i < 256; i++)
+    {
+        HSV_SDIV[i] = ((255 << HSV_SHIFT) + i / 2) / i;
+        HSV_HDIV[i] = ((HSV_H_SECTOR << HSV_SHIFT) + i / 2) / i;
+    }
+    hsv_tables_ready = 1;
+}
+
+static void yuyv2gray_run_scalar(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    for (unsigned long i = 0; i < n; i++)
+    {
+        dst[i] = src[2 * i];
+    }
+}
+
+static void rgb5652gray_run_scalar(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    for (unsigned long i = 0; i < n; i++)
+    {
+        const unsigned p = load_le16(src + 2 * i);
+        const unsigned r5 = p >> RGB565_R_SHIFT;
+        const unsigned g6 = (p >> RGB565_G_SHIFT) & RGB565_6_MASK;
+        const unsigned b5 = p & RGB565_5_MASK;
+
+        // Replicating the top bits maps 31 / 63 to 255 exactly
+        const unsigned R = (r5 << 3) | (r5 >> 2);
+        const unsigned G = (g6 << 2) | (g6 >> 4);
+        const unsigned B = (b5 << 3) | (b5 >> 2);
+
+        dst[i] = (uint8_t)((W_R * R + W_G * G + W_B * B) >> W_SHIFT);
+    }
+}
+
+static void rgb2hsv_run_scalar(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    for (unsigned long i = 0; i < n; i++)
+    {
+        const int R = src[3 * i + R_loc];
+        const int G = src[3 * i + G_loc];
+        const int B = src[3 * i + B_loc];
+
+        const int V = (R > G) ? ((R > B) ? R : B) : ((G > B) ? G : B);
+        const int mn = (R < G) ? ((R < B) ? R : B) : ((G < B) ? G : B);
+        const int delta = V - mn;
+
+        // delta == 0 takes the V == R branch with diff == 0, so H comes out 0 without a special case
+        int diff, base;
+        if (V == R)
+        {
+            diff = G - B;
+            base = 0;
+        }
+        else if (V == G)
+        {
+            diff = B - R;
+            base = 2 * HSV_H_SECTOR;
+        }
+        else
+        {
+            diff = R - G;
+            base = 4 * HSV_H_SECTOR;
+        }
+
+        int H = base + ((diff * HSV_HDIV[delta] + HSV_ROUND) >> HSV_SHIFT);
+        H += (H < 0) ? HSV_H_RANGE : 0;
+
+        dst[3 * i + 0] = (uint8_t)H;
+        dst[3 * i + 1] = (uint8_t)((delta * HSV_SDIV[V] + HSV_ROUND) >> HSV_SHIFT);
+        dst[3 * i + 2] = (uint8_t)V;
+    }
+}
+
+#ifdef GRAY_HAVE_X86
+
+__attribute__((target("ssse3"))) static void yuyv2gray_run_ssse3(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    const __m128i y_mask = _mm_set1_epi16(0x00FF);
+
+    unsigned long i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 2 * i)), y_mask);
+        const __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 2 * i + 16)), y_mask);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+    }
+
+    yuyv2gray_run_scalar(src + 2 * i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void yuyv2gray_run_avx2(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    const __m256i y_mask = _mm256_set1_epi16(0x00FF);
+
+    unsigned long i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        const __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + 2 * i)), y_mask);
+        const __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + 2 * i + 32)), y_mask);
+
+        // packus gives a0 b0 a1 b1 (8 bytes each), put the quarters back in order
+        const __m256i y = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)(dst + i), y);
+    }
+
+    yuyv2gray_run_ssse3(src + 2 * i, dst + i, n - i);
+}
+
+__attribute__((target("ssse3"))) static inline __m128i rgb565_luma_8_ssse3(const __m128i p)
+{
+    const __m128i m5 = _mm_set1_epi16(RGB565_5_MASK);
+    const __m128i m6 = _mm_set1_epi16(RGB565_6_MASK);
+
+    const __m128i r5 = _mm_srli_epi16(p, RGB565_R_SHIFT);
+    const __m128i g6 = _mm_and_si128(_mm_srli_epi16(p, RGB565_G_SHIFT), m6);
+    const __m128i b5 = _mm_and_si128(p, m5);
+
+    const __m128i r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+    const __m128i g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+    const __m128i b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+
+    __m128i y = _mm_mullo_epi16(r, _mm_set1_epi16(W_R));
+    y = _mm_add_epi16(y, _mm_mullo_epi16(g, _mm_set1_epi16(W_G)));
+    y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(W_B)));
+    return _mm_srli_epi16(y, W_SHIFT);
+}
+
+__attribute__((target("ssse3"))) static void rgb5652gray_run_ssse3(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    unsigned long i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i y_lo = rgb565_luma_8_ssse3(_mm_loadu_si128((const __m128i *)(src + 2 * i)));
+        const __m128i y_hi = rgb565_luma_8_ssse3(_mm_loadu_si128((const __m128i *)(src + 2 * i + 16)));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(y_lo, y_hi));
+    }
+
+    rgb5652gray_run_scalar(src + 2 * i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i rgb565_luma_16_avx2(const __m256i p)
+{
+    const __m256i m5 = _mm256_set1_epi16(RGB565_5_MASK);
+    const __m256i m6 = _mm256_set1_epi16(RGB565_6_MASK);
+
+    const __m256i r5 = _mm256_srli_epi16(p, RGB565_R_SHIFT);
+    const __m256i g6 = _mm256_and_si256(_mm256_srli_epi16(p, RGB565_G_SHIFT), m6);
+    const __m256i b5 = _mm256_and_si256(p, m5);
+
+    const __m256i r = _mm256_or_si256(_mm256_slli_epi16(r5, 3), _mm256_srli_epi16(r5, 2));
+    const __m256i g = _mm256_or_si256(_mm256_slli_epi16(g6, 2), _mm256_srli_epi16(g6, 4));
+    const __m256i b = _mm256_or_si256(_mm256_slli_epi16(b5, 3), _mm256_srli_epi16(b5, 2));
+
+    __m256i y = _mm256_mullo_epi16(r, _mm256_set1_epi16(W_R));
+    y = _mm256_add_epi16(y, _mm256_mullo_epi16(g, _mm256_set1_epi16(W_G)));
+    y = _mm256_add_epi16(y, _mm256_mullo_epi16(b, _mm256_set1_epi16(W_B)));
+    return _mm256_srli_epi16(y, W_SHIFT);
+}
+
+__attribute__((target("avx2"))) static void rgb5652gray_run_avx2(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    unsigned long i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        const __m256i y_lo = rgb565_luma_16_avx2(_mm256_loadu_si256((const __m256i *)(src + 2 * i)));
+        const __m256i y_hi = rgb565_luma_16_avx2(_mm256_loadu_si256((const __m256i *)(src + 2 * i + 32)));
+        const __m256i y = _mm256_permute4x64_epi64(_mm256_packus_epi16(y_lo, y_hi), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)(dst + i), y);
+    }
+
+    rgb5652gray_run_ssse3(src + 2 * i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void rgb2hsv_run_avx2(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i round = _mm256_set1_epi32(HSV_ROUND);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i h_range = _mm256_set1_epi32(HSV_H_RANGE);
+    const __m256i base_g = _mm256_set1_epi32(2 * HSV_H_SECTOR);
+    const __m256i base_b = _mm256_set1_epi32(4 * HSV_H_SECTOR);
+
+    unsigned long i = 0;
+    for (; i + 9 <= n; i += 8)
+    {
+        const __m256i px = _mm256_i32gather_epi32((const int *)(src + 3 * i), offsets, 1);
+        const __m256i r = _mm256_and_si256(_mm256_srli_epi32(px, 8 * R_loc), byte_mask);
+        const __m256i g = _mm256_and_si256(_mm256_srli_epi32(px, 8 * G_loc), byte_mask);
+        const __m256i b = _mm256_and_si256(_mm256_srli_epi32(px, 8 * B_loc), byte_mask);
+
+        const __m256i v = _mm256_max_epi32(r, _mm256_max_epi32(g, b));
+        const __m256i delta = _mm256_sub_epi32(v, _mm256_min_epi32(r, _mm256_min_epi32(g, b)));
+
+        // Same branch order as the scalar loop: R wins ties, then G
+        const __m256i is_r = _mm256_cmpeq_epi32(v, r);
+        const __m256i is_g = _mm256_andnot_si256(is_r, _mm256_cmpeq_epi32(v, g));
+        __m256i diff = _mm256_sub_epi32(r, g);
+        diff = _mm256_blendv_epi8(diff, _mm256_sub_epi32(b, r), is_g);
+        diff = _mm256_blendv_epi8(diff, _mm256_sub_epi32(g, b), is_r);
+        __m256i base = _mm256_blendv_epi8(base_b, base_g, is_g);
+        base = _mm256_blendv_epi8(base, zero, is_r);
+
+        const __m256i hdiv = _mm256_i32gather_epi32(HSV_HDIV, delta, 4);
+        const __m256i sdiv = _mm256_i32gather_epi32(HSV_SDIV, v, 4);
+
+        __m256i hue = _mm256_add_epi32(base, _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(diff, hdiv), round), HSV_SHIFT));
+        hue = _mm256_add_epi32(hue, _mm256_and_si256(_mm256_cmpgt_epi32(zero, hue), h_range));
+        const __m256i sat = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(delta, sdiv), round), HSV_SHIFT);
+
+        uint32_t hsv[8];
+        _mm256_storeu_si256((__m256i *)hsv, _mm256_or_si256(_mm256_or_si256(hue, _mm256_slli_epi32(sat, 8)), _mm256_slli_epi32(v, 16)));
+        for (int k = 0; k < 8; k++)
+        {
+            dst[3 * (i + k) + 0] = (uint8_t)hsv[k];
+            dst[3 * (i + k) + 1] = (uint8_t)(hsv[k] >> 8);
+            dst[3 * (i + k) + 2] = (uint8_t)(hsv[k] >> 16);
+        }
+    }
+
+    rgb2hsv_run_scalar(src + 3 * i, dst + 3 * i, n - i);
+}
+
+#endif // GRAY_HAVE_X86
+
+#ifdef GRAY_HAVE_NEON
+
+static void yuyv2gray_run_neon(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    unsigned long i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint8x16x2_t yuyv = vld2q_u8(src + 2 * i); // val[0] = Y0 Y1 ..., val[1] = U V ...
+        vst1q_u8(dst + i, yuyv.val[0]);
+    }
+
+    yuyv2gray_run_scalar(src + 2 * i, dst + i, n - i);
+}
+
+static inline uint8x8_t rgb565_luma_8_neon(const uint16x8_t p)
+{
+    const uint16x8_t r5 = vshrq_n_u16(p, RGB565_R_SHIFT);
+    const uint16x8_t g6 = vandq_u16(vshrq_n_u16(p, RGB565_G_SHIFT), vdupq_n_u16(RGB565_6_MASK));
+    const uint16x8_t b5 = vandq_u16(p, vdupq_n_u16(RGB565_5_MASK));
+
+    const uint16x8_t r = vorrq_u16(vshlq_n_u16(r5, 3), vshrq_n_u16(r5, 2));
+    const uint16x8_t g = vorrq_u16(vshlq_n_u16(g6, 2), vshrq_n_u16(g6, 4));
+    const uint16x8_t b = vorrq_u16(vshlq_n_u16(b5, 3), vshrq_n_u16(b5, 2));
+
+    uint16x8_t y = vmulq_n_u16(r, W_R);
+    y = vmlaq_n_u16(y, g, W_G);
+    y = vmlaq_n_u16(y, b, W_B);
+    return vshrn_n_u16(y, W_SHIFT);
+}
+
+static void rgb5652gray_run_neon(const uint8_t *src, uint8_t *dst, const unsigned long n)
+{
+    unsigned long i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint16x8_t p_lo = vreinterpretq_u16_u8(vld1q_u8(src + 2 * i));
+        const uint16x8_t p_hi = vreinterpretq_u16_u8(vld1q_u8(src + 2 * i + 16));
+        vst1q_u8(dst + i, vcombine_u8(rgb565_luma_8_neon(p_lo), rgb565_luma_8_neon(p_hi)));
+    }
+
+    rgb5652gray_run_scalar(src + 2 * i, dst + i, n - i);
+}
+
+#endif // GRAY_HAVE_NEON
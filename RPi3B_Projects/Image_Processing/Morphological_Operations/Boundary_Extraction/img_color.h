@@ -0,0 +1,69 @@
+#ifndef IMG_COLOR_H
+#define IMG_COLOR_H
+
+/* ------ Notes Section
+Camera pixel formats -> gray, same fixed-point weights as img_gray.h where RGB is involved:
+- GRAY8  : already gray
+- NV12   : Y plane (w * h) followed by the interleaved UV plane, gray IS the Y plane -> no work at all
+- YUYV   : Y0 U Y1 V per 2 pixels, gray = every 2nd byte
+- RGB565 : little-endian 16-bit words, channels widened to 8 bits (x << 3 | x >> 2), then 77R + 150G + 29B >> 8
+- RGB24  : rgb2gray_u8()
+So for YUV formats nothing goes through RGB, the luma is already there.
+
+RGB -> HSV, OpenCV 8-bit convention: H in [0, 180) (2 degree steps), S and V in [0, 255].
+The two divisions are reciprocal tables in Q12 (S: 255 / V, H: 30 / delta).
+The AVX2 path reads the tables with gathers, the SSSE3 / NEON builds have no gather so they use the scalar loop for HSV.
+
+Every implementation produces the exact same bytes as the scalar one.
+color_init() picks the widest one supported by the running CPU (same choice as rgb2gray_init()).
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_gray.h" // GRAY_IMPLS
+
+// ---- Enums ----
+
+typedef enum
+{
+    PIX_FMT_GRAY8 = 0,
+    PIX_FMT_RGB24 = 1,
+    PIX_FMT_YUYV = 2,   // V4L2_PIX_FMT_YUYV
+    PIX_FMT_NV12 = 3,   // V4L2_PIX_FMT_NV12
+    PIX_FMT_RGB565 = 4, // V4L2_PIX_FMT_RGB565
+    PIX_FMT_COUNT
+} PIX_FORMATS;
+
+enum HSV_FIXED_POINT
+{
+    HSV_SHIFT = 12,
+    HSV_ROUND = 1 << (HSV_SHIFT - 1),
+    HSV_H_RANGE = 180,
+    HSV_H_SECTOR = 30 // 60 degrees in H units
+};
+
+// ---- Function Prototypes ----
+
+void color_init(void);
+int color_force_impl(GRAY_IMPLS impl); // returns -1 if not supported
+GRAY_IMPLS color_active_impl(void);
+
+void yuyv2gray_u8(const uint8_t *img_yuyv, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+void rgb5652gray_u8(const uint8_t *img_rgb565, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+void rgb2hsv_u8(const uint8_t *img_rgb, uint8_t *img_hsv, const unsigned long w, const unsigned long h);
+
+void yuyv2gray_u8_scalar(const uint8_t *img_yuyv, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+void rgb5652gray_u8_scalar(const uint8_t *img_rgb565, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+void rgb2hsv_u8_scalar(const uint8_t *img_rgb, uint8_t *img_hsv, const unsigned long w, const unsigned long h);
+
+// Cheapest way from any format to gray, for whole frames or single rows (NV12 rows are Y-plane rows)
+void color_to_gray_u8(const PIX_FORMATS format, const uint8_t *src, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+const uint8_t *color_gray_view(const PIX_FORMATS format, const uint8_t *frame); // gray without conversion, or NULL
+
+unsigned long color_frame_bytes(const PIX_FORMATS format, const unsigned long w, const unsigned long h);
+unsigned long color_row_bytes(const PIX_FORMATS format, const unsigned long w); // bytes of one row of the gray source plane
+const char *color_format_name(const PIX_FORMATS format);
+int color_format_from_name(const char *name, PIX_FORMATS *format); // "gray" / "1", "rgb" / "3", "yuyv", "nv12", "rgb565"
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef IMG_COMMON_H
+#define IMG_COMMON_H
+
+// ---- Libraries ----
+#include <time.h>
+#include <stdint.h> // uint64_t, SIZE_MAX
+#include <stddef.h> // size_t
+
+// ---- Enums ----
+
+typedef enum
+{
+    SUCCESS = 0,
+    ERR_GENERAL = -1,
+    ERR_ALLOC = -2,
+    ERR_ARGS = -3,
+    ERR_FILE_OPEN = -4,
+    ERR_FILE_FORMAT = -5,
+    ERR_MMAP = -6,
+    ERR_END_OF_STREAM = -7 // frame sources, no more frames will come
+} RETURN_TYPES;
+
+enum IMG_CHANNELS
+{
+    CH_GRAY = 1,
+    CH_RGB = 3
+};
+
+typedef enum
+{
+    MORPH_DILATE = 0,
+    MORPH_ERODE = 1
+} MORPH_OPS;
+
+// ---- Function Implementations ----
+
+static inline double img_now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// w * h * bytes_per_pixel in 64 bits, 0 when it doesn't fit a size_t (unsigned long is 32 bits on the RPi3B:
+// a 65536 x 65536 header would wrap to 0 there and pass every size check after it)
+static inline int img_frame_size(const unsigned long w, const unsigned long h, const unsigned long bytes_per_pixel, size_t *bytes)
+{
+    const uint64_t w64 = w, h64 = h, bpp64 = bytes_per_pixel;
+    if (w64 == 0 || h64 == 0 || bpp64 == 0 || w64 > UINT64_MAX / h64 || w64 * h64 > UINT64_MAX / bpp64 ||
+        w64 * h64 * bpp64 > (uint64_t)SIZE_MAX)
+    {
+        return 0;
+    }
+    *bytes = (size_t)(w64 * h64 * bpp64);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,316 @@
+/* ------ Notes Section
+1) SSSE3 / AVX2 (x86)
+pshufb gathers every 3rd byte of 48 interleaved bytes, so R, G and B planes of 16 pixels
+come out of 3 loads + 9 shuffles + 6 ORs. AVX2 does the same on two 48-byte halves at once
+(pshufb works per 128-bit lane, the masks are just repeated), so no cross-lane fixup is needed.
+Plain SSE2 has no byte shuffle, that's why the 128-bit path needs SSSE3.
+2) NEON (RPi3B)
+vld3q_u8 deinterleaves RGB in hardware, vmull/vmlal keep everything in 16-bit.
+3) The tail (n % 16 or n % 32 pixels) always goes through the scalar loop.
+*/
+
+// ---- Libraries ----
+#include "img_gray.h"
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GRAY_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GRAY_HAVE_NEON 1
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h> // getauxval(), 32-bit Raspbian can run on a core without NEON
+#include <asm/hwcap.h>
+#endif
+#endif
+
+// ---- Typedefs ----
+
+typedef void (*rgb2gray_fn)(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n);
+
+// ---- Function Prototypes ----
+
+static void rgb2gray_run_scalar(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n);
+#ifdef GRAY_HAVE_X86
+static void rgb2gray_run_ssse3(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n);
+static void rgb2gray_run_avx2(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n);
+#endif
+#ifdef GRAY_HAVE_NEON
+static void rgb2gray_run_neon(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n);
+#endif
+
+// ---- Globals ----
+
+static rgb2gray_fn rgb2gray_active = rgb2gray_run_scalar;
+static GRAY_IMPLS rgb2gray_active_id = GRAY_IMPL_SCALAR;
+
+static const char *GRAY_IMPL_NAMES[GRAY_IMPL_COUNT] = {"scalar", "ssse3", "avx2", "neon"};
+
+// ---- Function Implementations ----
+
+void rgb2gray_init(void)
+{
+    static const GRAY_IMPLS preference[] = {GRAY_IMPL_AVX2, GRAY_IMPL_NEON, GRAY_IMPL_SSSE3};
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++)
+    {
+        if (rgb2gray_force_impl(preference[i]) == 0)
+        {
+            return;
+        }
+    }
+    rgb2gray_force_impl(GRAY_IMPL_SCALAR);
+}
+
+int rgb2gray_impl_supported(GRAY_IMPLS impl)
+{
+    switch (impl)
+    {
+    case GRAY_IMPL_SCALAR:
+        return 1;
+
+#ifdef GRAY_HAVE_X86
+    case GRAY_IMPL_SSSE3:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3");
+
+    case GRAY_IMPL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+
+#ifdef GRAY_HAVE_NEON
+    case GRAY_IMPL_NEON:
+#if defined(__arm__) && defined(HWCAP_NEON)
+        return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+        return 1; // mandatory on AArch64
+#endif
+#endif
+
+    default:
+        return 0;
+    }
+}
+
+int rgb2gray_force_impl(GRAY_IMPLS impl)
+{
+    if (!rgb2gray_impl_supported(impl))
+    {
+        return -1;
+    }
+
+    switch (impl)
+    {
+#ifdef GRAY_HAVE_X86
+    case GRAY_IMPL_SSSE3:
+        rgb2gray_active = rgb2gray_run_ssse3;
+        break;
+
+    case GRAY_IMPL_AVX2:
+        rgb2gray_active = rgb2gray_run_avx2;
+        break;
+#endif
+
+#ifdef GRAY_HAVE_NEON
+    case GRAY_IMPL_NEON:
+        rgb2gray_active = rgb2gray_run_neon;
+        break;
+#endif
+
+    default:
+        rgb2gray_active = rgb2gray_run_scalar;
+        break;
+    }
+
+    rgb2gray_active_id = impl;
+    return 0;
+}
+
+GRAY_IMPLS rgb2gray_active_impl(void)
+{
+    return rgb2gray_active_id;
+}
+
+const char *rgb2gray_impl_name(GRAY_IMPLS impl)
+{
+    if (impl < 0 || impl >= GRAY_IMPL_COUNT)
+    {
+        return "unknown";
+    }
+    return GRAY_IMPL_NAMES[impl];
+}
+
+void rgb2gray_u8(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    rgb2gray_active(img_rgb, img_gray, w * h);
+}
+
+void rgb2gray_u8_scalar(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+{
+    rgb2gray_run_scalar(img_rgb, img_gray, w * h);
+}
+
+static void rgb2gray_run_scalar(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n)
+{
+    for (unsigned long i = 0; i < n; i++)
+    {
+        uint8_t R = img_rgb[3 * i + R_loc];
+        uint8_t G = img_rgb[3 * i + G_loc];
+        uint8_t B = img_rgb[3 * i + B_loc];
+
+        // Y ≈ (77R + 150G + 29B) / 256
+        img_gray[i] = (uint8_t)((W_R * R + W_G * G + W_B * B) >> W_SHIFT);
+    }
+}
+
+#ifdef GRAY_HAVE_X86
+
+// pshufb masks, -1 zeroes the byte. Pixel p has R at 3p, G at 3p+1, B at 3p+2 across the 3 loads.
+#define X5 -1, -1, -1, -1, -1
+#define X6 -1, -1, -1, -1, -1, -1
+
+__attribute__((target("ssse3"))) static inline void deinterleave_16_ssse3(const uint8_t *src, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i a0 = _mm_loadu_si128((const __m128i *)(src + 0));
+    const __m128i a1 = _mm_loadu_si128((const __m128i *)(src + 16));
+    const __m128i a2 = _mm_loadu_si128((const __m128i *)(src + 32));
+
+    // _mm_setr_epi8 lists lanes 0..15 (pixel 0..15)
+    const __m128i r0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i r1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i r2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+
+    const __m128i g0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i g1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i g2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+
+    const __m128i b0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i b1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i b2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+    *r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, r0), _mm_shuffle_epi8(a1, r1)), _mm_shuffle_epi8(a2, r2));
+    *g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, g0), _mm_shuffle_epi8(a1, g1)), _mm_shuffle_epi8(a2, g2));
+    *b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, b0), _mm_shuffle_epi8(a1, b1)), _mm_shuffle_epi8(a2, b2));
+}
+
+__attribute__((target("ssse3"))) static void rgb2gray_run_ssse3(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wr = _mm_set1_epi16(W_R);
+    const __m128i wg = _mm_set1_epi16(W_G);
+    const __m128i wb = _mm_set1_epi16(W_B);
+
+    unsigned long i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i r, g, b;
+        deinterleave_16_ssse3(img_rgb + 3 * i, &r, &g, &b);
+
+        __m128i y_lo = _mm_mullo_epi16(_mm_unpacklo_epi8(r, zero), wr);
+        y_lo = _mm_add_epi16(y_lo, _mm_mullo_epi16(_mm_unpacklo_epi8(g, zero), wg));
+        y_lo = _mm_add_epi16(y_lo, _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb));
+
+        __m128i y_hi = _mm_mullo_epi16(_mm_unpackhi_epi8(r, zero), wr);
+        y_hi = _mm_add_epi16(y_hi, _mm_mullo_epi16(_mm_unpackhi_epi8(g, zero), wg));
+        y_hi = _mm_add_epi16(y_hi, _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wb));
+
+        y_lo = _mm_srli_epi16(y_lo, W_SHIFT);
+        y_hi = _mm_srli_epi16(y_hi, W_SHIFT);
+        _mm_storeu_si128((__m128i *)(img_gray + i), _mm_packus_epi16(y_lo, y_hi));
+    }
+
+    rgb2gray_run_scalar(img_rgb + 3 * i, img_gray + i, n - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i load_2x128_avx2(const uint8_t *lo, const uint8_t *hi)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)lo)), _mm_loadu_si128((const __m128i *)hi), 1);
+}
+
+__attribute__((target("avx2"))) static void rgb2gray_run_avx2(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n)
+{
+    // Same masks as the SSSE3 path, repeated in both 128-bit lanes
+    const __m256i r0 = _mm256_setr_epi8(0, 3, 6, 9, 12, 15, X5, X5, 0, 3, 6, 9, 12, 15, X5, X5);
+    const __m256i r1 = _mm256_setr_epi8(X6, 2, 5, 8, 11, 14, X5, X6, 2, 5, 8, 11, 14, X5);
+    const __m256i r2 = _mm256_setr_epi8(X6, X5, 1, 4, 7, 10, 13, X6, X5, 1, 4, 7, 10, 13);
+
+    const __m256i g0 = _mm256_setr_epi8(1, 4, 7, 10, 13, X5, X6, 1, 4, 7, 10, 13, X5, X6);
+    const __m256i g1 = _mm256_setr_epi8(X5, 0, 3, 6, 9, 12, 15, X5, X5, 0, 3, 6, 9, 12, 15, X5);
+    const __m256i g2 = _mm256_setr_epi8(X6, X5, 2, 5, 8, 11, 14, X6, X5, 2, 5, 8, 11, 14);
+
+    const __m256i b0 = _mm256_setr_epi8(2, 5, 8, 11, 14, X5, X6, 2, 5, 8, 11, 14, X5, X6);
+    const __m256i b1 = _mm256_setr_epi8(X5, 1, 4, 7, 10, 13, X6, X5, 1, 4, 7, 10, 13, X6);
+    const __m256i b2 = _mm256_setr_epi8(X5, X5, 0, 3, 6, 9, 12, 15, X5, X5, 0, 3, 6, 9, 12, 15);
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i wr = _mm256_set1_epi16(W_R);
+    const __m256i wg = _mm256_set1_epi16(W_G);
+    const __m256i wb = _mm256_set1_epi16(W_B);
+
+    unsigned long i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        const uint8_t *src = img_rgb + 3 * i; // lane 0 = pixels 0..15, lane 1 = pixels 16..31
+        const __m256i a0 = load_2x128_avx2(src + 0, src + 48);
+        const __m256i a1 = load_2x128_avx2(src + 16, src + 64);
+        const __m256i a2 = load_2x128_avx2(src + 32, src + 80);
+
+        __m256i r = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a0, r0), _mm256_shuffle_epi8(a1, r1)), _mm256_shuffle_epi8(a2, r2));
+        __m256i g = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a0, g0), _mm256_shuffle_epi8(a1, g1)), _mm256_shuffle_epi8(a2, g2));
+        __m256i b = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a0, b0), _mm256_shuffle_epi8(a1, b1)), _mm256_shuffle_epi8(a2, b2));
+
+        // unpack and packus are both per-lane, so the pixel order survives the round trip
+        __m256i y_lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(r, zero), wr);
+        y_lo = _mm256_add_epi16(y_lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(g, zero), wg));
+        y_lo = _mm256_add_epi16(y_lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), wb));
+
+        __m256i y_hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(r, zero), wr);
+        y_hi = _mm256_add_epi16(y_hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(g, zero), wg));
+        y_hi = _mm256_add_epi16(y_hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), wb));
+
+        y_lo = _mm256_srli_epi16(y_lo, W_SHIFT);
+        y_hi = _mm256_srli_epi16(y_hi, W_SHIFT);
+        _mm256_storeu_si256((__m256i *)(img_gray + i), _mm256_packus_epi16(y_lo, y_hi));
+    }
+
+    rgb2gray_run_ssse3(img_rgb + 3 * i, img_gray + i, n - i);
+}
+
+#undef X5
+#undef X6
+
+#endif // GRAY_HAVE_X86
+
+#ifdef GRAY_HAVE_NEON
+
+static void rgb2gray_run_neon(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long n)
+{
+    const uint8x8_t wr = vdup_n_u8(W_R);
+    const uint8x8_t wg = vdup_n_u8(W_G);
+    const uint8x8_t wb = vdup_n_u8(W_B);
+
+    unsigned long i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16x3_t rgb = vld3q_u8(img_rgb + 3 * i);
+
+        uint16x8_t y_lo = vmull_u8(vget_low_u8(rgb.val[R_loc]), wr);
+        y_lo = vmlal_u8(y_lo, vget_low_u8(rgb.val[G_loc]), wg);
+        y_lo = vmlal_u8(y_lo, vget_low_u8(rgb.val[B_loc]), wb);
+
+        uint16x8_t y_hi = vmull_u8(vget_high_u8(rgb.val[R_loc]), wr);
+        y_hi = vmlal_u8(y_hi, vget_high_u8(rgb.val[G_loc]), wg);
+        y_hi = vmlal_u8(y_hi, vget_high_u8(rgb.val[B_loc]), wb);
+
+        vst1q_u8(img_gray + i, vcombine_u8(vshrn_n_u16(y_lo, W_SHIFT), vshrn_n_u16(y_hi, W_SHIFT)));
+    }
+
+    rgb2gray_run_scalar(img_rgb + 3 * i, img_gray + i, n - i);
+}
+
+#endif // GRAY_HAVE_NEON
@@ -0,0 +1,50 @@
+#ifndef IMG_GRAY_H
+#define IMG_GRAY_H
+
+/* ------ Notes Section
+Y ≈ (77R + 150G + 29B) >> 8, computed in 16-bit lanes (max 255 * 256 = 65280, never overflows).
+Every implementation below produces the exact same bytes as rgb2gray_u8_scalar().
+rgb2gray_init() picks the widest one supported by the running CPU, call it once at startup.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+// ---- Enums ----
+
+enum RGB_Locations
+{
+    R_loc = 0,
+    G_loc = 1,
+    B_loc = 2
+};
+
+enum RGB2GRAY_WEIGHTS
+{
+    W_R = 77,
+    W_G = 150,
+    W_B = 29,
+    W_SHIFT = 8
+};
+
+typedef enum
+{
+    GRAY_IMPL_SCALAR = 0,
+    GRAY_IMPL_SSSE3 = 1, // 16 pixels per iteration
+    GRAY_IMPL_AVX2 = 2,  // 32 pixels per iteration
+    GRAY_IMPL_NEON = 3,  // 16 pixels per iteration (RPi3B)
+    GRAY_IMPL_COUNT
+} GRAY_IMPLS;
+
+// ---- Function Prototypes ----
+
+void rgb2gray_init(void);
+void rgb2gray_u8(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+void rgb2gray_u8_scalar(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long w, const unsigned long h);
+
+GRAY_IMPLS rgb2gray_active_impl(void);
+int rgb2gray_impl_supported(GRAY_IMPLS impl);
+int rgb2gray_force_impl(GRAY_IMPLS impl); // for benchmarks and bit-exact checks, returns -1 if not supported
+const char *rgb2gray_impl_name(GRAY_IMPLS impl);
+
+#endif
@@ -0,0 +1,285 @@
+// ---- Libraries ----
+#include "img_io.h"
+
+#include <fcntl.h>    // open()
+#include <unistd.h>   // close(), ftruncate()
+#include <sys/mman.h> // mmap(), madvise(), munmap()
+#include <sys/stat.h> // fstat(), permission macros
+#include <stdio.h>    // snprintf()
+#include <string.h>
+#include <ctype.h>    // isspace(), isdigit()
+
+// ---- Enums and Defines ----
+
+#define FILE_MODES_READ (O_RDONLY)
+#define FILE_MODES_WRITE (O_RDWR | O_CREAT | O_TRUNC)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+enum PNM_SETTINGS
+{
+    PNM_MAXVAL = 255,
+    PNM_MAX_DIM = 1 << 20, // stops the digit loop early, the frame size itself is checked with img_frame_size()
+    SIZE_BUF_HEADER = 64
+};
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES map_file_read(const char *path, img_mapped_t *img);
+static RETURN_TYPES pnm_parse_header(const uint8_t *data, const size_t len, unsigned long *w, unsigned long *h, unsigned long *channels, size_t *header_len, size_t *pixel_bytes);
+static int pnm_next_uint(const uint8_t *data, const size_t len, size_t *pos, unsigned long *value);
+
+// ---- Function Implementations ----
+
+IMG_FORMATS img_format_from_path(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot != NULL && strcmp(dot, ".pgm") == 0)
+    {
+        return IMG_FMT_PGM;
+    }
+    if (dot != NULL && strcmp(dot, ".ppm") == 0)
+    {
+        return IMG_FMT_PPM;
+    }
+    return IMG_FMT_RAW;
+}
+
+RETURN_TYPES img_map_read(const char *path, img_mapped_t *img)
+{
+    RETURN_TYPES ret = map_file_read(path, img);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    size_t header_len = 0;
+    size_t pixel_bytes = 0;
+    ret = pnm_parse_header(img->map, img->map_len, &img->w, &img->h, &img->channels, &header_len, &pixel_bytes);
+    if (ret != SUCCESS || img->map_len - header_len < pixel_bytes)
+    {
+        img_unmap(img);
+        return ERR_FILE_FORMAT;
+    }
+
+    img->format = (img->channels == CH_RGB) ? IMG_FMT_PPM : IMG_FMT_PGM;
+    img->pixels = (uint8_t *)img->map + header_len;
+    return SUCCESS;
+}
+
+RETURN_TYPES img_map_read_raw(const char *path, const unsigned long w, const unsigned long h, const unsigned long channels, img_mapped_t *img)
+{
+    if (channels != CH_GRAY && channels != CH_RGB)
+    {
+        return ERR_ARGS;
+    }
+
+    size_t frame_bytes = 0;
+    if (!img_frame_size(w, h, channels, &frame_bytes))
+    {
+        return ERR_ARGS;
+    }
+
+    RETURN_TYPES ret = img_map_read_packed(path, w, h, frame_bytes, img);
+    if (ret == SUCCESS)
+    {
+        img->channels = channels;
+    }
+    return ret;
+}
+
+RETURN_TYPES img_map_read_packed(const char *path, const unsigned long w, const unsigned long h, const unsigned long frame_bytes, img_mapped_t *img)
+{
+    if (w == 0 || h == 0 || frame_bytes == 0)
+    {
+        return ERR_ARGS;
+    }
+
+    RETURN_TYPES ret = map_file_read(path, img);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    if (img->map_len < frame_bytes)
+    {
+        img_unmap(img);
+        return ERR_FILE_FORMAT;
+    }
+
+    img->w = w;
+    img->h = h;
+    img->channels = 0;
+    img->format = IMG_FMT_RAW;
+    img->pixels = img->map;
+    return SUCCESS;
+}
+
+RETURN_TYPES img_map_write(const char *path, const unsigned long w, const unsigned long h, const unsigned long channels, const IMG_FORMATS format, img_mapped_t *img)
+{
+    size_t pixel_bytes = 0;
+    if (path == NULL || img == NULL || (channels != CH_GRAY && channels != CH_RGB) || !img_frame_size(w, h, channels, &pixel_bytes) ||
+        pixel_bytes > SIZE_MAX - SIZE_BUF_HEADER)
+    {
+        return ERR_ARGS;
+    }
+
+    char header[SIZE_BUF_HEADER] = {'\0'};
+    int header_len = 0;
+    if (format != IMG_FMT_RAW)
+    {
+        header_len = snprintf(header, sizeof(header), "%s\n%lu %lu\n%d\n", (channels == CH_RGB) ? "P6" : "P5", w, h, PNM_MAXVAL);
+        if (header_len <= 0 || header_len >= SIZE_BUF_HEADER)
+        {
+            return ERR_GENERAL;
+        }
+    }
+
+    img->map = NULL;
+    img->fd = open(path, FILE_MODES_WRITE, FILE_PERMISSIONS);
+    if (img->fd == -1)
+    {
+        return ERR_FILE_OPEN;
+    }
+
+    img->map_len = (size_t)header_len + pixel_bytes;
+    if (ftruncate(img->fd, (off_t)img->map_len) == -1)
+    {
+        close(img->fd);
+        img->fd = -1;
+        return ERR_FILE_OPEN;
+    }
+
+    img->map = mmap(NULL, img->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, img->fd, 0);
+    if (img->map == MAP_FAILED)
+    {
+        close(img->fd);
+        img->fd = -1;
+        img->map = NULL;
+        return ERR_MMAP;
+    }
+
+    memcpy(img->map, header, (size_t)header_len);
+    img->w = w;
+    img->h = h;
+    img->channels = channels;
+    img->format = format;
+    img->pixels = (uint8_t *)img->map + header_len;
+    return SUCCESS;
+}
+
+RETURN_TYPES img_unmap(img_mapped_t *img)
+{
+    RETURN_TYPES ret = SUCCESS;
+
+    if (img->map != NULL && munmap(img->map, img->map_len) == -1)
+    {
+        ret = ERR_MMAP;
+    }
+    if (img->fd >= 0 && close(img->fd) == -1)
+    {
+        ret = ERR_GENERAL;
+    }
+    img->map = NULL;
+    img->pixels = NULL;
+    img->fd = -1;
+    return ret;
+}
+
+static RETURN_TYPES map_file_read(const char *path, img_mapped_t *img)
+{
+    if (path == NULL || img == NULL)
+    {
+        return ERR_ARGS;
+    }
+
+    img->map = NULL;
+    img->fd = open(path, FILE_MODES_READ);
+    if (img->fd == -1)
+    {
+        return ERR_FILE_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(img->fd, &st) == -1 || st.st_size <= 0)
+    {
+        close(img->fd);
+        img->fd = -1;
+        return ERR_FILE_FORMAT;
+    }
+
+    img->map_len = (size_t)st.st_size;
+    img->map = mmap(NULL, img->map_len, PROT_READ, MAP_PRIVATE, img->fd, 0);
+    if (img->map == MAP_FAILED)
+    {
+        close(img->fd);
+        img->fd = -1;
+        img->map = NULL;
+        return ERR_MMAP;
+    }
+
+    (void)madvise(img->map, img->map_len, MADV_SEQUENTIAL); // the stages walk the frame top to bottom once
+    return SUCCESS;
+}
+
+static RETURN_TYPES pnm_parse_header(const uint8_t *data, const size_t len, unsigned long *w, unsigned long *h, unsigned long *channels, size_t *header_len, size_t *pixel_bytes)
+{
+    if (len < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6'))
+    {
+        return ERR_FILE_FORMAT;
+    }
+    *channels = (data[1] == '6') ? CH_RGB : CH_GRAY;
+
+    size_t pos = 2;
+    unsigned long maxval = 0;
+    if (!pnm_next_uint(data, len, &pos, w) || !pnm_next_uint(data, len, &pos, h) || !pnm_next_uint(data, len, &pos, &maxval))
+    {
+        return ERR_FILE_FORMAT;
+    }
+    if (*w == 0 || *h == 0 || maxval == 0 || maxval > PNM_MAXVAL || !img_frame_size(*w, *h, *channels, pixel_bytes))
+    {
+        return ERR_FILE_FORMAT;
+    }
+
+    // Exactly one whitespace byte separates maxval from the pixel data
+    if (pos >= len || !isspace(data[pos]))
+    {
+        return ERR_FILE_FORMAT;
+    }
+    *header_len = pos + 1;
+    return SUCCESS;
+}
+
+static int pnm_next_uint(const uint8_t *data, const size_t len, size_t *pos, unsigned long *value)
+{
+    // Skip whitespace and '#' comments up to the end of their line
+    while (*pos < len && (isspace(data[*pos]) || data[*pos] == '#'))
+    {
+        if (data[*pos] == '#')
+        {
+            while (*pos < len && data[*pos] != '\n')
+            {
+                (*pos)++;
+            }
+        }
+        else
+        {
+            (*pos)++;
+        }
+    }
+
+    if (*pos >= len || !isdigit(data[*pos]))
+    {
+        return 0;
+    }
+
+    *value = 0;
+    while (*pos < len && isdigit(data[*pos]))
+    {
+        *value = *value * 10 + (unsigned long)(data[*pos] - '0');
+        if (*value > PNM_MAX_DIM)
+        {
+            return 0;
+        }
+        (*pos)++;
+    }
+    return 1;
+}
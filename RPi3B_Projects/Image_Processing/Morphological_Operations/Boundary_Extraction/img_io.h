@@ -0,0 +1,54 @@
+#ifndef IMG_IO_H
+#define IMG_IO_H
+
+/* ------ Notes Section
+Zero-copy image files: the input is mmap'd read-only and `pixels` points right after the header,
+into the page cache. No read() copies and no heap buffer for the frame.
+The output file is sized with ftruncate, mmap'd MAP_SHARED and the stages write into `pixels` directly.
+
+Formats: binary PGM (P5, gray), binary PPM (P6, RGB), both with maxval <= 255,
+and headerless raw frames (w * h * channels bytes, size given by the caller).
+Packed camera formats (YUYV, NV12, RGB565, see img_color.h) are mapped as raw frames of a given byte size, channels = 0.
+*/
+
+// ---- Libraries ----
+#include <stddef.h>
+#include <stdint.h>
+
+#include "img_common.h"
+
+// ---- Enums ----
+
+typedef enum
+{
+    IMG_FMT_PGM = 0,
+    IMG_FMT_PPM = 1,
+    IMG_FMT_RAW = 2
+} IMG_FORMATS;
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    unsigned long channels;
+    IMG_FORMATS format;
+    uint8_t *pixels; // inside the mapping, w * h * channels bytes, read-only for inputs
+
+    void *map;
+    size_t map_len;
+    int fd;
+} img_mapped_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES img_map_read(const char *path, img_mapped_t *img); // PGM / PPM, format from the magic number
+RETURN_TYPES img_map_read_raw(const char *path, const unsigned long w, const unsigned long h, const unsigned long channels, img_mapped_t *img);
+RETURN_TYPES img_map_read_packed(const char *path, const unsigned long w, const unsigned long h, const unsigned long frame_bytes, img_mapped_t *img);
+RETURN_TYPES img_map_write(const char *path, const unsigned long w, const unsigned long h, const unsigned long channels, const IMG_FORMATS format, img_mapped_t *img);
+RETURN_TYPES img_unmap(img_mapped_t *img); // for outputs the mapping is written back by the kernel, no msync
+
+IMG_FORMATS img_format_from_path(const char *path); // by extension, .pgm / .ppm / anything else is raw
+
+#endif
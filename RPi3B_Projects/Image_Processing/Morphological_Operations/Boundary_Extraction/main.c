@@ -5,28 +5,104 @@ or
 Option B: A - (A-B) (self - Erosion)
 --- Potential Improvements
 1) Make it able to read image inputs and conver them to image matrixes.
-
+   (binary PGM / PPM and raw frames are done, see img_io.c. PNG still needs to be converted first, e.g. with ImageMagick)
+--- Build
+gcc -O2 -Wall *.c -o boundary_extraction -lpthread
+(-mfpu=neon is needed on 32-bit Raspbian for the NEON path, x86 paths are picked at runtime)
+--- Usage
+./boundary_extraction                             : boundary of the built-in 5x5 matrix
+./boundary_extraction --bench [max_width] [threads] : CSV benchmark of every kernel / variant, 64x64 up to 8K (or max_width)
+./boundary_extraction --bench-threads [threads]   : 4K scaling benchmark, 1..threads workers (default: all cores)
+./boundary_extraction <in.pgm|in.ppm> <out>       : boundary of an image file, out is .pgm or raw (and not the input file)
+./boundary_extraction --raw <w> <h> <fmt> <in> <out> : same for a headerless raw frame,
+                                                  fmt = gray / rgb / yuyv / nv12 / rgb565 (or 1 / 3 channels)
+./boundary_extraction --batch <in_dir> <out_dir> [workers] : every .pgm / .ppm of a directory, summary in out_dir/batch_summary.csv
+                                                  (out_dir is created, it must not be in_dir)
+./boundary_extraction --batch-raw <w> <h> <fmt> <in_dir> <out_dir> [workers] : same, every regular file is a raw frame
+./boundary_extraction --replay <frames.raw> <w> <h> <fmt> <fps> [n_frames] [out.raw] : camera stand-in, raw frames replayed
+                                                  at fps (0 = no pacing, looped when n_frames is given), prints capture -> output latency
 */
 
 // ---- Libraries ----
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-// ---- Enums ----
+#include "img_gray.h"
+#include "img_color.h"
+#include "morph_bitpacked.h"
+#include "morph_gray.h"
+#include "morph_parallel.h"
+#include "morph_stream.h"
+#include "pipeline.h"
+#include "batch.h"
+#include "thread_pool.h"
+#include "bench.h"
+#include "ccl.h"
 
 // ---- Function Prototypes ----
-void rgb2gray_u8(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long w, const unsigned long h);
 
-enum RGB_Locations
-{
-    R_loc = 0,
-    G_loc = 1,
-    B_loc = 2
-};
+static void print_u8_matrix(const char *title, const uint8_t *img, const unsigned long w, const unsigned long h);
+static int boundary_of_file(const char *in_path, const char *out_path, const img_raw_desc_t *raw);
+static int boundary_of_dir(const char *in_dir, const char *out_dir, const unsigned long n_workers, const img_raw_desc_t *raw);
+static int boundary_of_replay(const frame_file_opts_t *opts, const char *out_path);
+static int parse_format(const char *name, PIX_FORMATS *format);
 
-int main()
+int main(int argc, char *argv[])
 {
+    // Picks AVX2 / SSSE3 / NEON / scalar once, based on the running CPU, before any path converts a pixel
+    rgb2gray_init();
+    color_init();
+
+    if (argc > 1 && strcmp(argv[1], "--bench-threads") == 0)
+    {
+        return bench_thread_scaling((argc > 2) ? strtoul(argv[2], NULL, 10) : pool_online_cores());
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    {
+        return bench_suite((argc > 2) ? strtoul(argv[2], NULL, 10) : 0, (argc > 3) ? strtoul(argv[3], NULL, 10) : 0);
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--batch") == 0)
+    {
+        return boundary_of_dir(argv[2], argv[3], (argc == 5) ? strtoul(argv[4], NULL, 10) : 0, NULL);
+    }
+    if ((argc == 7 || argc == 8) && strcmp(argv[1], "--batch-raw") == 0)
+    {
+        img_raw_desc_t raw = {.w = strtoul(argv[2], NULL, 10), .h = strtoul(argv[3], NULL, 10)};
+        if (parse_format(argv[4], &raw.format) != SUCCESS)
+        {
+            return ERR_ARGS;
+        }
+        return boundary_of_dir(argv[5], argv[6], (argc == 8) ? strtoul(argv[7], NULL, 10) : 0, &raw);
+    }
+    if (argc == 7 && strcmp(argv[1], "--raw") == 0)
+    {
+        img_raw_desc_t raw = {.w = strtoul(argv[2], NULL, 10), .h = strtoul(argv[3], NULL, 10)};
+        if (parse_format(argv[4], &raw.format) != SUCCESS)
+        {
+            return ERR_ARGS;
+        }
+        return boundary_of_file(argv[5], argv[6], &raw);
+    }
+    if (argc >= 7 && argc <= 9 && strcmp(argv[1], "--replay") == 0)
+    {
+        frame_file_opts_t opts = {.path = argv[2], .w = strtoul(argv[3], NULL, 10), .h = strtoul(argv[4], NULL, 10),
+                                  .fps = strtod(argv[6], NULL), .max_frames = (argc >= 8) ? strtoul(argv[7], NULL, 10) : 0, .loop = (argc >= 8)};
+        if (parse_format(argv[5], &opts.format) != SUCCESS)
+        {
+            return ERR_ARGS;
+        }
+        return boundary_of_replay(&opts, (argc == 9) ? argv[8] : NULL);
+    }
+    if (argc == 3)
+    {
+        return boundary_of_file(argv[1], argv[2], NULL);
+    }
+
     // ----- Settings
-    const bool B_kernel[3][3] = {{0, 1, 0},
+    const bool B_kernel[SE_3X3][SE_3X3] = {{0, 1, 0},
                     {1, 1, 1},
                     {0, 1, 0}};
 
@@ -36,44 +112,150 @@ int main()
                           {0, 1, 0, 1, 0},
                           {0, 0, 0, 0, 0}};
 
-    unsigned long w = sizeof(img_org[0]); unsigned long l = sizeof(img_org[1]);
+    unsigned long w = sizeof(img_org[0]) / sizeof(img_org[0][0]); unsigned long l = sizeof(img_org) / sizeof(img_org[0]);
+    const unsigned long channels = CH_GRAY;
+
+    printf("rgb2gray implementation: %s\n", rgb2gray_impl_name(rgb2gray_active_impl()));
+
+    // ----- Boundary extraction on the bit-packed mask (64 pixels per word)
+    bitmask_t mask_org, mask_boundary;
+    if (bitmask_create(&mask_org, w, l) != SUCCESS || bitmask_create(&mask_boundary, w, l) != SUCCESS)
+    {
+        perror("bitmask_create");
+        return ERR_ALLOC;
+    }
+
+    thread_pool_t pool;
+    if (pool_create(&pool, 0) != SUCCESS)
+    {
+        perror("pool_create");
+        return ERR_GENERAL;
+    }
+
+    bitmask_pack_u8(&img_org[0][0], &mask_org);
+    bitmask_boundary_parallel(&pool, &mask_org, &mask_boundary, B_kernel, BOUNDARY_INNER); // Option B: A - (A ⊖ B)
+
+    uint8_t img_boundary[l][w];
+    bitmask_unpack_u8(&mask_boundary, &img_boundary[0][0]);
+
+    print_u8_matrix("Input", &img_org[0][0], w, l);
+    print_u8_matrix("Boundary", &img_boundary[0][0], w, l);
+
+    // ----- Same boundary, streamed row by row (gray -> erosion -> subtraction, no full-frame intermediates).
+    // If the matrix contains R,G,B, the stream converts it to grayscale row by row on the way in.
+    const strel_t se_cross = strel_cross(1); // == B_kernel
+    stream_boundary_t stream;
+    if (stream_boundary_create(&stream, w, l, channels, &se_cross) != SUCCESS)
+    {
+        perror("stream_boundary_create");
+        return ERR_ALLOC;
+    }
 
-    // img_org = imread("./Image_Inputs/img_boundary_extraction.png"); // CONVERT THIS TO C
+    uint8_t img_boundary_stream[l][w];
+    stream_boundary_frame(&stream, &img_org[0][0], &img_boundary_stream[0][0]);
+    printf("Streaming boundary (%lu bytes of working memory) matches: %s\n", stream_boundary_bytes(&stream),
+           (memcmp(img_boundary, img_boundary_stream, sizeof(img_boundary)) == 0) ? "yes" : "no");
+    stream_boundary_destroy(&stream);
 
-    if (sizeof(img_org[2] == 3)) // if image matrix contains R,G,B, convert it to grayscale first.
+    // ----- Objects of the boundary image: count, bounding box, area, perimeter
+    ccl_result_t objects;
+    if (ccl_label_bitmask(&pool, &mask_boundary, CCL_CONN_8, NULL, &objects) == SUCCESS)
     {
-        uint8_t img_gray[w][l];
-        rgb2gray_u8(img_org, img_gray, w, l);
+        printf("Boundary components (8-connected): %lu\n", objects.n_components);
+        for (unsigned long i = 0; i < objects.n_components; i++)
+        {
+            const ccl_component_t *c = &objects.components[i];
+            printf("  #%lu: bbox (%lu,%lu)-(%lu,%lu), area %lu, perimeter %lu\n", i + 1, c->x_min, c->y_min, c->x_max, c->y_max, c->area, c->perimeter);
+        }
+        ccl_result_destroy(&objects);
     }
 
-    return 0;
+    bitmask_destroy(&mask_org);
+    bitmask_destroy(&mask_boundary);
+    pool_destroy(&pool);
+
+    return SUCCESS;
+}
+
+static void print_u8_matrix(const char *title, const uint8_t *img, const unsigned long w, const unsigned long h)
+{
+    printf("%s (%lux%lu):\n", title, w, h);
+    for (unsigned long y = 0; y < h; y++)
+    {
+        for (unsigned long x = 0; x < w; x++)
+        {
+            printf("%u ", img[y * w + x]);
+        }
+        printf("\n");
+    }
+}
+
+static int boundary_of_file(const char *in_path, const char *out_path, const img_raw_desc_t *raw)
+{
+    const strel_t se_cross = strel_cross(1); // == B_kernel
+
+    RETURN_TYPES ret = pipeline_boundary_file(in_path, out_path, raw, &se_cross);
+    if (ret != SUCCESS)
+    {
+        fprintf(stderr, "Boundary extraction of %s failed (%d)\n", in_path, ret);
+        return ret;
+    }
+    printf("Boundary of %s written to %s\n", in_path, out_path);
+    return SUCCESS;
+}
+
+static int boundary_of_dir(const char *in_dir, const char *out_dir, const unsigned long n_workers, const img_raw_desc_t *raw)
+{
+    const batch_opts_t opts = {.in_dir = in_dir, .out_dir = out_dir, .n_workers = n_workers, .raw = raw, .se = strel_cross(1)};
+    batch_stats_t stats;
+
+    RETURN_TYPES ret = batch_run(&opts, &stats);
+    if (ret != SUCCESS)
+    {
+        fprintf(stderr, "Batch over %s failed (%d)\n", in_dir, ret);
+        return ret;
+    }
+    printf("Batch: %lu files (%lu failed) in %.3f s, %.1f images/s, %.1f MB/s, details in %s/%s\n",
+           stats.files_total, stats.files_failed, stats.seconds, stats.images_per_sec, stats.mbytes_per_sec, out_dir, BATCH_SUMMARY_NAME);
+    return (stats.files_failed == 0) ? SUCCESS : ERR_GENERAL;
 }
 
-void rgb2gray_u8(const uint8_t *img_rgb, uint8_t *img_gray, const unsigned long w, const unsigned long h)
+static int boundary_of_replay(const frame_file_opts_t *opts, const char *out_path)
 {
-    const unsigned long n = w * h;
-
-    for (int i = 0; i < n; i++) {
-        uint8_t R = img_rgb[3*i + 0];
-        uint8_t G = img_rgb[3*i + 1];
-        uint8_t B = img_rgb[3*i + 2];
-
-        // Y ≈ (77R + 150G + 29B) / 256
-        img_gray[i] = (uint8_t)((77u*R + 150u*G + 29u*B) >> 8);
-    }    
-    // uint8_t img_grayscale[len_col][len_row]; // USE MALLOC HERE!!
-    // int test = sizeof(*img_rgb);
-    // // malloc(sizeof(*img_rgb))
-
-    // for (unsigned long i_cols = 0; i_cols < len_col; i_cols++)
-    // {
-    //     for (unsigned long i_rows = 0; i_rows < len_row; i_rows++)
-    //     {
-    //         // uint8_t R = img_rgb[i_cols][i_rows][R_loc]; // Change it later, this is wrong!!
-    //         // uint8_t G = img_rgb[i_cols][i_rows][G_loc]; // Change it later, this is wrong!!
-    //         // uint8_t B = img_rgb[i_cols][i_rows][B_loc]; // Change it later, this is wrong!!
-
-    //         // img_grayscale[i_rows][i_cols] = ((77 * R) + (150 * G) + (29 * B)) >> 8;
-    //     }
-    // }
-}
\ No newline at end of file
+    frame_source_t src;
+    RETURN_TYPES ret = frame_source_open_file(&src, opts);
+    if (ret != SUCCESS)
+    {
+        fprintf(stderr, "Opening %s as %lux%lu %s frames failed (%d)\n", opts->path, opts->w, opts->h, color_format_name(opts->format), ret);
+        return ret;
+    }
+
+    const strel_t se_cross = strel_cross(1); // == B_kernel
+    frame_latency_t lat;
+    const double t0 = img_now_sec();
+    ret = pipeline_boundary_source(&src, &se_cross, out_path, &lat);
+    const double seconds = img_now_sec() - t0;
+    frame_source_close(&src);
+
+    if (ret != SUCCESS)
+    {
+        fprintf(stderr, "Replay of %s failed (%d)\n", opts->path, ret);
+        return ret;
+    }
+    printf("Replay: %lu frames in %.3f s (%.1f fps), %lu dropped, %lu buffers\n",
+           lat.frames, seconds, (seconds > 0) ? (double)lat.frames / seconds : 0, src.frames_dropped, src.n_bufs);
+    printf("Latency capture -> output [ms]: min %.3f, mean %.3f, p50 %.1f, p99 %.1f, max %.3f\n",
+           lat.min_ms, (lat.frames > 0) ? lat.sum_ms / (double)lat.frames : 0, frame_latency_percentile(&lat, 50),
+           frame_latency_percentile(&lat, 99), lat.max_ms);
+    return SUCCESS;
+}
+
+static int parse_format(const char *name, PIX_FORMATS *format)
+{
+    if (color_format_from_name(name, format) != 0)
+    {
+        fprintf(stderr, "Unknown pixel format %s (gray, rgb, yuyv, nv12, rgb565)\n", name);
+        return ERR_ARGS;
+    }
+    return SUCCESS;
+}
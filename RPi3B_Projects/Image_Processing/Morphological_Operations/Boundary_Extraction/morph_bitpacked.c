@@ -0,0 +1,239 @@
+/* ------ Notes Section
+Dilation : out(x) = OR  over b in B of A(x - b)
+Erosion  : out(x) = AND over b in B of A(x + b)
+A horizontal step of 1 pixel is a 1-bit shift of the whole word, with the missing bit carried in
+from the neighbour word, so one word handles 64 pixels per kernel entry.
+The cross B_kernel needs 5 shifted rows per output word, the full 3x3 square needs 9.
+*/
+
+// ---- Libraries ----
+#include "morph_bitpacked.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Function Prototypes ----
+
+static void bitmask_morph_row(const bitmask_t *src, const unsigned long y, const bool kernel[SE_3X3][SE_3X3], MORPH_OPS op, uint64_t *row_out);
+static inline uint64_t tail_mask(const unsigned long w);
+static inline uint64_t load_word(const uint64_t *row, const long i, const unsigned long words_per_row, const uint64_t pad, const uint64_t tail_pad);
+
+// ---- Function Implementations ----
+
+RETURN_TYPES bitmask_create(bitmask_t *mask, const unsigned long w, const unsigned long h)
+{
+    if (mask == NULL || w == 0 || h == 0)
+    {
+        return ERR_ARGS;
+    }
+
+    mask->w = w;
+    mask->h = h;
+    mask->words_per_row = (w + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    mask->bits = calloc(mask->words_per_row * h, sizeof(uint64_t));
+    if (mask->bits == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    return SUCCESS;
+}
+
+void bitmask_destroy(bitmask_t *mask)
+{
+    if (mask == NULL)
+    {
+        return;
+    }
+    free(mask->bits);
+    mask->bits = NULL;
+}
+
+void bitmask_pack_u8(const uint8_t *img, bitmask_t *mask)
+{
+    for (unsigned long y = 0; y < mask->h; y++)
+    {
+        const uint8_t *src = img + y * mask->w;
+        uint64_t *dst = bitmask_row(mask, y);
+
+        for (unsigned long i = 0; i < mask->words_per_row; i++)
+        {
+            const unsigned long x0 = i * BITS_PER_WORD;
+            const unsigned long n = (mask->w - x0 < BITS_PER_WORD) ? (mask->w - x0) : BITS_PER_WORD;
+
+            uint64_t word = 0;
+            for (unsigned long b = 0; b < n; b++)
+            {
+                word |= (uint64_t)(src[x0 + b] != 0) << b;
+            }
+            dst[i] = word;
+        }
+    }
+}
+
+void bitmask_unpack_u8(const bitmask_t *mask, uint8_t *img)
+{
+    for (unsigned long y = 0; y < mask->h; y++)
+    {
+        const uint64_t *src = bitmask_row(mask, y);
+        uint8_t *dst = img + y * mask->w;
+
+        for (unsigned long x = 0; x < mask->w; x++)
+        {
+            dst[x] = (uint8_t)((src[x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1u);
+        }
+    }
+}
+
+RETURN_TYPES bitmask_dilate(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3])
+{
+    if (src == NULL || dst == NULL || src == dst || src->w != dst->w || src->h != dst->h)
+    {
+        return ERR_ARGS;
+    }
+
+    for (unsigned long y = 0; y < src->h; y++)
+    {
+        bitmask_morph_row(src, y, kernel, MORPH_DILATE, bitmask_row(dst, y));
+    }
+    return SUCCESS;
+}
+
+RETURN_TYPES bitmask_erode(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3])
+{
+    if (src == NULL || dst == NULL || src == dst || src->w != dst->w || src->h != dst->h)
+    {
+        return ERR_ARGS;
+    }
+
+    for (unsigned long y = 0; y < src->h; y++)
+    {
+        bitmask_morph_row(src, y, kernel, MORPH_ERODE, bitmask_row(dst, y));
+    }
+    return SUCCESS;
+}
+
+RETURN_TYPES bitmask_boundary(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3], BOUNDARY_TYPES type)
+{
+    if (src == NULL)
+    {
+        return ERR_ARGS;
+    }
+    return bitmask_boundary_rows(src, dst, kernel, type, 0, src->h);
+}
+
+RETURN_TYPES bitmask_boundary_rows(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3], BOUNDARY_TYPES type, const unsigned long y_begin, const unsigned long y_end)
+{
+    if (src == NULL || dst == NULL || src == dst || src->w != dst->w || src->h != dst->h || y_begin > y_end || y_end > src->h)
+    {
+        return ERR_ARGS;
+    }
+
+    // Each output row only depends on src, so the subtraction is fused into the same sweep
+    for (unsigned long y = y_begin; y < y_end; y++)
+    {
+        const uint64_t *a = bitmask_row(src, y);
+        uint64_t *out = bitmask_row(dst, y);
+
+        if (type == BOUNDARY_INNER)
+        {
+            bitmask_morph_row(src, y, kernel, MORPH_ERODE, out);
+            for (unsigned long i = 0; i < src->words_per_row; i++)
+            {
+                out[i] = a[i] & ~out[i];
+            }
+        }
+        else
+        {
+            bitmask_morph_row(src, y, kernel, MORPH_DILATE, out);
+            for (unsigned long i = 0; i < src->words_per_row; i++)
+            {
+                out[i] = out[i] & ~a[i];
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+void bitmask_dilate_row(const bitmask_t *src, const unsigned long y, const bool kernel[SE_3X3][SE_3X3], uint64_t *row_out)
+{
+    bitmask_morph_row(src, y, kernel, MORPH_DILATE, row_out);
+}
+
+void bitmask_erode_row(const bitmask_t *src, const unsigned long y, const bool kernel[SE_3X3][SE_3X3], uint64_t *row_out)
+{
+    bitmask_morph_row(src, y, kernel, MORPH_ERODE, row_out);
+}
+
+static void bitmask_morph_row(const bitmask_t *src, const unsigned long y, const bool kernel[SE_3X3][SE_3X3], MORPH_OPS op, uint64_t *row_out)
+{
+    const unsigned long nw = src->words_per_row;
+    const uint64_t valid = tail_mask(src->w);
+    const uint64_t pad = (op == MORPH_ERODE) ? ~UINT64_C(0) : 0;
+    const uint64_t tail_pad = pad & ~valid; // pixels past w behave like the outside of the image
+
+    for (unsigned long i = 0; i < nw; i++)
+    {
+        row_out[i] = pad; // identity of AND for erosion, of OR for dilation
+    }
+
+    for (int ky = 0; ky < SE_3X3; ky++)
+    {
+        // Dilation reads A(x - b), erosion reads A(x + b)
+        const long dy = (op == MORPH_ERODE) ? (ky - 1) : (1 - ky);
+        const long sy = (long)y + dy;
+        const uint64_t *row = (sy >= 0 && sy < (long)src->h) ? bitmask_row(src, (unsigned long)sy) : NULL;
+
+        for (int kx = 0; kx < SE_3X3; kx++)
+        {
+            if (!kernel[ky][kx])
+            {
+                continue;
+            }
+            const long dx = (op == MORPH_ERODE) ? (kx - 1) : (1 - kx);
+
+            for (unsigned long i = 0; i < nw; i++)
+            {
+                uint64_t v;
+                if (row == NULL)
+                {
+                    v = pad;
+                }
+                else if (dx == 0)
+                {
+                    v = load_word(row, (long)i, nw, pad, tail_pad);
+                }
+                else if (dx < 0) // value at x is A(x - 1): move bits up, carry bit 63 of the previous word
+                {
+                    v = (load_word(row, (long)i, nw, pad, tail_pad) << 1) | (load_word(row, (long)i - 1, nw, pad, tail_pad) >> (BITS_PER_WORD - 1));
+                }
+                else // value at x is A(x + 1): move bits down, carry bit 0 of the next word
+                {
+                    v = (load_word(row, (long)i, nw, pad, tail_pad) >> 1) | (load_word(row, (long)i + 1, nw, pad, tail_pad) << (BITS_PER_WORD - 1));
+                }
+
+                row_out[i] = (op == MORPH_ERODE) ? (row_out[i] & v) : (row_out[i] | v);
+            }
+        }
+    }
+
+    row_out[nw - 1] &= valid;
+}
+
+static inline uint64_t tail_mask(const unsigned long w)
+{
+    const unsigned long rem = w % BITS_PER_WORD;
+    return (rem == 0) ? ~UINT64_C(0) : ((UINT64_C(1) << rem) - 1);
+}
+
+static inline uint64_t load_word(const uint64_t *row, const long i, const unsigned long words_per_row, const uint64_t pad, const uint64_t tail_pad)
+{
+    if (i < 0 || i >= (long)words_per_row)
+    {
+        return pad;
+    }
+    if (i == (long)words_per_row - 1)
+    {
+        return row[i] | tail_pad;
+    }
+    return row[i];
+}
@@ -0,0 +1,70 @@
+#ifndef MORPH_BITPACKED_H
+#define MORPH_BITPACKED_H
+
+/* ------ Notes Section
+Binary image, 1 bit per pixel, each row padded to whole 64-bit words.
+Pixel x of a row lives in bits[x / 64], bit (x % 64), so the leftmost pixel is the LSB.
+Bits past w in the last word of a row are always kept 0.
+
+Outside of the image counts as background (0) for dilation and as foreground (1) for erosion,
+so objects touching the frame don't get an artificial boundary (same as MATLAB imerode/imdilate).
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "img_common.h"
+
+// ---- Enums ----
+
+enum BITMASK_SIZES
+{
+    BITS_PER_WORD = 64,
+    SE_3X3 = 3
+};
+
+typedef enum
+{
+    BOUNDARY_INNER = 0, // A - (A ⊖ B)
+    BOUNDARY_OUTER = 1  // (A ⊕ B) - A
+} BOUNDARY_TYPES;
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    unsigned long words_per_row;
+    uint64_t *bits; // h * words_per_row words
+} bitmask_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES bitmask_create(bitmask_t *mask, const unsigned long w, const unsigned long h);
+void bitmask_destroy(bitmask_t *mask);
+
+void bitmask_pack_u8(const uint8_t *img, bitmask_t *mask);   // any non-zero pixel is foreground
+void bitmask_unpack_u8(const bitmask_t *mask, uint8_t *img); // writes 0 / 1
+
+RETURN_TYPES bitmask_dilate(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3]);
+RETURN_TYPES bitmask_erode(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3]);
+RETURN_TYPES bitmask_boundary(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3], BOUNDARY_TYPES type);
+RETURN_TYPES bitmask_boundary_rows(const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3], BOUNDARY_TYPES type, const unsigned long y_begin, const unsigned long y_end);
+
+// Single output row, used by the other stages to run the same kernel on part of an image
+void bitmask_dilate_row(const bitmask_t *src, const unsigned long y, const bool kernel[SE_3X3][SE_3X3], uint64_t *row_out);
+void bitmask_erode_row(const bitmask_t *src, const unsigned long y, const bool kernel[SE_3X3][SE_3X3], uint64_t *row_out);
+
+static inline uint64_t *bitmask_row(const bitmask_t *mask, const unsigned long y)
+{
+    return mask->bits + y * mask->words_per_row;
+}
+
+static inline int bitmask_get(const bitmask_t *mask, const unsigned long x, const unsigned long y)
+{
+    return (int)((bitmask_row(mask, y)[x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1u);
+}
+
+#endif
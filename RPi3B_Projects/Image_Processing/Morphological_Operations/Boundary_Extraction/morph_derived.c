@@ -0,0 +1,490 @@
+/* ------ Notes Section
+Single-scan gradient, van Herk/Gil-Werman as in morph_gray.c but with two padded sequences read in the same loop:
+the erosion one (offset of the element, pad 255) and the dilation one (reflected offset, pad 0).
+For odd lengths both windows are the same, for even lengths they are one sample apart.
+g / h sweeps keep min and max next to each other, so every source row / pixel is loaded once for both.
+*/
+
+// ---- Libraries ----
+#include "morph_derived.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "morph_parallel.h" // band_rows_for(), band_first_error()
+#include "morph_stream.h"   // stream_openclose_t
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    unsigned long w;
+    unsigned long h;
+    const strel_t *se;
+    MORPH_DERIVED_OPS op;
+    unsigned long band_rows;
+    unsigned long halo_rows;
+    bool streamed;         // opening / closing through the fused row stages (separable elements)
+    RETURN_TYPES *results; // one slot per band
+} derived_band_job_t;
+
+typedef struct
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    unsigned long w;
+    unsigned long k_h;
+    bool cross;        // vertical and horizontal line side by side instead of one after the other
+    uint8_t *line_min; // horizontal result of one row
+    uint8_t *line_max;
+    uint8_t *scratch; // minmax_1d buffers
+} gradient_ctx_t;
+
+// ---- Function Prototypes ----
+
+static void derived_band_task(void *arg, unsigned long index);
+static RETURN_TYPES derived_band_stream(const derived_band_job_t *job, const unsigned long y0, const unsigned long y1, const unsigned long ys, const unsigned long ye);
+static void derived_emit_row(const derived_band_job_t *job, const unsigned long y, uint8_t *out);
+static RETURN_TYPES gradient_separable(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k_h, const unsigned long k_v, const bool cross);
+static void gradient_emit_row(const gradient_ctx_t *ctx, const unsigned long y, const uint8_t *v_min, const uint8_t *v_max);
+static void vhgw_minmax_1d(const uint8_t *in_min, const uint8_t *in_max, uint8_t *out_min, uint8_t *out_max, const unsigned long n, const unsigned long k, uint8_t *scratch);
+
+static inline uint8_t min_u8(const uint8_t a, const uint8_t b)
+{
+    return (a < b) ? a : b;
+}
+
+static inline uint8_t max_u8(const uint8_t a, const uint8_t b)
+{
+    return (a > b) ? a : b;
+}
+
+// ---- Function Implementations ----
+
+RETURN_TYPES gray_morph_derived(thread_pool_t *pool, const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se, MORPH_DERIVED_OPS op)
+{
+    if (src == NULL || dst == NULL || src == dst || se == NULL || w == 0 || h == 0 || op > MORPH_GRADIENT)
+    {
+        return ERR_ARGS;
+    }
+
+    unsigned long left, right, up, down;
+    strel_extent(se, &left, &right, &up, &down);
+    const unsigned long halo = (op == MORPH_GRADIENT) ? up : 2 * up;
+
+    derived_band_job_t job = {.src = src, .dst = dst, .w = w, .h = h, .se = se, .op = op, .halo_rows = halo};
+    job.streamed = (op != MORPH_GRADIENT) && stream_strel_supported(se);
+
+    // The row stages only keep O(k * w) bytes, their bands don't have to fit in L2: fewer halos to recompute
+    job.band_rows = job.streamed ? band_rows_split(h, (pool != NULL) ? pool->n_threads : 1, 2 * halo) : band_rows_for(w, halo);
+
+    const unsigned long n_bands = (h + job.band_rows - 1) / job.band_rows;
+    job.results = calloc(n_bands, sizeof(RETURN_TYPES));
+    if (job.results == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    if (pool != NULL)
+    {
+        pool_run(pool, derived_band_task, &job, n_bands);
+    }
+    else
+    {
+        for (unsigned long b = 0; b < n_bands; b++)
+        {
+            derived_band_task(&job, b);
+        }
+    }
+
+    RETURN_TYPES ret = band_first_error(job.results, n_bands);
+    free(job.results);
+    return ret;
+}
+
+RETURN_TYPES gray_gradient(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se)
+{
+    if (src == NULL || dst == NULL || src == dst || se == NULL || w == 0 || h == 0 || se->width == 0 || (se->shape == SE_RECT && se->height == 0))
+    {
+        return ERR_ARGS;
+    }
+
+    switch (se->shape)
+    {
+    case SE_RECT:
+        return gradient_separable(src, dst, w, h, se->width, se->height, false);
+
+    case SE_CROSS:
+        return gradient_separable(src, dst, w, h, 2 * se->width + 1, 2 * se->width + 1, true);
+
+    case SE_LINE:
+        if (se->angle == LINE_0)
+        {
+            return gradient_separable(src, dst, w, h, se->width, 1, false);
+        }
+        if (se->angle == LINE_90)
+        {
+            return gradient_separable(src, dst, w, h, 1, se->width, false);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // Diagonal lines / diamond: erosion + dilation and a subtraction
+    uint8_t *eroded = malloc(w * h);
+    if (eroded == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    RETURN_TYPES ret = gray_erode(src, eroded, w, h, se);
+    if (ret == SUCCESS && (ret = gray_dilate(src, dst, w, h, se)) == SUCCESS)
+    {
+        const unsigned long n = w * h;
+        for (unsigned long i = 0; i < n; i++)
+        {
+            dst[i] = (uint8_t)(dst[i] - eroded[i]);
+        }
+    }
+    free(eroded);
+    return ret;
+}
+
+static void derived_band_task(void *arg, unsigned long index)
+{
+    derived_band_job_t *job = arg;
+    const unsigned long w = job->w;
+
+    const unsigned long y0 = index * job->band_rows;
+    const unsigned long y1 = (y0 + job->band_rows < job->h) ? (y0 + job->band_rows) : job->h;
+    const unsigned long ys = (y0 > job->halo_rows) ? (y0 - job->halo_rows) : 0;
+    const unsigned long ye = (y1 + job->halo_rows < job->h) ? (y1 + job->halo_rows) : job->h;
+    const uint8_t *in = job->src + ys * w;
+
+    if (job->streamed)
+    {
+        job->results[index] = derived_band_stream(job, y0, y1, ys, ye);
+        return;
+    }
+
+    // Gradient, and opening / closing by a diamond or a diagonal line: whole band through both passes
+    uint8_t *band = malloc((ye - ys) * w);
+    if (band == NULL)
+    {
+        job->results[index] = ERR_ALLOC;
+        return;
+    }
+
+    RETURN_TYPES ret = SUCCESS;
+    switch (job->op)
+    {
+    case MORPH_OPEN:
+    case MORPH_TOPHAT_WHITE:
+        if ((ret = gray_erode(in, band, w, ye - ys, job->se)) == SUCCESS)
+        {
+            ret = gray_dilate(band, band, w, ye - ys, job->se);
+        }
+        break;
+
+    case MORPH_CLOSE:
+    case MORPH_TOPHAT_BLACK:
+        if ((ret = gray_dilate(in, band, w, ye - ys, job->se)) == SUCCESS)
+        {
+            ret = gray_erode(band, band, w, ye - ys, job->se);
+        }
+        break;
+
+    case MORPH_GRADIENT:
+        ret = gray_gradient(in, band, w, ye - ys, job->se);
+        break;
+    }
+
+    if (ret == SUCCESS)
+    {
+        const uint8_t *a = job->src + y0 * w;
+        const uint8_t *b = band + (y0 - ys) * w;
+        uint8_t *out = job->dst + y0 * w;
+        const unsigned long n = (y1 - y0) * w;
+
+        // Opening <= A <= closing, so the top-hats never go negative
+        if (job->op == MORPH_TOPHAT_WHITE)
+        {
+            for (unsigned long i = 0; i < n; i++)
+            {
+                out[i] = (uint8_t)(a[i] - b[i]);
+            }
+        }
+        else if (job->op == MORPH_TOPHAT_BLACK)
+        {
+            for (unsigned long i = 0; i < n; i++)
+            {
+                out[i] = (uint8_t)(b[i] - a[i]);
+            }
+        }
+        else
+        {
+            memcpy(out, b, n);
+        }
+    }
+
+    job->results[index] = ret;
+    free(band);
+}
+
+static RETURN_TYPES derived_band_stream(const derived_band_job_t *job, const unsigned long y0, const unsigned long y1, const unsigned long ys, const unsigned long ye)
+{
+    // The band + halo goes through the row stages, band rows land straight in dst, halo rows in `skip`.
+    // The stream pads at the band edges, the halo rows it gets wrong are exactly the ones thrown away.
+    const bool open = (job->op == MORPH_OPEN || job->op == MORPH_TOPHAT_WHITE);
+    stream_openclose_t stream;
+    RETURN_TYPES ret = stream_openclose_create(&stream, job->w, ye - ys, job->se, open ? MORPH_ERODE : MORPH_DILATE);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    uint8_t *skip = malloc(job->w);
+    if (skip == NULL)
+    {
+        stream_openclose_destroy(&stream);
+        return ERR_ALLOC;
+    }
+
+    // Output row ys + r, r = rows_out, goes to dst when it's one of ours
+#define ROW_OUT(r) ((ys + (r) >= y0 && ys + (r) < y1) ? (job->dst + (ys + (r)) * job->w) : skip)
+
+    for (unsigned long y = ys; y < ye && ys + stream.rows_out < y1; y++)
+    {
+        uint8_t *out = ROW_OUT(stream.rows_out);
+        if (stream_openclose_push(&stream, job->src + y * job->w, out) == 1 && out != skip)
+        {
+            derived_emit_row(job, ys + stream.rows_out - 1, out);
+        }
+    }
+    while (ys + stream.rows_out < y1)
+    {
+        uint8_t *out = ROW_OUT(stream.rows_out);
+        if (stream_openclose_flush(&stream, out) != 1)
+        {
+            ret = ERR_GENERAL;
+            break;
+        }
+        if (out != skip)
+        {
+            derived_emit_row(job, ys + stream.rows_out - 1, out);
+        }
+    }
+
+#undef ROW_OUT
+
+    free(skip);
+    stream_openclose_destroy(&stream);
+    return ret;
+}
+
+static void derived_emit_row(const derived_band_job_t *job, const unsigned long y, uint8_t *out)
+{
+    // out holds the opening / closing of row y, the top-hats take it against the source row
+    const uint8_t *a = job->src + y * job->w;
+    if (job->op == MORPH_TOPHAT_WHITE)
+    {
+        for (unsigned long x = 0; x < job->w; x++)
+        {
+            out[x] = (uint8_t)(a[x] - out[x]);
+        }
+    }
+    else if (job->op == MORPH_TOPHAT_BLACK)
+    {
+        for (unsigned long x = 0; x < job->w; x++)
+        {
+            out[x] = (uint8_t)(out[x] - a[x]);
+        }
+    }
+}
+
+static RETURN_TYPES gradient_separable(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k_h, const unsigned long k_v, const bool cross)
+{
+    // h_min, h_max, g_min, g_max: k_v rows each. pad_min, pad_max, row_min, row_max, line_min, line_max: one row each.
+    const unsigned long k = k_v;
+    const unsigned long block_rows = (k > 1) ? k : 0;
+    uint8_t *mem = malloc(4 * block_rows * w + 6 * w + 6 * (w + k_h));
+    if (mem == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    uint8_t *h_min = mem;
+    uint8_t *h_max = h_min + block_rows * w;
+    uint8_t *g_min = h_max + block_rows * w;
+    uint8_t *g_max = g_min + block_rows * w;
+    uint8_t *pad_min = g_max + block_rows * w;
+    uint8_t *pad_max = pad_min + w;
+    uint8_t *row_min = pad_max + w;
+    uint8_t *row_max = row_min + w;
+
+    const gradient_ctx_t ctx = {.src = src, .dst = dst, .w = w, .k_h = k_h, .cross = cross,
+                                .line_min = row_max + w, .line_max = row_max + 2 * w, .scratch = row_max + 3 * w};
+
+    if (k <= 1)
+    {
+        for (unsigned long y = 0; y < h; y++)
+        {
+            gradient_emit_row(&ctx, y, src + y * w, src + y * w);
+        }
+        free(mem);
+        return SUCCESS;
+    }
+
+    memset(pad_min, PAD_ERODE, w);
+    memset(pad_max, PAD_DILATE, w);
+    const long off_min = gray_window_offset(k, MORPH_ERODE);
+    const long off_max = gray_window_offset(k, MORPH_DILATE);
+
+// Padded row j of the erosion / dilation sequence, or its pad row outside of the image
+#define ROW_OF(j, off, pad) ((((long)(j) + (off)) >= 0 && ((long)(j) + (off)) < (long)h) ? (src + (unsigned long)((long)(j) + (off)) * w) : (pad))
+#define ROW_MIN(j) ROW_OF(j, off_min, pad_min)
+#define ROW_MAX(j) ROW_OF(j, off_max, pad_max)
+
+    for (unsigned long b0 = 0; b0 < h; b0 += k)
+    {
+        // Backward sweep of block [b0, b0 + k)
+        memcpy(h_min + (k - 1) * w, ROW_MIN(b0 + k - 1), w);
+        memcpy(h_max + (k - 1) * w, ROW_MAX(b0 + k - 1), w);
+        for (long i = (long)k - 2; i >= 0; i--)
+        {
+            const uint8_t *p_min = ROW_MIN(b0 + (unsigned long)i);
+            const uint8_t *p_max = ROW_MAX(b0 + (unsigned long)i);
+            const uint8_t *prev_min = h_min + (unsigned long)(i + 1) * w;
+            const uint8_t *prev_max = h_max + (unsigned long)(i + 1) * w;
+            uint8_t *cur_min = h_min + (unsigned long)i * w;
+            uint8_t *cur_max = h_max + (unsigned long)i * w;
+            for (unsigned long x = 0; x < w; x++)
+            {
+                cur_min[x] = min_u8(prev_min[x], p_min[x]);
+                cur_max[x] = max_u8(prev_max[x], p_max[x]);
+            }
+        }
+
+        // Forward sweep of the next block, only its first k - 1 rows are needed
+        memcpy(g_min, ROW_MIN(b0 + k), w);
+        memcpy(g_max, ROW_MAX(b0 + k), w);
+        for (unsigned long i = 1; i + 1 < k; i++)
+        {
+            const uint8_t *p_min = ROW_MIN(b0 + k + i);
+            const uint8_t *p_max = ROW_MAX(b0 + k + i);
+            const uint8_t *prev_min = g_min + (i - 1) * w;
+            const uint8_t *prev_max = g_max + (i - 1) * w;
+            uint8_t *cur_min = g_min + i * w;
+            uint8_t *cur_max = g_max + i * w;
+            for (unsigned long x = 0; x < w; x++)
+            {
+                cur_min[x] = min_u8(prev_min[x], p_min[x]);
+                cur_max[x] = max_u8(prev_max[x], p_max[x]);
+            }
+        }
+
+        const unsigned long rows = (h - b0 < k) ? (h - b0) : k;
+        gradient_emit_row(&ctx, b0, h_min, h_max);
+        for (unsigned long i = 1; i < rows; i++)
+        {
+            const uint8_t *hr_min = h_min + i * w, *gr_min = g_min + (i - 1) * w;
+            const uint8_t *hr_max = h_max + i * w, *gr_max = g_max + (i - 1) * w;
+            for (unsigned long x = 0; x < w; x++)
+            {
+                row_min[x] = min_u8(hr_min[x], gr_min[x]);
+                row_max[x] = max_u8(hr_max[x], gr_max[x]);
+            }
+            gradient_emit_row(&ctx, b0 + i, row_min, row_max);
+        }
+    }
+
+#undef ROW_MAX
+#undef ROW_MIN
+#undef ROW_OF
+
+    free(mem);
+    return SUCCESS;
+}
+
+static void gradient_emit_row(const gradient_ctx_t *ctx, const unsigned long y, const uint8_t *v_min, const uint8_t *v_max)
+{
+    const unsigned long w = ctx->w;
+    uint8_t *out = ctx->dst + y * w;
+
+    if (ctx->cross)
+    {
+        // Union of the two lines: the horizontal one runs on the source row, not on the vertical result
+        const uint8_t *row = ctx->src + y * w;
+        vhgw_minmax_1d(row, row, ctx->line_min, ctx->line_max, w, ctx->k_h, ctx->scratch);
+        for (unsigned long x = 0; x < w; x++)
+        {
+            out[x] = (uint8_t)(max_u8(v_max[x], ctx->line_max[x]) - min_u8(v_min[x], ctx->line_min[x]));
+        }
+        return;
+    }
+
+    if (ctx->k_h > 1)
+    {
+        vhgw_minmax_1d(v_min, v_max, ctx->line_min, ctx->line_max, w, ctx->k_h, ctx->scratch);
+        v_min = ctx->line_min;
+        v_max = ctx->line_max;
+    }
+    for (unsigned long x = 0; x < w; x++)
+    {
+        out[x] = (uint8_t)(v_max[x] - v_min[x]);
+    }
+}
+
+static void vhgw_minmax_1d(const uint8_t *in_min, const uint8_t *in_max, uint8_t *out_min, uint8_t *out_max, const unsigned long n, const unsigned long k, uint8_t *scratch)
+{
+    if (k <= 1)
+    {
+        memcpy(out_min, in_min, n);
+        memcpy(out_max, in_max, n);
+        return;
+    }
+
+    const unsigned long n_pad = n + k - 1;
+    uint8_t *p_min = scratch, *p_max = p_min + n_pad;
+    uint8_t *g_min = p_max + n_pad, *g_max = g_min + n_pad;
+    uint8_t *h_min = g_max + n_pad, *h_max = h_min + n_pad;
+    const long off_min = gray_window_offset(k, MORPH_ERODE);
+    const long off_max = gray_window_offset(k, MORPH_DILATE);
+
+    for (unsigned long j = 0; j < n_pad; j++)
+    {
+        const long s_min = (long)j + off_min, s_max = (long)j + off_max;
+        p_min[j] = (s_min >= 0 && s_min < (long)n) ? in_min[s_min] : PAD_ERODE;
+        p_max[j] = (s_max >= 0 && s_max < (long)n) ? in_max[s_max] : PAD_DILATE;
+    }
+
+    for (unsigned long b0 = 0; b0 < n_pad; b0 += k)
+    {
+        const unsigned long e = (b0 + k < n_pad) ? (b0 + k) : n_pad;
+
+        g_min[b0] = p_min[b0];
+        g_max[b0] = p_max[b0];
+        for (unsigned long j = b0 + 1; j < e; j++)
+        {
+            g_min[j] = min_u8(g_min[j - 1], p_min[j]);
+            g_max[j] = max_u8(g_max[j - 1], p_max[j]);
+        }
+
+        h_min[e - 1] = p_min[e - 1];
+        h_max[e - 1] = p_max[e - 1];
+        for (unsigned long j = e - 1; j > b0; j--)
+        {
+            h_min[j - 1] = min_u8(h_min[j], p_min[j - 1]);
+            h_max[j - 1] = max_u8(h_max[j], p_max[j - 1]);
+        }
+    }
+
+    for (unsigned long x = 0; x < n; x++)
+    {
+        out_min[x] = min_u8(h_min[x], g_min[x + k - 1]);
+        out_max[x] = max_u8(h_max[x], g_max[x + k - 1]);
+    }
+}
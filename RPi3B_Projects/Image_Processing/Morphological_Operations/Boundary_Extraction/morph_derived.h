@@ -0,0 +1,50 @@
+#ifndef MORPH_DERIVED_H
+#define MORPH_DERIVED_H
+
+/* ------ Notes Section
+Operators built from erosion and dilation:
+- opening  : (A ⊖ B) ⊕ B          - closing  : (A ⊕ B) ⊖ B
+- white top-hat : A - opening     - black top-hat : closing - A
+- gradient : (A ⊕ B) - (A ⊖ B)
+
+Opening / closing and the top-hats are fused row streams (stream_openclose_t, morph_stream.h): every row that
+leaves the first stage goes straight into the vertical van Herk/Gil-Werman window of the second one, and the
+final rows are written to dst (minus / from A for the top-hats) as they come out. The intermediate image only
+exists as the k_v rows of that window. The frame is cut into bands for the thread pool, sized by thread count
+since the stream needs no cache-sized band, each reading a 2 * halo margin (the second stage needs correct
+first-stage rows in its halo). SE_DIAMOND and the diagonal lines have no row stage: those bands run gray_erode()
+and gray_dilate() one after the other on a band buffer (same sizing as morph_parallel.c).
+
+The gradient is a single scan: every van Herk/Gil-Werman sweep keeps the running min and max side by side,
+so the source is read once and max - min is written directly, no eroded / dilated images.
+That works for the separable elements (SE_RECT, SE_CROSS, SE_LINE at 0 / 90 degrees),
+SE_DIAMOND and the diagonal lines fall back to erosion + dilation of the band.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_common.h"
+#include "morph_gray.h"
+#include "thread_pool.h"
+
+// ---- Enums ----
+
+typedef enum
+{
+    MORPH_OPEN = 0,
+    MORPH_CLOSE = 1,
+    MORPH_TOPHAT_WHITE = 2,
+    MORPH_TOPHAT_BLACK = 3,
+    MORPH_GRADIENT = 4
+} MORPH_DERIVED_OPS;
+
+// ---- Function Prototypes ----
+
+// pool may be NULL (bands run on the calling thread), src == dst is not allowed
+RETURN_TYPES gray_morph_derived(thread_pool_t *pool, const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se, MORPH_DERIVED_OPS op);
+
+// Whole frame, single min/max scan where the element allows it, src == dst is not allowed
+RETURN_TYPES gray_gradient(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se);
+
+#endif
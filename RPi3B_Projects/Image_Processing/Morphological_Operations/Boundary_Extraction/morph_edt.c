@@ -0,0 +1,272 @@
+// ---- Libraries ----
+#include "morph_edt.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "morph_parallel.h" // band_rows_for()
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    const bitmask_t *mask;
+    EDT_TARGETS target;
+    unsigned long w;
+    unsigned long h;
+    uint32_t *col; // w * h, column distances (not squared), EDT_INF if the column has no target pixel
+
+    uint32_t *dist_sq; // full result, or NULL
+    bitmask_t *dst;    // thresholded result, or NULL
+    uint64_t r_sq;
+    bool inside; // dst bit = (d^2 <= r^2) when true, (d^2 > r^2) when false
+
+    unsigned long band_rows;
+    RETURN_TYPES *results; // one slot per row band
+} edt_job_t;
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES edt_run(thread_pool_t *pool, edt_job_t *job);
+static void edt_run_tasks(thread_pool_t *pool, pool_task_fn fn, edt_job_t *job, const unsigned long n_tasks);
+static void edt_columns_task(void *arg, unsigned long index);
+static void edt_rows_task(void *arg, unsigned long index);
+static void edt_row(const uint32_t *g, uint32_t *d, const unsigned long n, uint32_t *v, double *z);
+static RETURN_TYPES disk_threshold(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const unsigned long radius, EDT_TARGETS target, const bool inside);
+
+// ---- Function Implementations ----
+
+RETURN_TYPES edt_squared(thread_pool_t *pool, const bitmask_t *mask, EDT_TARGETS target, uint32_t *dist_sq)
+{
+    if (mask == NULL || dist_sq == NULL)
+    {
+        return ERR_ARGS;
+    }
+
+    edt_job_t job = {.mask = mask, .target = target, .dist_sq = dist_sq};
+    return edt_run(pool, &job);
+}
+
+RETURN_TYPES bitmask_erode_disk(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const unsigned long radius)
+{
+    return disk_threshold(pool, src, dst, radius, EDT_TO_BACKGROUND, false);
+}
+
+RETURN_TYPES bitmask_dilate_disk(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const unsigned long radius)
+{
+    return disk_threshold(pool, src, dst, radius, EDT_TO_FOREGROUND, true);
+}
+
+static RETURN_TYPES disk_threshold(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const unsigned long radius, EDT_TARGETS target, const bool inside)
+{
+    if (src == NULL || dst == NULL || dst->w != src->w || dst->h != src->h)
+    {
+        return ERR_ARGS;
+    }
+
+    edt_job_t job = {.mask = src, .target = target, .dst = dst, .r_sq = (uint64_t)radius * radius, .inside = inside};
+    return edt_run(pool, &job);
+}
+
+static RETURN_TYPES edt_run(thread_pool_t *pool, edt_job_t *job)
+{
+    const bitmask_t *mask = job->mask;
+    if (mask->w == 0 || mask->h == 0 || mask->w > EDT_MAX_DIM || mask->h > EDT_MAX_DIM)
+    {
+        return ERR_ARGS;
+    }
+
+    job->w = mask->w;
+    job->h = mask->h;
+    job->col = malloc(job->w * job->h * sizeof(uint32_t));
+    if (job->col == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    // Pass 1 over strips of columns, pass 2 over bands of rows. The second needs all of the first.
+    const unsigned long n_strips = (mask->words_per_row + EDT_STRIP_WORDS - 1) / EDT_STRIP_WORDS;
+    edt_run_tasks(pool, edt_columns_task, job, n_strips);
+
+    job->band_rows = band_rows_for(job->w * sizeof(uint32_t), 0);
+    const unsigned long n_bands = (job->h + job->band_rows - 1) / job->band_rows;
+    job->results = calloc(n_bands, sizeof(RETURN_TYPES));
+    if (job->results == NULL)
+    {
+        free(job->col);
+        return ERR_ALLOC;
+    }
+    edt_run_tasks(pool, edt_rows_task, job, n_bands);
+
+    RETURN_TYPES ret = SUCCESS;
+    for (unsigned long b = 0; b < n_bands && ret == SUCCESS; b++)
+    {
+        ret = job->results[b];
+    }
+    free(job->results);
+    free(job->col);
+    return ret;
+}
+
+static void edt_run_tasks(thread_pool_t *pool, pool_task_fn fn, edt_job_t *job, const unsigned long n_tasks)
+{
+    if (pool != NULL)
+    {
+        pool_run(pool, fn, job, n_tasks);
+        return;
+    }
+    for (unsigned long i = 0; i < n_tasks; i++)
+    {
+        fn(job, i);
+    }
+}
+
+static void edt_columns_task(void *arg, unsigned long index)
+{
+    edt_job_t *job = arg;
+    const unsigned long w = job->w, h = job->h;
+    const unsigned long x0 = index * EDT_STRIP_WORDS * BITS_PER_WORD;
+    const unsigned long x1 = (x0 + EDT_STRIP_WORDS * BITS_PER_WORD < w) ? (x0 + EDT_STRIP_WORDS * BITS_PER_WORD) : w;
+    const uint64_t flip = (job->target == EDT_TO_FOREGROUND) ? 0 : ~0ull; // target pixels become 1 bits
+
+    // Forward: distance to the nearest target pixel at or above
+    for (unsigned long y = 0; y < h; y++)
+    {
+        const uint64_t *row = bitmask_row(job->mask, y);
+        const uint32_t *above = (y > 0) ? (job->col + (y - 1) * w) : NULL;
+        uint32_t *cur = job->col + y * w;
+
+        for (unsigned long x = x0; x < x1; x++)
+        {
+            const int is_target = (int)(((row[x / BITS_PER_WORD] ^ flip) >> (x % BITS_PER_WORD)) & 1u);
+            if (is_target)
+            {
+                cur[x] = 0;
+            }
+            else
+            {
+                cur[x] = (y > 0 && above[x] != EDT_INF) ? above[x] + 1 : EDT_INF;
+            }
+        }
+    }
+
+    // Backward: or below, if closer
+    for (unsigned long y = h - 1; y-- > 0;)
+    {
+        const uint32_t *below = job->col + (y + 1) * w;
+        uint32_t *cur = job->col + y * w;
+
+        for (unsigned long x = x0; x < x1; x++)
+        {
+            if (below[x] != EDT_INF && below[x] + 1 < cur[x])
+            {
+                cur[x] = below[x] + 1;
+            }
+        }
+    }
+}
+
+static void edt_rows_task(void *arg, unsigned long index)
+{
+    edt_job_t *job = arg;
+    const unsigned long w = job->w;
+    const unsigned long y0 = index * job->band_rows;
+    const unsigned long y1 = (y0 + job->band_rows < job->h) ? (y0 + job->band_rows) : job->h;
+
+    uint32_t *v = malloc(w * sizeof(uint32_t));
+    double *z = malloc((w + 1) * sizeof(double));
+    uint32_t *d = (job->dist_sq == NULL) ? malloc(w * sizeof(uint32_t)) : NULL;
+    if (v == NULL || z == NULL || (job->dist_sq == NULL && d == NULL))
+    {
+        free(v);
+        free(z);
+        free(d);
+        job->results[index] = ERR_ALLOC;
+        return;
+    }
+
+    for (unsigned long y = y0; y < y1; y++)
+    {
+        uint32_t *row_d = (job->dist_sq != NULL) ? (job->dist_sq + y * w) : d;
+        edt_row(job->col + y * w, row_d, w, v, z);
+
+        if (job->dst == NULL)
+        {
+            continue;
+        }
+
+        // Threshold straight into the packed row, the distances of this row are still in L1
+        uint64_t *out = bitmask_row(job->dst, y);
+        for (unsigned long i = 0; i < job->dst->words_per_row; i++)
+        {
+            const unsigned long xs = i * BITS_PER_WORD;
+            const unsigned long n = (w - xs < BITS_PER_WORD) ? (w - xs) : BITS_PER_WORD;
+
+            uint64_t word = 0;
+            for (unsigned long b = 0; b < n; b++)
+            {
+                const uint32_t dd = row_d[xs + b];
+                const int near = (dd != EDT_INF && dd <= job->r_sq);
+                word |= (uint64_t)(job->inside ? near : !near) << b;
+            }
+            out[i] = word;
+        }
+    }
+
+    free(v);
+    free(z);
+    free(d);
+    job->results[index] = SUCCESS;
+}
+
+static void edt_row(const uint32_t *g, uint32_t *d, const unsigned long n, uint32_t *v, double *z)
+{
+    // f(q) = g(q)^2, parabolas with f(q) = inf are left out of the envelope
+    long k = -1;
+    for (unsigned long q = 0; q < n; q++)
+    {
+        if (g[q] == EDT_INF)
+        {
+            continue;
+        }
+        const double fq = (double)g[q] * g[q] + (double)q * q;
+
+        double s = 0;
+        while (k >= 0)
+        {
+            const double p = v[k];
+            s = (fq - ((double)g[v[k]] * g[v[k]] + p * p)) / (2.0 * ((double)q - p));
+            if (s > z[k])
+            {
+                break;
+            }
+            k--;
+        }
+
+        k++;
+        v[k] = (uint32_t)q;
+        z[k] = (k == 0) ? -1e300 : s;
+        z[k + 1] = 1e300;
+    }
+
+    if (k < 0)
+    {
+        for (unsigned long q = 0; q < n; q++)
+        {
+            d[q] = EDT_INF;
+        }
+        return;
+    }
+
+    k = 0;
+    for (unsigned long q = 0; q < n; q++)
+    {
+        while (z[k + 1] < (double)q)
+        {
+            k++;
+        }
+        const unsigned long dx = (q > v[k]) ? (q - v[k]) : (v[k] - q);
+        d[q] = (uint32_t)(dx * dx + (unsigned long)g[v[k]] * g[v[k]]);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef MORPH_EDT_H
+#define MORPH_EDT_H
+
+/* ------ Notes Section
+Exact Euclidean distance transform of a bit-packed mask, linear in the number of pixels:
+1) Columns: distance to the nearest target pixel in the same column, one forward and one backward sweep
+   (done row by row over strips of columns, so memory is walked contiguously).
+2) Rows: lower envelope of the parabolas (x - q)^2 + g(q)^2 (Felzenszwalb & Huttenlocher, 2012).
+
+Disk morphology by thresholding it, constant time per pixel whatever the radius is,
+with disk = { (dx, dy) : dx^2 + dy^2 <= r^2 }:
+- erosion  : x stays foreground if the nearest background pixel is further than r
+- dilation : x becomes foreground if the nearest foreground pixel is within r
+Outside of the image follows morph_bitpacked.h (foreground for erosion, background for dilation),
+so only background / foreground pixels inside the image count.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_common.h"
+#include "thread_pool.h"
+#include "morph_bitpacked.h"
+
+// ---- Enums and Defines ----
+
+#define EDT_INF UINT32_MAX // no target pixel in the image at all
+
+enum EDT_SETTINGS
+{
+    EDT_MAX_DIM = 32767, // keeps squared distances inside uint32_t
+    EDT_STRIP_WORDS = 4  // column pass: 256 columns per task
+};
+
+typedef enum
+{
+    EDT_TO_BACKGROUND = 0,
+    EDT_TO_FOREGROUND = 1
+} EDT_TARGETS;
+
+// ---- Function Prototypes ----
+
+// Squared distance of every pixel to the nearest target pixel (0 on target pixels), w * h values. pool may be NULL.
+RETURN_TYPES edt_squared(thread_pool_t *pool, const bitmask_t *mask, EDT_TARGETS target, uint32_t *dist_sq);
+
+// src == dst is allowed, pool may be NULL
+RETURN_TYPES bitmask_erode_disk(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const unsigned long radius);
+RETURN_TYPES bitmask_dilate_disk(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const unsigned long radius);
+
+#endif
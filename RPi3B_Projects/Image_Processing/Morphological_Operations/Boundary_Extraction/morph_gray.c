@@ -0,0 +1,446 @@
+/* ------ Notes Section
+van Herk/Gil-Werman, window of k samples starting at x + off:
+1) Pad the input with k - 1 samples and cut it into blocks of k.
+2) g[j] = running min/max from the start of j's block up to j (forward sweep)
+   h[j] = running min/max from j to the end of j's block (backward sweep)
+3) out[x] = op(h[x], g[x + k - 1]), the window always covers the tail of one block and the head of the next.
+So each sample costs 1 comparison in g, 1 in h and 1 for the output, independent of k.
+
+The vertical pass runs the same sweeps on whole rows (k rows of h, k - 1 rows of g),
+so the inner loops go along x and stay contiguous in memory.
+*/
+
+// ---- Libraries ----
+#include "morph_gray.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES line_pass(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const LINE_ANGLES angle, const MORPH_OPS op);
+static RETURN_TYPES line_pass_rows(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const long off, const MORPH_OPS op);
+static RETURN_TYPES line_pass_cols(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const long off, const MORPH_OPS op);
+static RETURN_TYPES line_pass_diag(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const long off, const LINE_ANGLES angle, const MORPH_OPS op);
+static RETURN_TYPES cross_pass(const uint8_t *src, uint8_t *dst, uint8_t *tmp, const unsigned long w, const unsigned long h, const unsigned long radius, const MORPH_OPS op);
+static void vhgw_1d(const uint8_t *in, uint8_t *out, const unsigned long n, const unsigned long k, const long off, const MORPH_OPS op, uint8_t *p, uint8_t *g, uint8_t *hb);
+static inline uint8_t op_u8(const MORPH_OPS op, const uint8_t a, const uint8_t b);
+
+// ---- Function Implementations ----
+
+strel_t strel_rect(const unsigned long width, const unsigned long height)
+{
+    strel_t se = {.shape = SE_RECT, .width = width, .height = height, .angle = LINE_0};
+    return se;
+}
+
+strel_t strel_line(const unsigned long length, const LINE_ANGLES angle)
+{
+    strel_t se = {.shape = SE_LINE, .width = length, .height = 1, .angle = angle};
+    return se;
+}
+
+strel_t strel_cross(const unsigned long radius)
+{
+    strel_t se = {.shape = SE_CROSS, .width = radius, .height = radius, .angle = LINE_0};
+    return se;
+}
+
+strel_t strel_diamond(const unsigned long radius)
+{
+    strel_t se = {.shape = SE_DIAMOND, .width = radius, .height = radius, .angle = LINE_0};
+    return se;
+}
+
+void strel_extent(const strel_t *se, unsigned long *left, unsigned long *right, unsigned long *up, unsigned long *down)
+{
+    unsigned long l = 0, r = 0, u = 0, d = 0;
+
+    switch (se->shape)
+    {
+    case SE_RECT:
+        l = se->width / 2;
+        r = se->width - 1 - l;
+        u = se->height / 2;
+        d = se->height - 1 - u;
+        break;
+
+    case SE_LINE:
+    {
+        const unsigned long lo = se->width / 2, hi = se->width - 1 - se->width / 2;
+        if (se->angle != LINE_90)
+        {
+            l = lo;
+            r = hi;
+        }
+        if (se->angle == LINE_90 || se->angle == LINE_135)
+        {
+            u = lo;
+            d = hi;
+        }
+        else if (se->angle == LINE_45)
+        {
+            u = hi;
+            d = lo;
+        }
+        break;
+    }
+
+    case SE_CROSS:
+    case SE_DIAMOND:
+        l = r = u = d = se->width;
+        break;
+    }
+
+    // Callers use this for halos of both erosion and dilation (reflected), so make it symmetric
+    const unsigned long hx = (l > r) ? l : r, hy = (u > d) ? u : d;
+    *left = *right = hx;
+    *up = *down = hy;
+}
+
+RETURN_TYPES gray_erode(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se)
+{
+    return gray_morph(src, dst, w, h, se, MORPH_ERODE);
+}
+
+RETURN_TYPES gray_dilate(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se)
+{
+    return gray_morph(src, dst, w, h, se, MORPH_DILATE);
+}
+
+RETURN_TYPES gray_morph(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se, MORPH_OPS op)
+{
+    if (src == NULL || dst == NULL || se == NULL || w == 0 || h == 0 || se->width == 0 || (se->shape == SE_RECT && se->height == 0))
+    {
+        return ERR_ARGS;
+    }
+
+    RETURN_TYPES ret = SUCCESS;
+
+    switch (se->shape)
+    {
+    case SE_LINE:
+        return line_pass(src, dst, w, h, se->width, se->angle, op);
+
+    case SE_RECT:
+        if ((ret = line_pass(src, dst, w, h, se->height, LINE_90, op)) != SUCCESS)
+        {
+            return ret;
+        }
+        return line_pass(dst, dst, w, h, se->width, LINE_0, op);
+
+    case SE_CROSS:
+    {
+        uint8_t *tmp = malloc(w * h);
+        if (tmp == NULL)
+        {
+            return ERR_ALLOC;
+        }
+        ret = cross_pass(src, dst, tmp, w, h, se->width, op);
+        free(tmp);
+        return ret;
+    }
+
+    case SE_DIAMOND:
+    {
+        // |x| + |y| <= 2a + 1  ==  L45(2a + 1) ⊕ L135(2a + 1) ⊕ cross(1), even radius adds one more cross(1).
+        // The chain only matches the single-pass result if the intermediates also exist outside of the image,
+        // so it runs on a canvas with an r-pixel pad border and gets cropped at the end.
+        const unsigned long r = se->width;
+        const unsigned long a = (r - 1) / 2;
+        const unsigned long cw = w + 2 * r, ch = h + 2 * r;
+
+        uint8_t *canvas = malloc(cw * ch);
+        uint8_t *tmp = malloc(cw * ch);
+        if (canvas == NULL || tmp == NULL)
+        {
+            free(canvas);
+            free(tmp);
+            return ERR_ALLOC;
+        }
+
+        memset(canvas, (op == MORPH_ERODE) ? PAD_ERODE : PAD_DILATE, cw * ch);
+        for (unsigned long y = 0; y < h; y++)
+        {
+            memcpy(canvas + (y + r) * cw + r, src + y * w, w);
+        }
+
+        if ((ret = line_pass(canvas, canvas, cw, ch, 2 * a + 1, LINE_45, op)) == SUCCESS &&
+            (ret = line_pass(canvas, canvas, cw, ch, 2 * a + 1, LINE_135, op)) == SUCCESS &&
+            (ret = cross_pass(canvas, canvas, tmp, cw, ch, 1, op)) == SUCCESS &&
+            (r % 2 == 0))
+        {
+            ret = cross_pass(canvas, canvas, tmp, cw, ch, 1, op);
+        }
+
+        for (unsigned long y = 0; ret == SUCCESS && y < h; y++)
+        {
+            memcpy(dst + y * w, canvas + (y + r) * cw + r, w);
+        }
+        free(canvas);
+        free(tmp);
+        return ret;
+    }
+
+    default:
+        return ERR_ARGS;
+    }
+}
+
+void gray_line_1d(const uint8_t *in, uint8_t *out, const unsigned long n, const unsigned long k, const MORPH_OPS op, uint8_t *scratch)
+{
+    if (k <= 1)
+    {
+        memmove(out, in, n);
+        return;
+    }
+    const unsigned long n_pad = n + k - 1;
+    vhgw_1d(in, out, n, k, gray_window_offset(k, op), op, scratch, scratch + n_pad, scratch + 2 * n_pad);
+}
+
+unsigned long gray_line_scratch_size(const unsigned long n, const unsigned long k)
+{
+    return 3 * (n + k);
+}
+
+static RETURN_TYPES cross_pass(const uint8_t *src, uint8_t *dst, uint8_t *tmp, const unsigned long w, const unsigned long h, const unsigned long radius, const MORPH_OPS op)
+{
+    // Union of two lines: vertical first since it reads src while dst may alias it
+    RETURN_TYPES ret = line_pass(src, tmp, w, h, 2 * radius + 1, LINE_90, op);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    if ((ret = line_pass(src, dst, w, h, 2 * radius + 1, LINE_0, op)) != SUCCESS)
+    {
+        return ret;
+    }
+
+    const unsigned long n = w * h;
+    for (unsigned long i = 0; i < n; i++)
+    {
+        dst[i] = op_u8(op, dst[i], tmp[i]);
+    }
+    return SUCCESS;
+}
+
+static RETURN_TYPES line_pass(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const LINE_ANGLES angle, const MORPH_OPS op)
+{
+    if (k <= 1)
+    {
+        if (src != dst)
+        {
+            memcpy(dst, src, w * h);
+        }
+        return SUCCESS;
+    }
+
+    const long off = gray_window_offset(k, op);
+
+    switch (angle)
+    {
+    case LINE_0:
+        return line_pass_rows(src, dst, w, h, k, off, op);
+
+    case LINE_90:
+        if (src == dst) // the row-block sweep reads rows after writing earlier ones
+        {
+            uint8_t *tmp = malloc(w * h);
+            if (tmp == NULL)
+            {
+                return ERR_ALLOC;
+            }
+            RETURN_TYPES ret = line_pass_cols(src, tmp, w, h, k, off, op);
+            memcpy(dst, tmp, w * h);
+            free(tmp);
+            return ret;
+        }
+        return line_pass_cols(src, dst, w, h, k, off, op);
+
+    case LINE_45:
+    case LINE_135:
+        return line_pass_diag(src, dst, w, h, k, off, angle, op);
+
+    default:
+        return ERR_ARGS;
+    }
+}
+
+static RETURN_TYPES line_pass_rows(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const long off, const MORPH_OPS op)
+{
+    const unsigned long n_pad = w + k - 1;
+    uint8_t *scratch = malloc(3 * n_pad);
+    if (scratch == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    for (unsigned long y = 0; y < h; y++)
+    {
+        vhgw_1d(src + y * w, dst + y * w, w, k, off, op, scratch, scratch + n_pad, scratch + 2 * n_pad);
+    }
+
+    free(scratch);
+    return SUCCESS;
+}
+
+static RETURN_TYPES line_pass_diag(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const long off, const LINE_ANGLES angle, const MORPH_OPS op)
+{
+    const unsigned long n_max = (w < h) ? w : h;
+    const unsigned long n_pad = n_max + k - 1;
+    uint8_t *scratch = malloc(2 * n_max + 3 * n_pad);
+    if (scratch == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    uint8_t *line_in = scratch;
+    uint8_t *line_out = scratch + n_max;
+    uint8_t *p = line_out + n_max;
+
+    // One diagonal per start pixel on the first row / last row and the first column, walking x upwards
+    const long dy = (angle == LINE_135) ? 1 : -1;
+    const unsigned long count = w + h - 1;
+
+    for (unsigned long d = 0; d < count; d++)
+    {
+        long x0, y0;
+        if (angle == LINE_135)
+        {
+            x0 = (d < h) ? 0 : (long)(d - h + 1);
+            y0 = (d < h) ? (long)(h - 1 - d) : 0;
+        }
+        else
+        {
+            x0 = (d < h) ? 0 : (long)(d - h + 1);
+            y0 = (d < h) ? (long)d : (long)(h - 1);
+        }
+
+        unsigned long n = 0;
+        for (long x = x0, y = y0; x < (long)w && y >= 0 && y < (long)h; x++, y += dy)
+        {
+            line_in[n++] = src[(unsigned long)y * w + (unsigned long)x];
+        }
+
+        vhgw_1d(line_in, line_out, n, k, off, op, p, p + n_pad, p + 2 * n_pad);
+
+        n = 0;
+        for (long x = x0, y = y0; x < (long)w && y >= 0 && y < (long)h; x++, y += dy)
+        {
+            dst[(unsigned long)y * w + (unsigned long)x] = line_out[n++];
+        }
+    }
+
+    free(scratch);
+    return SUCCESS;
+}
+
+static RETURN_TYPES line_pass_cols(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const unsigned long k, const long off, const MORPH_OPS op)
+{
+    uint8_t *hbuf = malloc(k * w);
+    uint8_t *gbuf = malloc(k * w);
+    uint8_t *pad_row = malloc(w);
+    if (hbuf == NULL || gbuf == NULL || pad_row == NULL)
+    {
+        free(hbuf);
+        free(gbuf);
+        free(pad_row);
+        return ERR_ALLOC;
+    }
+    memset(pad_row, (op == MORPH_ERODE) ? PAD_ERODE : PAD_DILATE, w);
+
+// Padded row j is src row j + off, or the pad row outside of the image
+#define PADDED_ROW(j) ((((long)(j) + off) >= 0 && ((long)(j) + off) < (long)h) ? (src + (unsigned long)((long)(j) + off) * w) : pad_row)
+
+    for (unsigned long b0 = 0; b0 < h; b0 += k)
+    {
+        // h rows of block [b0, b0 + k): hbuf[i] = op(P[b0 + i .. b0 + k - 1])
+        memcpy(hbuf + (k - 1) * w, PADDED_ROW(b0 + k - 1), w);
+        for (long i = (long)k - 2; i >= 0; i--)
+        {
+            const uint8_t *p = PADDED_ROW(b0 + (unsigned long)i);
+            const uint8_t *prev = hbuf + (unsigned long)(i + 1) * w;
+            uint8_t *cur = hbuf + (unsigned long)i * w;
+            for (unsigned long x = 0; x < w; x++)
+            {
+                cur[x] = op_u8(op, prev[x], p[x]);
+            }
+        }
+
+        // g rows of the next block: gbuf[i] = op(P[b0 + k .. b0 + k + i]), only i < k - 1 is needed
+        memcpy(gbuf, PADDED_ROW(b0 + k), w);
+        for (unsigned long i = 1; i + 1 < k; i++)
+        {
+            const uint8_t *p = PADDED_ROW(b0 + k + i);
+            const uint8_t *prev = gbuf + (i - 1) * w;
+            uint8_t *cur = gbuf + i * w;
+            for (unsigned long x = 0; x < w; x++)
+            {
+                cur[x] = op_u8(op, prev[x], p[x]);
+            }
+        }
+
+        const unsigned long rows = (h - b0 < k) ? (h - b0) : k;
+        memcpy(dst + b0 * w, hbuf, w);
+        for (unsigned long i = 1; i < rows; i++)
+        {
+            const uint8_t *hr = hbuf + i * w;
+            const uint8_t *gr = gbuf + (i - 1) * w;
+            uint8_t *out = dst + (b0 + i) * w;
+            for (unsigned long x = 0; x < w; x++)
+            {
+                out[x] = op_u8(op, hr[x], gr[x]);
+            }
+        }
+    }
+
+#undef PADDED_ROW
+
+    free(hbuf);
+    free(gbuf);
+    free(pad_row);
+    return SUCCESS;
+}
+
+static void vhgw_1d(const uint8_t *in, uint8_t *out, const unsigned long n, const unsigned long k, const long off, const MORPH_OPS op, uint8_t *p, uint8_t *g, uint8_t *hb)
+{
+    const unsigned long n_pad = n + k - 1;
+    const uint8_t pad = (op == MORPH_ERODE) ? PAD_ERODE : PAD_DILATE;
+
+    // p[j] = in[j + off], pad outside
+    for (unsigned long j = 0; j < n_pad; j++)
+    {
+        const long s = (long)j + off;
+        p[j] = (s >= 0 && s < (long)n) ? in[s] : pad;
+    }
+
+    for (unsigned long b0 = 0; b0 < n_pad; b0 += k)
+    {
+        const unsigned long e = (b0 + k < n_pad) ? (b0 + k) : n_pad;
+
+        g[b0] = p[b0];
+        for (unsigned long j = b0 + 1; j < e; j++)
+        {
+            g[j] = op_u8(op, g[j - 1], p[j]);
+        }
+
+        hb[e - 1] = p[e - 1];
+        for (unsigned long j = e - 1; j > b0; j--)
+        {
+            hb[j - 1] = op_u8(op, hb[j], p[j - 1]);
+        }
+    }
+
+    for (unsigned long x = 0; x < n; x++)
+    {
+        out[x] = op_u8(op, hb[x], g[x + k - 1]);
+    }
+}
+
+static inline uint8_t op_u8(const MORPH_OPS op, const uint8_t a, const uint8_t b)
+{
+    if (op == MORPH_ERODE)
+    {
+        return (a < b) ? a : b;
+    }
+    return (a > b) ? a : b;
+}
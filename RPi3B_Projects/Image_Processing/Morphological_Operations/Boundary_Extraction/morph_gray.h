@@ -0,0 +1,84 @@
+#ifndef MORPH_GRAY_H
+#define MORPH_GRAY_H
+
+/* ------ Notes Section
+Grayscale erosion (min) / dilation (max) with flat structuring elements of any size.
+Every line pass uses the van Herk/Gil-Werman running min/max, about 3 comparisons per pixel
+whatever the line length is. The other shapes are decomposed into line passes:
+- SE_RECT    : horizontal line ∘ vertical line (separable)
+- SE_CROSS   : union of a horizontal and a vertical line -> min/max of the two results
+- SE_DIAMOND : 45° line ∘ 135° line ∘ 3x3 cross (∘ 3x3 cross once more for even radius)
+
+Outside of the image is 255 for erosion and 0 for dilation, same as the bit-packed engine.
+Even lengths have their origin at len / 2, dilation uses the reflected element.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_common.h"
+
+// ---- Enums ----
+
+enum GRAY_PAD_VALUES
+{
+    PAD_ERODE = 255, // outside of the image, neutral for min
+    PAD_DILATE = 0   // neutral for max
+};
+
+typedef enum
+{
+    SE_RECT = 0,
+    SE_LINE = 1,
+    SE_CROSS = 2,
+    SE_DIAMOND = 3
+} SE_SHAPES;
+
+typedef enum
+{
+    LINE_0 = 0,   // horizontal
+    LINE_90 = 1,  // vertical
+    LINE_45 = 2,  // bottom-left to top-right, offsets (t, -t)
+    LINE_135 = 3  // top-left to bottom-right, offsets (t, t)
+} LINE_ANGLES;
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    SE_SHAPES shape;
+    unsigned long width;  // SE_RECT width, SE_LINE length, SE_CROSS / SE_DIAMOND radius
+    unsigned long height; // SE_RECT only
+    LINE_ANGLES angle;    // SE_LINE only
+} strel_t;
+
+// ---- Function Prototypes ----
+
+strel_t strel_rect(const unsigned long width, const unsigned long height);
+strel_t strel_line(const unsigned long length, const LINE_ANGLES angle);
+strel_t strel_cross(const unsigned long radius); // radius 1 == the 3x3 B_kernel
+strel_t strel_diamond(const unsigned long radius);
+
+// src == dst is allowed
+RETURN_TYPES gray_erode(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se);
+RETURN_TYPES gray_dilate(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se);
+RETURN_TYPES gray_morph(const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se, MORPH_OPS op);
+
+// One van Herk/Gil-Werman line on a single row, scratch must hold gray_line_scratch_size(n, k) bytes
+void gray_line_1d(const uint8_t *in, uint8_t *out, const unsigned long n, const unsigned long k, const MORPH_OPS op, uint8_t *scratch);
+unsigned long gray_line_scratch_size(const unsigned long n, const unsigned long k);
+
+// Extent of the element around its origin, used to size halos and line buffers
+void strel_extent(const strel_t *se, unsigned long *left, unsigned long *right, unsigned long *up, unsigned long *down);
+
+// ---- Function Implementations ----
+
+static inline long gray_window_offset(const unsigned long k, const MORPH_OPS op)
+{
+    // Element offsets are [-k/2, k - 1 - k/2]. Erosion reads A(x + b), dilation reads A(x - b).
+    // The window of a line of k samples starts at x + offset.
+    const long c = (long)(k / 2);
+    return (op == MORPH_ERODE) ? -c : -((long)k - 1 - c);
+}
+
+#endif
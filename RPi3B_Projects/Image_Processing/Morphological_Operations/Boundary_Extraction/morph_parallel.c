@@ -0,0 +1,166 @@
+// ---- Libraries ----
+#include "morph_parallel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    unsigned long w;
+    unsigned long h;
+    const strel_t *se;
+    MORPH_OPS op;
+    unsigned long band_rows;
+    unsigned long halo_rows;
+    RETURN_TYPES *results; // one slot per band
+} gray_band_job_t;
+
+typedef struct
+{
+    const bitmask_t *src;
+    bitmask_t *dst;
+    const bool (*kernel)[SE_3X3];
+    BOUNDARY_TYPES type;
+    unsigned long band_rows;
+    RETURN_TYPES *results;
+} bitmask_band_job_t;
+
+// ---- Function Prototypes ----
+
+static void gray_band_task(void *arg, unsigned long index);
+static void bitmask_band_task(void *arg, unsigned long index);
+
+// ---- Function Implementations ----
+
+unsigned long band_rows_for(const unsigned long bytes_per_row, const unsigned long halo_rows)
+{
+    unsigned long rows = BAND_TARGET_BYTES / ((bytes_per_row > 0) ? bytes_per_row : 1);
+
+    // A band much thinner than its halo would spend most of its time on the halo
+    if (rows < 2 * halo_rows)
+    {
+        rows = 2 * halo_rows;
+    }
+    if (rows < BAND_MIN_ROWS)
+    {
+        rows = BAND_MIN_ROWS;
+    }
+    return rows;
+}
+
+unsigned long band_rows_split(const unsigned long h, const unsigned long n_threads, const unsigned long min_rows)
+{
+    // A few bands per thread so uneven ones even out, a single band when nobody shares the work
+    unsigned long rows = (n_threads > 1) ? h / (n_threads * BAND_TASKS_PER_THREAD) : h;
+    if (rows < min_rows)
+    {
+        rows = min_rows;
+    }
+    return (rows > 0) ? rows : 1;
+}
+
+RETURN_TYPES band_first_error(const RETURN_TYPES *results, const unsigned long n_bands)
+{
+    for (unsigned long i = 0; i < n_bands; i++)
+    {
+        if (results[i] != SUCCESS)
+        {
+            return results[i];
+        }
+    }
+    return SUCCESS;
+}
+
+RETURN_TYPES gray_morph_parallel(thread_pool_t *pool, const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se, MORPH_OPS op)
+{
+    if (pool == NULL || src == NULL || dst == NULL || src == dst || se == NULL || w == 0 || h == 0)
+    {
+        return ERR_ARGS;
+    }
+
+    unsigned long left, right, up, down;
+    strel_extent(se, &left, &right, &up, &down);
+    const unsigned long halo = (up > down) ? up : down;
+
+    gray_band_job_t job = {.src = src, .dst = dst, .w = w, .h = h, .se = se, .op = op, .halo_rows = halo};
+    job.band_rows = band_rows_for(w, halo);
+
+    const unsigned long n_bands = (h + job.band_rows - 1) / job.band_rows;
+    job.results = calloc(n_bands, sizeof(RETURN_TYPES));
+    if (job.results == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    pool_run(pool, gray_band_task, &job, n_bands);
+
+    RETURN_TYPES ret = band_first_error(job.results, n_bands);
+    free(job.results);
+    return ret;
+}
+
+RETURN_TYPES bitmask_boundary_parallel(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3], BOUNDARY_TYPES type)
+{
+    if (pool == NULL || src == NULL || dst == NULL || src == dst)
+    {
+        return ERR_ARGS;
+    }
+
+    // Rows only read the 3x3 neighbourhood of src, so bands need no private copy of their halo.
+    // A packed row is 1/8 of a gray one, band_rows_for() would give a handful of huge bands: split by threads instead.
+    bitmask_band_job_t job = {.src = src, .dst = dst, .kernel = kernel, .type = type};
+    job.band_rows = band_rows_split(src->h, pool->n_threads, 1);
+
+    const unsigned long n_bands = (src->h + job.band_rows - 1) / job.band_rows;
+    job.results = calloc(n_bands, sizeof(RETURN_TYPES));
+    if (job.results == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    pool_run(pool, bitmask_band_task, &job, n_bands);
+
+    RETURN_TYPES ret = band_first_error(job.results, n_bands);
+    free(job.results);
+    return ret;
+}
+
+static void gray_band_task(void *arg, unsigned long index)
+{
+    gray_band_job_t *job = arg;
+
+    const unsigned long y0 = index * job->band_rows;
+    const unsigned long y1 = (y0 + job->band_rows < job->h) ? (y0 + job->band_rows) : job->h;
+
+    // Band + halo, clipped to the image. Outside of the image is handled by gray_morph's padding.
+    const unsigned long ys = (y0 > job->halo_rows) ? (y0 - job->halo_rows) : 0;
+    const unsigned long ye = (y1 + job->halo_rows < job->h) ? (y1 + job->halo_rows) : job->h;
+
+    uint8_t *band = malloc((ye - ys) * job->w);
+    if (band == NULL)
+    {
+        job->results[index] = ERR_ALLOC;
+        return;
+    }
+
+    job->results[index] = gray_morph(job->src + ys * job->w, band, job->w, ye - ys, job->se, job->op);
+    if (job->results[index] == SUCCESS)
+    {
+        memcpy(job->dst + y0 * job->w, band + (y0 - ys) * job->w, (y1 - y0) * job->w);
+    }
+    free(band);
+}
+
+static void bitmask_band_task(void *arg, unsigned long index)
+{
+    bitmask_band_job_t *job = arg;
+
+    const unsigned long y0 = index * job->band_rows;
+    const unsigned long y1 = (y0 + job->band_rows < job->src->h) ? (y0 + job->band_rows) : job->src->h;
+
+    job->results[index] = bitmask_boundary_rows(job->src, job->dst, job->kernel, job->type, y0, y1);
+}
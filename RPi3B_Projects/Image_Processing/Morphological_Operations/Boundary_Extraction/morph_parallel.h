@@ -0,0 +1,37 @@
+#ifndef MORPH_PARALLEL_H
+#define MORPH_PARALLEL_H
+
+/* ------ Notes Section
+The image is cut into horizontal bands sized to stay in L2 (BAND_TARGET_BYTES).
+A band reads its halo (the rows the structuring element reaches above and below it)
+straight from the shared, read-only source, works in a private buffer and only writes its own rows back.
+So bands never wait for each other and the result is identical to the single-threaded call.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_common.h"
+#include "thread_pool.h"
+#include "morph_gray.h"
+#include "morph_bitpacked.h"
+
+// ---- Enums ----
+
+enum BAND_SETTINGS
+{
+    BAND_TARGET_BYTES = 256 * 1024,
+    BAND_MIN_ROWS = 8,
+    BAND_TASKS_PER_THREAD = 4 // for bands sized by thread count instead of by cache
+};
+
+// ---- Function Prototypes ----
+
+unsigned long band_rows_for(const unsigned long bytes_per_row, const unsigned long halo_rows);
+unsigned long band_rows_split(const unsigned long h, const unsigned long n_threads, const unsigned long min_rows); // for work that needs no cache-sized band
+RETURN_TYPES band_first_error(const RETURN_TYPES *results, const unsigned long n_bands); // results of the band tasks, in band order
+
+RETURN_TYPES gray_morph_parallel(thread_pool_t *pool, const uint8_t *src, uint8_t *dst, const unsigned long w, const unsigned long h, const strel_t *se, MORPH_OPS op);
+RETURN_TYPES bitmask_boundary_parallel(thread_pool_t *pool, const bitmask_t *src, bitmask_t *dst, const bool kernel[SE_3X3][SE_3X3], BOUNDARY_TYPES type);
+
+#endif
@@ -0,0 +1,595 @@
+// ---- Libraries ----
+#include "morph_rle.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Typedefs ----
+
+// Combines two sorted run lists of one row, out must hold na + nb runs and must not overlap the inputs
+typedef unsigned long (*run_op_fn)(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out);
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES rle_reserve(rle_mask_t *m, const unsigned long extra);
+static RETURN_TYPES rle_push(rle_mask_t *m, const unsigned long x0, const unsigned long x1);
+static RETURN_TYPES rle_horizontal(const rle_mask_t *src, rle_mask_t *out, const unsigned long left, const unsigned long right, MORPH_OPS op);
+static RETURN_TYPES rle_vertical(const rle_mask_t *src, rle_mask_t *out, const unsigned long before, const unsigned long after, MORPH_OPS op);
+static RETURN_TYPES rle_combine(const rle_mask_t *a, const rle_mask_t *b, rle_mask_t *out, run_op_fn fn);
+static unsigned long runs_union(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out);
+static unsigned long runs_intersect(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out);
+static unsigned long runs_subtract(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out);
+static unsigned long bits_find(const uint64_t *row, const unsigned long words, const unsigned long x, const int set, const unsigned long w);
+
+// ---- Function Implementations ----
+
+RETURN_TYPES rle_create(rle_mask_t *m, const unsigned long w, const unsigned long h)
+{
+    if (m == NULL || w == 0 || h == 0 || w > UINT32_MAX)
+    {
+        return ERR_ARGS;
+    }
+
+    memset(m, 0, sizeof(*m));
+    m->w = w;
+    m->h = h;
+    m->row_start = calloc(h + 1, sizeof(unsigned long));
+    m->runs = malloc(RLE_MIN_CAPACITY * sizeof(rle_run_t));
+    if (m->row_start == NULL || m->runs == NULL)
+    {
+        rle_destroy(m);
+        return ERR_ALLOC;
+    }
+    m->capacity = RLE_MIN_CAPACITY;
+    return SUCCESS;
+}
+
+void rle_destroy(rle_mask_t *m)
+{
+    free(m->runs);
+    free(m->row_start);
+    m->runs = NULL;
+    m->row_start = NULL;
+    m->n_runs = m->capacity = 0;
+}
+
+RETURN_TYPES rle_from_u8(const uint8_t *img, rle_mask_t *m)
+{
+    m->n_runs = 0;
+    for (unsigned long y = 0; y < m->h; y++)
+    {
+        const uint8_t *row = img + y * m->w;
+        unsigned long x = 0;
+        while (x < m->w)
+        {
+            while (x < m->w && row[x] == 0)
+            {
+                x++;
+            }
+            const unsigned long x0 = x;
+            while (x < m->w && row[x] != 0)
+            {
+                x++;
+            }
+            if (x > x0 && rle_push(m, x0, x) != SUCCESS)
+            {
+                return ERR_ALLOC;
+            }
+        }
+        m->row_start[y + 1] = m->n_runs;
+    }
+    return SUCCESS;
+}
+
+void rle_to_u8(const rle_mask_t *m, uint8_t *img)
+{
+    memset(img, 0, m->w * m->h);
+    for (unsigned long y = 0; y < m->h; y++)
+    {
+        unsigned long n;
+        const rle_run_t *runs = rle_row(m, y, &n);
+        for (unsigned long i = 0; i < n; i++)
+        {
+            memset(img + y * m->w + runs[i].x0, 1, runs[i].x1 - runs[i].x0);
+        }
+    }
+}
+
+RETURN_TYPES rle_from_bitmask(const bitmask_t *mask, rle_mask_t *m)
+{
+    if (mask->w != m->w || mask->h != m->h)
+    {
+        return ERR_ARGS;
+    }
+
+    // Jumps from edge to edge with ctz, whole words of 0s or 1s cost one test each
+    m->n_runs = 0;
+    for (unsigned long y = 0; y < m->h; y++)
+    {
+        const uint64_t *row = bitmask_row(mask, y);
+        unsigned long x = 0;
+        while ((x = bits_find(row, mask->words_per_row, x, 1, m->w)) < m->w)
+        {
+            const unsigned long x1 = bits_find(row, mask->words_per_row, x, 0, m->w);
+            if (rle_push(m, x, x1) != SUCCESS)
+            {
+                return ERR_ALLOC;
+            }
+            x = x1;
+        }
+        m->row_start[y + 1] = m->n_runs;
+    }
+    return SUCCESS;
+}
+
+void rle_to_bitmask(const rle_mask_t *m, bitmask_t *mask)
+{
+    for (unsigned long y = 0; y < m->h; y++)
+    {
+        uint64_t *row = bitmask_row(mask, y);
+        memset(row, 0, mask->words_per_row * sizeof(uint64_t));
+
+        unsigned long n;
+        const rle_run_t *runs = rle_row(m, y, &n);
+        for (unsigned long i = 0; i < n; i++)
+        {
+            const unsigned long w0 = runs[i].x0 / BITS_PER_WORD, w1 = (runs[i].x1 - 1) / BITS_PER_WORD;
+            const uint64_t first = ~0ull << (runs[i].x0 % BITS_PER_WORD);
+            const uint64_t last = ~0ull >> (BITS_PER_WORD - 1 - (runs[i].x1 - 1) % BITS_PER_WORD);
+
+            if (w0 == w1)
+            {
+                row[w0] |= first & last;
+                continue;
+            }
+            row[w0] |= first;
+            for (unsigned long k = w0 + 1; k < w1; k++)
+            {
+                row[k] = ~0ull;
+            }
+            row[w1] |= last;
+        }
+    }
+}
+
+RETURN_TYPES rle_erode(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se)
+{
+    return rle_morph(src, dst, se, MORPH_ERODE);
+}
+
+RETURN_TYPES rle_dilate(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se)
+{
+    return rle_morph(src, dst, se, MORPH_DILATE);
+}
+
+RETURN_TYPES rle_morph(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se, MORPH_OPS op)
+{
+    if (src == NULL || dst == NULL || se == NULL || se->width == 0 || src->w != dst->w || src->h != dst->h)
+    {
+        return ERR_ARGS;
+    }
+
+    // Exact extents (strel_extent() rounds them up to symmetric halos), even lengths have their origin at len / 2
+    unsigned long left = 0, right = 0, up = 0, down = 0;
+    int horizontal = 1; // SE_LINE only: which of the two passes it is
+    switch (se->shape)
+    {
+    case SE_RECT:
+        left = se->width / 2;
+        right = se->width - 1 - left;
+        up = se->height / 2;
+        down = se->height - 1 - up;
+        break;
+
+    case SE_LINE:
+        if (se->angle != LINE_0 && se->angle != LINE_90)
+        {
+            return ERR_ARGS;
+        }
+        horizontal = (se->angle == LINE_0);
+        left = up = se->width / 2;
+        right = down = se->width - 1 - se->width / 2;
+        break;
+
+    case SE_CROSS:
+        left = right = up = down = se->width;
+        break;
+
+    default:
+        return ERR_ARGS;
+    }
+
+    // Dilation uses the reflected element
+    const unsigned long before_x = (op == MORPH_ERODE) ? left : right, after_x = (op == MORPH_ERODE) ? right : left;
+    const unsigned long before_y = (op == MORPH_ERODE) ? up : down, after_y = (op == MORPH_ERODE) ? down : up;
+
+    rle_mask_t out, tmp = {0}, tmp_v = {0};
+    RETURN_TYPES ret = rle_create(&out, src->w, src->h);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    if (se->shape == SE_RECT)
+    {
+        ret = rle_create(&tmp, src->w, src->h);
+        ret = (ret == SUCCESS) ? rle_horizontal(src, &tmp, before_x, after_x, op) : ret;
+        ret = (ret == SUCCESS) ? rle_vertical(&tmp, &out, before_y, after_y, op) : ret;
+    }
+    else if (se->shape == SE_CROSS)
+    {
+        // Union of a horizontal and a vertical line: min / max of the two results
+        ret = rle_create(&tmp, src->w, src->h);
+        ret = (ret == SUCCESS) ? rle_create(&tmp_v, src->w, src->h) : ret;
+        ret = (ret == SUCCESS) ? rle_horizontal(src, &tmp, before_x, after_x, op) : ret;
+        ret = (ret == SUCCESS) ? rle_vertical(src, &tmp_v, before_y, after_y, op) : ret;
+        ret = (ret == SUCCESS) ? rle_combine(&tmp, &tmp_v, &out, (op == MORPH_ERODE) ? runs_intersect : runs_union) : ret;
+    }
+    else
+    {
+        ret = horizontal ? rle_horizontal(src, &out, before_x, after_x, op) : rle_vertical(src, &out, before_y, after_y, op);
+    }
+
+    if (tmp.row_start != NULL)
+    {
+        rle_destroy(&tmp);
+    }
+    if (tmp_v.row_start != NULL)
+    {
+        rle_destroy(&tmp_v);
+    }
+    if (ret != SUCCESS)
+    {
+        rle_destroy(&out);
+        return ret;
+    }
+
+    rle_destroy(dst);
+    *dst = out;
+    return SUCCESS;
+}
+
+RETURN_TYPES rle_boundary(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se, BOUNDARY_TYPES type)
+{
+    if (src == NULL || dst == NULL || src->w != dst->w || src->h != dst->h)
+    {
+        return ERR_ARGS;
+    }
+
+    rle_mask_t morphed, out;
+    RETURN_TYPES ret = rle_create(&morphed, src->w, src->h);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+    ret = rle_create(&out, src->w, src->h);
+    if (ret != SUCCESS)
+    {
+        rle_destroy(&morphed);
+        return ret;
+    }
+
+    ret = rle_morph(src, &morphed, se, (type == BOUNDARY_INNER) ? MORPH_ERODE : MORPH_DILATE);
+    if (ret == SUCCESS)
+    {
+        // Inner: A - (A ⊖ B), outer: (A ⊕ B) - A
+        ret = (type == BOUNDARY_INNER) ? rle_combine(src, &morphed, &out, runs_subtract) : rle_combine(&morphed, src, &out, runs_subtract);
+    }
+    rle_destroy(&morphed);
+    if (ret != SUCCESS)
+    {
+        rle_destroy(&out);
+        return ret;
+    }
+
+    rle_destroy(dst);
+    *dst = out;
+    return SUCCESS;
+}
+
+unsigned long rle_area(const rle_mask_t *m)
+{
+    unsigned long area = 0;
+    for (unsigned long i = 0; i < m->n_runs; i++)
+    {
+        area += m->runs[i].x1 - m->runs[i].x0;
+    }
+    return area;
+}
+
+unsigned long rle_bytes(const rle_mask_t *m)
+{
+    return m->n_runs * sizeof(rle_run_t) + (m->h + 1) * sizeof(unsigned long);
+}
+
+static RETURN_TYPES rle_reserve(rle_mask_t *m, const unsigned long extra)
+{
+    if (m->n_runs + extra <= m->capacity)
+    {
+        return SUCCESS;
+    }
+
+    unsigned long capacity = (m->capacity > 0) ? m->capacity : RLE_MIN_CAPACITY;
+    while (capacity < m->n_runs + extra)
+    {
+        capacity *= 2;
+    }
+    rle_run_t *runs = realloc(m->runs, capacity * sizeof(rle_run_t));
+    if (runs == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    m->runs = runs;
+    m->capacity = capacity;
+    return SUCCESS;
+}
+
+static RETURN_TYPES rle_push(rle_mask_t *m, const unsigned long x0, const unsigned long x1)
+{
+    if (rle_reserve(m, 1) != SUCCESS)
+    {
+        return ERR_ALLOC;
+    }
+    m->runs[m->n_runs++] = (rle_run_t){.x0 = (uint32_t)x0, .x1 = (uint32_t)x1};
+    return SUCCESS;
+}
+
+static RETURN_TYPES rle_horizontal(const rle_mask_t *src, rle_mask_t *out, const unsigned long left, const unsigned long right, MORPH_OPS op)
+{
+    // Pixel x looks at [x - left, x + right], so a run [x0, x1) becomes
+    // erosion  : [x0 + left, x1 - right), except where it touches the frame (outside is foreground)
+    // dilation : [x0 - left, x1 + right) with left / right already swapped by the caller (reflection)
+    const unsigned long w = src->w;
+    if (rle_reserve(out, src->n_runs) != SUCCESS)
+    {
+        return ERR_ALLOC;
+    }
+
+    out->n_runs = 0;
+    for (unsigned long y = 0; y < src->h; y++)
+    {
+        unsigned long n;
+        const rle_run_t *runs = rle_row(src, y, &n);
+        for (unsigned long i = 0; i < n; i++)
+        {
+            unsigned long x0, x1;
+            if (op == MORPH_ERODE)
+            {
+                x0 = (runs[i].x0 == 0) ? 0 : runs[i].x0 + left;
+                x1 = (runs[i].x1 == w) ? w : ((runs[i].x1 > right) ? runs[i].x1 - right : 0);
+                if (x0 >= x1)
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                x0 = (runs[i].x0 > right) ? runs[i].x0 - right : 0;
+                x1 = (runs[i].x1 + left < w) ? runs[i].x1 + left : w;
+
+                // Grown runs can reach the previous one of the same row
+                if (out->n_runs > out->row_start[y] && x0 <= out->runs[out->n_runs - 1].x1)
+                {
+                    rle_run_t *prev = &out->runs[out->n_runs - 1];
+                    prev->x1 = (uint32_t)((x1 > prev->x1) ? x1 : prev->x1);
+                    continue;
+                }
+            }
+            out->runs[out->n_runs++] = (rle_run_t){.x0 = (uint32_t)x0, .x1 = (uint32_t)x1};
+        }
+        out->row_start[y + 1] = out->n_runs;
+    }
+    return SUCCESS;
+}
+
+static RETURN_TYPES rle_vertical(const rle_mask_t *src, rle_mask_t *out, const unsigned long before, const unsigned long after, MORPH_OPS op)
+{
+    // Output row y combines input rows [y - before, y + after]. The input is padded to rows
+    // v = y + before, with the identity (empty / full row) outside of the image, then level j of the table
+    // holds rows [v, v + 2^j). Row y is level(top)[y] op level(top)[y + k - span], the two overlap.
+    const unsigned long w = src->w, h = src->h;
+    const unsigned long k = before + after + 1, rows = h + k - 1;
+    const run_op_fn fn = (op == MORPH_ERODE) ? runs_intersect : runs_union;
+    const rle_run_t full = {.x0 = 0, .x1 = (uint32_t)w};
+
+    unsigned long span = 1;
+    while (span * 2 <= k)
+    {
+        span *= 2;
+    }
+
+    rle_mask_t cur, next;
+    if (rle_create(&cur, w, rows) != SUCCESS)
+    {
+        return ERR_ALLOC;
+    }
+    if (rle_create(&next, w, rows) != SUCCESS)
+    {
+        rle_destroy(&cur);
+        return ERR_ALLOC;
+    }
+
+    RETURN_TYPES ret = rle_reserve(&cur, src->n_runs + (k - 1));
+    for (unsigned long v = 0; v < rows && ret == SUCCESS; v++)
+    {
+        if (v >= before && v - before < h)
+        {
+            unsigned long n;
+            const rle_run_t *runs = rle_row(src, v - before, &n);
+            memcpy(cur.runs + cur.n_runs, runs, n * sizeof(rle_run_t));
+            cur.n_runs += n;
+        }
+        else if (op == MORPH_ERODE)
+        {
+            cur.runs[cur.n_runs++] = full;
+        }
+        cur.row_start[v + 1] = cur.n_runs;
+    }
+
+    for (unsigned long step = 1; step < span && ret == SUCCESS; step *= 2)
+    {
+        next.n_runs = 0;
+        for (unsigned long v = 0; v < rows && ret == SUCCESS; v++)
+        {
+            unsigned long na, nb = 0;
+            const rle_run_t *a = rle_row(&cur, v, &na);
+            const rle_run_t *b = (v + step < rows) ? rle_row(&cur, v + step, &nb) : NULL;
+            if ((ret = rle_reserve(&next, na + nb)) != SUCCESS)
+            {
+                break;
+            }
+
+            if (b != NULL)
+            {
+                next.n_runs += fn(a, na, b, nb, next.runs + next.n_runs);
+            }
+            else
+            {
+                // Only reached by windows that are never read at the top level
+                memcpy(next.runs + next.n_runs, a, na * sizeof(rle_run_t));
+                next.n_runs += na;
+            }
+            next.row_start[v + 1] = next.n_runs;
+        }
+
+        const rle_mask_t swap = cur;
+        cur = next;
+        next = swap;
+    }
+
+    out->n_runs = 0;
+    for (unsigned long y = 0; y < h && ret == SUCCESS; y++)
+    {
+        unsigned long na, nb;
+        const rle_run_t *a = rle_row(&cur, y, &na);
+        const rle_run_t *b = rle_row(&cur, y + k - span, &nb);
+        if ((ret = rle_reserve(out, na + nb)) != SUCCESS)
+        {
+            break;
+        }
+        out->n_runs += fn(a, na, b, nb, out->runs + out->n_runs);
+        out->row_start[y + 1] = out->n_runs;
+    }
+
+    rle_destroy(&cur);
+    rle_destroy(&next);
+    return ret;
+}
+
+static RETURN_TYPES rle_combine(const rle_mask_t *a, const rle_mask_t *b, rle_mask_t *out, run_op_fn fn)
+{
+    out->n_runs = 0;
+    for (unsigned long y = 0; y < a->h; y++)
+    {
+        unsigned long na, nb;
+        const rle_run_t *ra = rle_row(a, y, &na);
+        const rle_run_t *rb = rle_row(b, y, &nb);
+        if (rle_reserve(out, na + nb) != SUCCESS)
+        {
+            return ERR_ALLOC;
+        }
+        out->n_runs += fn(ra, na, rb, nb, out->runs + out->n_runs);
+        out->row_start[y + 1] = out->n_runs;
+    }
+    return SUCCESS;
+}
+
+static unsigned long runs_union(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out)
+{
+    unsigned long i = 0, j = 0, n = 0;
+    while (i < na || j < nb)
+    {
+        const rle_run_t r = (j >= nb || (i < na && a[i].x0 <= b[j].x0)) ? a[i++] : b[j++];
+
+        // Overlapping or touching runs merge, the output stays a list of maximal runs
+        if (n > 0 && r.x0 <= out[n - 1].x1)
+        {
+            out[n - 1].x1 = (r.x1 > out[n - 1].x1) ? r.x1 : out[n - 1].x1;
+        }
+        else
+        {
+            out[n++] = r;
+        }
+    }
+    return n;
+}
+
+static unsigned long runs_intersect(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out)
+{
+    unsigned long i = 0, j = 0, n = 0;
+    while (i < na && j < nb)
+    {
+        const uint32_t x0 = (a[i].x0 > b[j].x0) ? a[i].x0 : b[j].x0;
+        const uint32_t x1 = (a[i].x1 < b[j].x1) ? a[i].x1 : b[j].x1;
+        if (x0 < x1)
+        {
+            out[n++] = (rle_run_t){.x0 = x0, .x1 = x1};
+        }
+
+        // Drop the run that ends first, the other one may still overlap the next
+        if (a[i].x1 < b[j].x1)
+        {
+            i++;
+        }
+        else
+        {
+            j++;
+        }
+    }
+    return n;
+}
+
+static unsigned long runs_subtract(const rle_run_t *a, const unsigned long na, const rle_run_t *b, const unsigned long nb, rle_run_t *out)
+{
+    unsigned long j = 0, n = 0;
+    for (unsigned long i = 0; i < na; i++)
+    {
+        uint32_t x = a[i].x0;
+        while (j < nb && b[j].x1 <= x)
+        {
+            j++;
+        }
+
+        // b[j] can reach into the next run of a, so it is not consumed here
+        for (unsigned long k = j; k < nb && b[k].x0 < a[i].x1; k++)
+        {
+            if (b[k].x0 > x)
+            {
+                out[n++] = (rle_run_t){.x0 = x, .x1 = b[k].x0};
+            }
+            x = (b[k].x1 > x) ? b[k].x1 : x;
+            if (x >= a[i].x1)
+            {
+                break;
+            }
+        }
+        if (x < a[i].x1)
+        {
+            out[n++] = (rle_run_t){.x0 = x, .x1 = a[i].x1};
+        }
+    }
+    return n;
+}
+
+static unsigned long bits_find(const uint64_t *row, const unsigned long words, const unsigned long x, const int set, const unsigned long w)
+{
+    if (x >= w)
+    {
+        return w;
+    }
+
+    unsigned long i = x / BITS_PER_WORD;
+    uint64_t word = (set ? row[i] : ~row[i]) & (~0ull << (x % BITS_PER_WORD));
+    while (word == 0)
+    {
+        if (++i >= words)
+        {
+            return w;
+        }
+        word = set ? row[i] : ~row[i];
+    }
+
+    // Bits past w are 0, so a search for 0s can end there
+    const unsigned long pos = i * BITS_PER_WORD + (unsigned long)__builtin_ctzll(word);
+    return (pos < w) ? pos : w;
+}
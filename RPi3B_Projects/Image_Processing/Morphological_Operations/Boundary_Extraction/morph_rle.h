@@ -0,0 +1,77 @@
+#ifndef MORPH_RLE_H
+#define MORPH_RLE_H
+
+/* ------ Notes Section
+Run-length encoded binary image: every row is a sorted list of foreground runs [x0, x1),
+so memory and time follow the number of edges instead of the number of pixels.
+All runs sit in one array, row y owns runs[row_start[y] .. row_start[y + 1]).
+
+Morphology straight on the runs, elements as in morph_gray.h (SE_RECT, SE_CROSS, SE_LINE at 0 / 90 degrees):
+- horizontal : dilation widens every run by the element and merges the ones that now touch,
+               erosion narrows them and drops the ones that vanish
+- vertical   : union (dilation) / intersection (erosion) of the rows in the window. Done as a sparse table,
+               level j holds the union / intersection of 2^j rows, and two overlapping entries of the top level
+               cover any window (both ops are idempotent), so O(runs * log2(k)) whatever k is
+Outside of the image counts as background for dilation and as foreground for erosion, same as morph_bitpacked.h,
+so every result matches gray_erode() / gray_dilate() on a 0 / 255 image.
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+
+#include "img_common.h"
+#include "morph_gray.h"
+#include "morph_bitpacked.h"
+
+// ---- Enums ----
+
+enum RLE_SETTINGS
+{
+    RLE_MIN_CAPACITY = 64 // runs, the array doubles from there
+};
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    uint32_t x0;
+    uint32_t x1; // exclusive
+} rle_run_t;
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    unsigned long n_runs;
+    unsigned long capacity;
+    rle_run_t *runs;
+    unsigned long *row_start; // h + 1 entries
+} rle_mask_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES rle_create(rle_mask_t *m, const unsigned long w, const unsigned long h); // empty mask
+void rle_destroy(rle_mask_t *m);
+
+// m must have been created with the size of the source
+RETURN_TYPES rle_from_u8(const uint8_t *img, rle_mask_t *m); // any non-zero pixel is foreground
+void rle_to_u8(const rle_mask_t *m, uint8_t *img);            // writes 0 / 1
+RETURN_TYPES rle_from_bitmask(const bitmask_t *mask, rle_mask_t *m);
+void rle_to_bitmask(const rle_mask_t *m, bitmask_t *mask);
+
+// src == dst is allowed, dst must have been created (it's resized as needed)
+RETURN_TYPES rle_erode(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se);
+RETURN_TYPES rle_dilate(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se);
+RETURN_TYPES rle_morph(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se, MORPH_OPS op);
+RETURN_TYPES rle_boundary(const rle_mask_t *src, rle_mask_t *dst, const strel_t *se, BOUNDARY_TYPES type);
+
+unsigned long rle_area(const rle_mask_t *m);
+unsigned long rle_bytes(const rle_mask_t *m); // runs + row index, for reports
+
+static inline const rle_run_t *rle_row(const rle_mask_t *m, const unsigned long y, unsigned long *n_runs)
+{
+    *n_runs = m->row_start[y + 1] - m->row_start[y];
+    return m->runs + m->row_start[y];
+}
+
+#endif
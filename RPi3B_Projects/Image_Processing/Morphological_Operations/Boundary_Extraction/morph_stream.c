@@ -0,0 +1,440 @@
+// ---- Libraries ----
+#include "morph_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES strel_line_lengths(const strel_t *se, unsigned long *k_h, unsigned long *k_v);
+static RETURN_TYPES stage_init(stream_stage_t *st, const unsigned long w, const strel_t *se, const MORPH_OPS op);
+static void stage_free(stream_stage_t *st);
+static void stage_start(stream_stage_t *st);
+static void stage_feed(stream_stage_t *st);
+static void stage_feed_padding(stream_stage_t *st);
+static void stage_row(stream_stage_t *st, const unsigned long y, uint8_t *row_out);
+static unsigned long stage_bytes(const stream_stage_t *st);
+static void rows_op(const MORPH_OPS op, const uint8_t *a, const uint8_t *b, uint8_t *dst, const unsigned long w);
+static inline uint8_t *stage_slot(const stream_stage_t *st, const unsigned long t);
+
+// ---- Function Implementations ----
+
+RETURN_TYPES stream_boundary_create(stream_boundary_t *s, const unsigned long w, const unsigned long h, const unsigned long channels, const strel_t *se)
+{
+    if (channels != CH_GRAY && channels != CH_RGB)
+    {
+        return ERR_ARGS;
+    }
+    return stream_boundary_create_fmt(s, w, h, (channels == CH_RGB) ? PIX_FMT_RGB24 : PIX_FMT_GRAY8, se);
+}
+
+RETURN_TYPES stream_boundary_create_fmt(stream_boundary_t *s, const unsigned long w, const unsigned long h, const PIX_FORMATS format, const strel_t *se)
+{
+    if (s == NULL || se == NULL || w == 0 || h == 0 || format < 0 || format >= PIX_FMT_COUNT)
+    {
+        return ERR_ARGS;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->w = w;
+    s->h = h;
+    s->format = format;
+    s->row_bytes = color_row_bytes(format, w);
+    s->se = *se;
+
+    RETURN_TYPES ret = stage_init(&s->erode, w, se, MORPH_ERODE);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    // Erosion reads A(y + b), b in [-k/2, k - 1 - k/2]
+    s->k_v = s->erode.k_v;
+    s->up = s->erode.up;
+    s->down = s->k_v - 1 - s->up;
+    return SUCCESS;
+}
+
+void stream_boundary_destroy(stream_boundary_t *s)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    stage_free(&s->erode);
+}
+
+int stream_boundary_push(stream_boundary_t *s, const uint8_t *row_in, uint8_t *row_out)
+{
+    if (s->rows_in >= s->h)
+    {
+        return ERR_ARGS;
+    }
+
+    // The `up` rows above the image are 255, fed once per frame
+    if (s->rows_in == 0)
+    {
+        stage_start(&s->erode);
+    }
+
+    // Stage 1: gray straight into the ring, no full-frame gray image
+    color_to_gray_u8(s->format, row_in, stage_slot(&s->erode, s->erode.t_fed), s->w, 1);
+    stage_feed(&s->erode);
+    s->rows_in++;
+
+    // Output row y needs input rows up to y + down
+    if (s->rows_in > s->down)
+    {
+        const unsigned long y = s->rows_in - 1 - s->down;
+        stage_row(&s->erode, y, row_out);
+
+        // Stage 3: A - (A ⊖ B), never negative since the origin is part of B
+        const uint8_t *centre = stage_slot(&s->erode, y + s->up);
+        for (unsigned long x = 0; x < s->w; x++)
+        {
+            row_out[x] = (uint8_t)(centre[x] - row_out[x]);
+        }
+        s->rows_out++;
+        return 1;
+    }
+    return 0;
+}
+
+int stream_boundary_flush(stream_boundary_t *s, uint8_t *row_out)
+{
+    if (s->rows_in < s->h || s->rows_out >= s->h)
+    {
+        return 0;
+    }
+
+    // Rows below the image are 255: feed them up to the end of this row's window
+    while (s->erode.t_fed < s->rows_out + s->k_v)
+    {
+        stage_feed_padding(&s->erode);
+    }
+
+    const unsigned long y = s->rows_out;
+    stage_row(&s->erode, y, row_out);
+    const uint8_t *centre = stage_slot(&s->erode, y + s->up);
+    for (unsigned long x = 0; x < s->w; x++)
+    {
+        row_out[x] = (uint8_t)(centre[x] - row_out[x]);
+    }
+    s->rows_out++;
+    return 1;
+}
+
+RETURN_TYPES stream_boundary_frame(stream_boundary_t *s, const uint8_t *frame_in, uint8_t *frame_out)
+{
+    const unsigned long stride_in = s->row_bytes; // NV12: the Y plane comes first, the rows end there
+
+    s->rows_in = s->rows_out = 0;
+    for (unsigned long y = 0; y < s->h; y++)
+    {
+        int ret = stream_boundary_push(s, frame_in + y * stride_in, frame_out + s->rows_out * s->w);
+        if (ret < 0)
+        {
+            return (RETURN_TYPES)ret;
+        }
+    }
+    while (stream_boundary_flush(s, frame_out + s->rows_out * s->w) == 1)
+    {
+    }
+    return SUCCESS;
+}
+
+unsigned long stream_boundary_bytes(const stream_boundary_t *s)
+{
+    return stage_bytes(&s->erode);
+}
+
+RETURN_TYPES stream_openclose_create(stream_openclose_t *s, const unsigned long w, const unsigned long h, const strel_t *se, const MORPH_OPS first)
+{
+    if (s == NULL || se == NULL || w == 0 || h == 0 || (first != MORPH_ERODE && first != MORPH_DILATE))
+    {
+        return ERR_ARGS;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->w = w;
+    s->h = h;
+
+    RETURN_TYPES ret = stage_init(&s->first, w, se, first);
+    if (ret == SUCCESS)
+    {
+        ret = stage_init(&s->second, w, se, (first == MORPH_ERODE) ? MORPH_DILATE : MORPH_ERODE);
+    }
+    if (ret != SUCCESS)
+    {
+        stream_openclose_destroy(s);
+        return ret;
+    }
+    s->k_v = s->first.k_v;
+    return SUCCESS;
+}
+
+void stream_openclose_destroy(stream_openclose_t *s)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    stage_free(&s->first);
+    stage_free(&s->second);
+}
+
+int stream_openclose_push(stream_openclose_t *s, const uint8_t *row_in, uint8_t *row_out)
+{
+    if (s->rows_in >= s->h)
+    {
+        return ERR_ARGS;
+    }
+
+    if (s->rows_in == 0)
+    {
+        stage_start(&s->first);
+        stage_start(&s->second);
+        s->rows_mid = s->rows_out = 0;
+    }
+
+    memcpy(stage_slot(&s->first, s->first.t_fed), row_in, s->w);
+    stage_feed(&s->first);
+    s->rows_in++;
+
+    // One row in moves at most one row through each stage. The first stage writes into the second's ring.
+    if (s->first.t_fed == s->rows_mid + s->k_v)
+    {
+        stage_row(&s->first, s->rows_mid, stage_slot(&s->second, s->second.t_fed));
+        stage_feed(&s->second);
+        s->rows_mid++;
+    }
+    if (s->second.t_fed == s->rows_out + s->k_v)
+    {
+        stage_row(&s->second, s->rows_out, row_out);
+        s->rows_out++;
+        return 1;
+    }
+    return 0;
+}
+
+int stream_openclose_flush(stream_openclose_t *s, uint8_t *row_out)
+{
+    if (s->rows_in < s->h || s->rows_out >= s->h)
+    {
+        return 0;
+    }
+
+    // Below the image: 255 / 0 padding into whichever stage is short of rows for the next output row
+    while (s->second.t_fed < s->rows_out + s->k_v)
+    {
+        if (s->rows_mid < s->h)
+        {
+            while (s->first.t_fed < s->rows_mid + s->k_v)
+            {
+                stage_feed_padding(&s->first);
+            }
+            stage_row(&s->first, s->rows_mid, stage_slot(&s->second, s->second.t_fed));
+            stage_feed(&s->second);
+            s->rows_mid++;
+        }
+        else
+        {
+            stage_feed_padding(&s->second);
+        }
+    }
+
+    stage_row(&s->second, s->rows_out, row_out);
+    s->rows_out++;
+    return 1;
+}
+
+bool stream_strel_supported(const strel_t *se)
+{
+    unsigned long k_h, k_v;
+    return se != NULL && strel_line_lengths(se, &k_h, &k_v) == SUCCESS;
+}
+
+static RETURN_TYPES strel_line_lengths(const strel_t *se, unsigned long *k_h, unsigned long *k_v)
+{
+    if (se->width == 0)
+    {
+        return ERR_ARGS;
+    }
+
+    switch (se->shape)
+    {
+    case SE_RECT:
+        *k_h = se->width;
+        *k_v = se->height;
+        break;
+
+    case SE_CROSS:
+        *k_h = *k_v = 2 * se->width + 1;
+        break;
+
+    case SE_LINE:
+        if (se->angle == LINE_0)
+        {
+            *k_h = se->width;
+            *k_v = 1;
+        }
+        else if (se->angle == LINE_90)
+        {
+            *k_h = 1;
+            *k_v = se->width;
+        }
+        else
+        {
+            return ERR_ARGS;
+        }
+        break;
+
+    default:
+        return ERR_ARGS;
+    }
+
+    return (*k_h == 0 || *k_v == 0) ? ERR_ARGS : SUCCESS;
+}
+
+static RETURN_TYPES stage_init(stream_stage_t *st, const unsigned long w, const strel_t *se, const MORPH_OPS op)
+{
+    memset(st, 0, sizeof(*st));
+    if (strel_line_lengths(se, &st->k_h, &st->k_v) != SUCCESS)
+    {
+        return ERR_ARGS;
+    }
+
+    st->w = w;
+    st->cross = (se->shape == SE_CROSS);
+    st->op = op;
+    st->up = (unsigned long)(-gray_window_offset(st->k_v, op));
+
+    st->ring = malloc(st->k_v * w);
+    st->suffix = malloc(st->k_v * w);
+    st->prefix = malloc(w);
+    st->vline = malloc(w);
+    st->hline = malloc(w);
+    st->scratch = malloc(gray_line_scratch_size(w, st->k_h));
+    if (st->ring == NULL || st->suffix == NULL || st->prefix == NULL || st->vline == NULL || st->hline == NULL || st->scratch == NULL)
+    {
+        stage_free(st);
+        return ERR_ALLOC;
+    }
+    return SUCCESS;
+}
+
+static void stage_free(stream_stage_t *st)
+{
+    free(st->ring);
+    free(st->suffix);
+    free(st->prefix);
+    free(st->vline);
+    free(st->hline);
+    free(st->scratch);
+    st->ring = st->suffix = st->prefix = st->vline = st->hline = st->scratch = NULL;
+}
+
+static void stage_start(stream_stage_t *st)
+{
+    st->t_fed = 0;
+    while (st->t_fed < st->up)
+    {
+        stage_feed_padding(st);
+    }
+}
+
+static void stage_feed(stream_stage_t *st)
+{
+    // Once per row (its slot is filled already): van Herk / Gil-Werman in blocks of k_v virtual rows.
+    // prefix = min / max from the start of the current block up to this row, suffix = from a row to the end of
+    // the last complete block, computed once when that block is complete. 3 compares per pixel, whatever k_v is.
+    const unsigned long w = st->w;
+    const unsigned long k = st->k_v;
+    const unsigned long t = st->t_fed;
+    const uint8_t *r = stage_slot(st, t);
+
+    if (t % k == 0)
+    {
+        memcpy(st->prefix, r, w);
+    }
+    else
+    {
+        rows_op(st->op, st->prefix, r, st->prefix, w);
+    }
+
+    if (t % k == k - 1)
+    {
+        // Block complete, and the ring holds exactly its k rows: suffix from its end backwards
+        memcpy(st->suffix + (k - 1) * w, r, w);
+        for (unsigned long i = k - 1; i-- > 0;)
+        {
+            rows_op(st->op, stage_slot(st, t - (k - 1) + i), st->suffix + (i + 1) * w, st->suffix + i * w, w);
+        }
+    }
+    st->t_fed++;
+}
+
+static void stage_feed_padding(stream_stage_t *st)
+{
+    memset(stage_slot(st, st->t_fed), (st->op == MORPH_ERODE) ? PAD_ERODE : PAD_DILATE, st->w);
+    stage_feed(st);
+}
+
+static void stage_row(stream_stage_t *st, const unsigned long y, uint8_t *row_out)
+{
+    const unsigned long w = st->w;
+    const unsigned long k = st->k_v;
+
+    // The window of row y is virtual rows [y, y + k - 1], the last one fed so far.
+    // Starts on a block: the prefix alone. Otherwise suffix of the block it starts in + prefix of the one it ends in.
+    if (y % k == 0)
+    {
+        memcpy(st->vline, st->prefix, w);
+    }
+    else
+    {
+        rows_op(st->op, st->suffix + (y % k) * w, st->prefix, st->vline, w);
+    }
+
+    // Horizontal part. Rect -> separable on the vertical result, cross -> union with the centre row line.
+    if (st->cross)
+    {
+        gray_line_1d(stage_slot(st, y + st->up), st->hline, w, st->k_h, st->op, st->scratch);
+        rows_op(st->op, st->hline, st->vline, row_out, w);
+    }
+    else
+    {
+        gray_line_1d(st->vline, row_out, w, st->k_h, st->op, st->scratch);
+    }
+}
+
+static unsigned long stage_bytes(const stream_stage_t *st)
+{
+    return 2 * st->k_v * st->w + 3 * st->w + gray_line_scratch_size(st->w, st->k_h);
+}
+
+static void rows_op(const MORPH_OPS op, const uint8_t *a, const uint8_t *b, uint8_t *dst, const unsigned long w)
+{
+    // op picked once per row, so both loops stay plain min / max the compiler can vectorize
+    if (op == MORPH_ERODE)
+    {
+        for (unsigned long x = 0; x < w; x++)
+        {
+            dst[x] = (a[x] < b[x]) ? a[x] : b[x];
+        }
+    }
+    else
+    {
+        for (unsigned long x = 0; x < w; x++)
+        {
+            dst[x] = (a[x] > b[x]) ? a[x] : b[x];
+        }
+    }
+}
+
+static inline uint8_t *stage_slot(const stream_stage_t *st, const unsigned long t)
+{
+    // t is a virtual row: image row y is t = y + up, the `up` padding rows above the image are t = 0 .. up - 1
+    return st->ring + (t % st->k_v) * st->w;
+}
@@ -0,0 +1,111 @@
+#ifndef MORPH_STREAM_H
+#define MORPH_STREAM_H
+
+/* ------ Notes Section
+Streaming boundary extraction, Option B: A - (A ⊖ B), fed one input row at a time.
+gray conversion, erosion and the subtraction are fused per row and only a ring of k_v gray rows is kept
+(k_v = height of the structuring element), so memory is O(w * k_v) instead of O(w * h)
+and each row is still in L1/L2 when all three stages touch it.
+
+The vertical min is van Herk / Gil-Werman over the stream: a running prefix min of the current block of k_v rows
+and the suffix mins of the last complete block (computed once, when it completes). Each output row is
+min(suffix, prefix), so the cost per pixel doesn't grow with k_v, same as the horizontal pass.
+
+Output row y is ready once input row y + down is pushed, the last `down` rows come out of flush().
+Supported elements: SE_RECT, SE_CROSS and SE_LINE at 0 or 90 degrees.
+
+Input rows can be any img_color.h format, each takes its cheapest way to gray
+(NV12 rows are the rows of the Y plane, the chroma plane is never read).
+
+Opening / closing use the same stage twice: every row that leaves the first stage (erosion for opening,
+dilation for closing) is written straight into the ring of the second one, so the intermediate image only
+ever exists as the k_v rows of that ring. Gray rows in, one output row per pushed row once the pipeline is
+full (input row y + down_1 + down_2 completes output row y).
+*/
+
+// ---- Libraries ----
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "img_common.h"
+#include "morph_gray.h"
+#include "img_color.h"
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long k_h; // horizontal line length, 1 if none
+    unsigned long k_v; // vertical line length == ring size in rows
+    unsigned long up;  // rows above the output row the window reaches, the rest are below
+    bool cross;        // union of the two lines instead of one after the other
+    MORPH_OPS op;
+
+    uint8_t *ring;    // k_v rows, virtual row t sits in slot t % k_v
+    uint8_t *suffix;  // k_v rows, suffix min / max of the last complete block
+    uint8_t *prefix;  // prefix min / max of the current block
+    uint8_t *vline;   // vertical result of the output row's window
+    uint8_t *hline;   // horizontal line of the centre row (cross only)
+    uint8_t *scratch; // vHGW buffers
+
+    unsigned long t_fed; // virtual rows (padding included) through the vertical pass, image row y is t = y + up
+} stream_stage_t; // one separable erosion / dilation over a row stream
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    PIX_FORMATS format;     // of the pushed rows
+    unsigned long row_bytes; // one pushed row
+    strel_t se;
+
+    unsigned long k_v;  // == ring size in rows
+    unsigned long up;   // rows above the output row the element reaches
+    unsigned long down; // rows below
+
+    stream_stage_t erode;
+
+    unsigned long rows_in;
+    unsigned long rows_out;
+} stream_boundary_t;
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    unsigned long k_v;
+
+    stream_stage_t first;  // reads the pushed rows
+    stream_stage_t second; // the reverse operation, its ring is fed by first
+
+    unsigned long rows_in;
+    unsigned long rows_mid; // rows out of first, into second
+    unsigned long rows_out;
+} stream_openclose_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES stream_boundary_create(stream_boundary_t *s, const unsigned long w, const unsigned long h, const unsigned long channels, const strel_t *se); // CH_GRAY / CH_RGB
+RETURN_TYPES stream_boundary_create_fmt(stream_boundary_t *s, const unsigned long w, const unsigned long h, const PIX_FORMATS format, const strel_t *se);
+void stream_boundary_destroy(stream_boundary_t *s);
+
+// Return 1 when row_out got the next output row, 0 when nothing is ready yet, < 0 on error
+int stream_boundary_push(stream_boundary_t *s, const uint8_t *row_in, uint8_t *row_out);
+int stream_boundary_flush(stream_boundary_t *s, uint8_t *row_out);
+
+// Whole frame through the same row pipeline, frame_in is color_frame_bytes() bytes, frame_out is w * h
+RETURN_TYPES stream_boundary_frame(stream_boundary_t *s, const uint8_t *frame_in, uint8_t *frame_out);
+
+unsigned long stream_boundary_bytes(const stream_boundary_t *s); // working memory, for reports
+
+// first == MORPH_ERODE -> opening, MORPH_DILATE -> closing. Gray rows, same push / flush contract as above.
+RETURN_TYPES stream_openclose_create(stream_openclose_t *s, const unsigned long w, const unsigned long h, const strel_t *se, const MORPH_OPS first);
+void stream_openclose_destroy(stream_openclose_t *s);
+int stream_openclose_push(stream_openclose_t *s, const uint8_t *row_in, uint8_t *row_out);
+int stream_openclose_flush(stream_openclose_t *s, uint8_t *row_out);
+
+// The elements the row stages can run (SE_RECT, SE_CROSS, SE_LINE at 0 / 90 degrees)
+bool stream_strel_supported(const strel_t *se);
+
+#endif
@@ -0,0 +1,141 @@
+// ---- Libraries ----
+#include "pipeline.h"
+
+#include <fcntl.h>    // open()
+#include <unistd.h>   // write(), close()
+#include <sys/stat.h> // stat(), permission macros
+#include <stdlib.h>
+#include <errno.h>
+
+#include "morph_stream.h"
+
+// ---- Enums and Defines ----
+
+#define FILE_MODES_WRITE (O_WRONLY | O_CREAT | O_TRUNC)
+#define FILE_PERMISSIONS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH)
+
+// ---- Function Prototypes ----
+
+static RETURN_TYPES write_all(const int fd, const uint8_t *buf, size_t len);
+
+// ---- Function Implementations ----
+
+RETURN_TYPES pipeline_boundary_file(const char *in_path, const char *out_path, const img_raw_desc_t *raw, const strel_t *se)
+{
+    img_mapped_t in, out;
+
+    // The output is truncated while the input is still mapped, the same file on both sides ends in SIGBUS
+    struct stat st_in, st_out;
+    if (stat(in_path, &st_in) == 0 && stat(out_path, &st_out) == 0 && st_in.st_dev == st_out.st_dev && st_in.st_ino == st_out.st_ino)
+    {
+        return ERR_ARGS;
+    }
+
+    RETURN_TYPES ret = (raw != NULL) ? img_map_read_packed(in_path, raw->w, raw->h, color_frame_bytes(raw->format, raw->w, raw->h), &in) : img_map_read(in_path, &in);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    ret = img_map_write(out_path, in.w, in.h, CH_GRAY, img_format_from_path(out_path), &out);
+    if (ret != SUCCESS)
+    {
+        img_unmap(&in);
+        return ret;
+    }
+
+    stream_boundary_t stream;
+    const PIX_FORMATS format = (raw != NULL) ? raw->format : ((in.channels == CH_RGB) ? PIX_FMT_RGB24 : PIX_FMT_GRAY8);
+    ret = stream_boundary_create_fmt(&stream, in.w, in.h, format, se);
+    if (ret == SUCCESS)
+    {
+        ret = stream_boundary_frame(&stream, in.pixels, out.pixels);
+        stream_boundary_destroy(&stream);
+    }
+
+    RETURN_TYPES ret_out = img_unmap(&out);
+    img_unmap(&in);
+    return (ret != SUCCESS) ? ret : ret_out;
+}
+
+RETURN_TYPES pipeline_boundary_source(frame_source_t *src, const strel_t *se, const char *out_path, frame_latency_t *lat)
+{
+    if (src == NULL || se == NULL || lat == NULL)
+    {
+        return ERR_ARGS;
+    }
+
+    const size_t frame_out = src->w * src->h;
+    stream_boundary_t stream;
+    RETURN_TYPES ret = stream_boundary_create_fmt(&stream, src->w, src->h, src->format, se);
+    if (ret != SUCCESS)
+    {
+        return ret;
+    }
+
+    uint8_t *out = malloc(frame_out);
+    int fd = -1;
+    if (out == NULL)
+    {
+        stream_boundary_destroy(&stream);
+        return ERR_ALLOC;
+    }
+    if (out_path != NULL && (fd = open(out_path, FILE_MODES_WRITE, FILE_PERMISSIONS)) == -1)
+    {
+        free(out);
+        stream_boundary_destroy(&stream);
+        return ERR_FILE_OPEN;
+    }
+
+    frame_latency_reset(lat);
+    ret = frame_source_start(src);
+
+    frame_buf_t *buf = NULL;
+    while (ret == SUCCESS && (ret = frame_source_dequeue(src, &buf)) == SUCCESS)
+    {
+        // gray -> erosion -> subtraction straight from the capture buffer, then it goes back to the source
+        ret = stream_boundary_frame(&stream, buf->data, out);
+        const double t_capture = buf->t_capture;
+        frame_source_enqueue(src, buf);
+
+        if (ret == SUCCESS && fd != -1)
+        {
+            ret = write_all(fd, out, frame_out);
+        }
+        if (ret == SUCCESS)
+        {
+            frame_latency_add(lat, (img_now_sec() - t_capture) * 1e3);
+        }
+    }
+    if (ret == ERR_END_OF_STREAM)
+    {
+        ret = SUCCESS;
+    }
+
+    if (fd != -1 && close(fd) == -1 && ret == SUCCESS)
+    {
+        ret = ERR_GENERAL;
+    }
+    free(out);
+    stream_boundary_destroy(&stream);
+    return ret;
+}
+
+static RETURN_TYPES write_all(const int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0)
+    {
+        const ssize_t n = write(fd, buf, len);
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return ERR_GENERAL;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return SUCCESS;
+}
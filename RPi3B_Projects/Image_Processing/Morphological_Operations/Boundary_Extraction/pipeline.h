@@ -0,0 +1,39 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/* ------ Notes Section
+File in -> boundary image out, everything zero-copy:
+the rows of the mmap'd input go straight into the streaming stage,
+the output rows are written straight into the mmap'd output file.
+
+Frame sources: the streaming stage reads the capture buffer in place and hands it back right after,
+the output frame is appended to a raw file.
+Either way the input format picks the gray conversion (img_color.h), NV12 / gray need none. Latency = capture complete -> output written, per frame.
+*/
+
+// ---- Libraries ----
+#include "img_common.h"
+#include "img_io.h"
+#include "morph_gray.h"
+#include "frame_source.h"
+#include "img_color.h"
+
+// ---- Typedefs ----
+
+typedef struct
+{
+    unsigned long w;
+    unsigned long h;
+    PIX_FORMATS format;
+} img_raw_desc_t; // size of headerless raw frames, they carry no header to read it from
+
+// ---- Function Prototypes ----
+
+// raw == NULL -> input must be PGM / PPM. The output format follows the output file extension.
+// ERR_ARGS when in_path and out_path are the same file.
+RETURN_TYPES pipeline_boundary_file(const char *in_path, const char *out_path, const img_raw_desc_t *raw, const strel_t *se);
+
+// Until the source runs dry. out_path == NULL -> frames are processed but not stored.
+RETURN_TYPES pipeline_boundary_source(frame_source_t *src, const strel_t *se, const char *out_path, frame_latency_t *lat);
+
+#endif
@@ -0,0 +1,163 @@
+// ---- Libraries ----
+#include "thread_pool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+// ---- Function Prototypes ----
+
+static void *pool_worker(void *arg);
+static void pool_drain(thread_pool_t *pool);
+
+// ---- Function Implementations ----
+
+unsigned long pool_online_cores(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (unsigned long)n : 1;
+}
+
+RETURN_TYPES pool_create(thread_pool_t *pool, unsigned long n_threads)
+{
+    if (pool == NULL)
+    {
+        return ERR_ARGS;
+    }
+    if (n_threads == 0)
+    {
+        n_threads = pool_online_cores();
+    }
+
+    pool->n_threads = n_threads;
+    pool->fn = NULL;
+    pool->arg = NULL;
+    pool->n_tasks = pool->next_task = pool->tasks_done = 0;
+    pool->generation = 0;
+    pool->stop = false;
+
+    pool->threads = calloc(n_threads, sizeof(pthread_t)); // slot 0 is the caller, never started
+    if (pool->threads == NULL)
+    {
+        return ERR_ALLOC;
+    }
+
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0 || pthread_cond_init(&pool->cond_work, NULL) != 0 || pthread_cond_init(&pool->cond_done, NULL) != 0)
+    {
+        free(pool->threads);
+        return ERR_GENERAL;
+    }
+
+    for (unsigned long i = 1; i < n_threads; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0)
+        {
+            pool->n_threads = i; // only join the ones that were started
+            pool_destroy(pool);
+            return ERR_GENERAL;
+        }
+    }
+    return SUCCESS;
+}
+
+void pool_run(thread_pool_t *pool, pool_task_fn fn, void *arg, const unsigned long n_tasks)
+{
+    if (n_tasks == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->n_tasks = n_tasks;
+    pool->next_task = 0;
+    pool->tasks_done = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->cond_work);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pool_drain(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->tasks_done < pool->n_tasks)
+    {
+        pthread_cond_wait(&pool->cond_done, &pool->mutex);
+    }
+    pool->fn = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void pool_destroy(thread_pool_t *pool)
+{
+    if (pool == NULL || pool->threads == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->cond_work);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (unsigned long i = 1; i < pool->n_threads; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond_work);
+    pthread_cond_destroy(&pool->cond_done);
+    free(pool->threads);
+    pool->threads = NULL;
+}
+
+static void *pool_worker(void *arg)
+{
+    thread_pool_t *pool = arg;
+    unsigned long seen_generation = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->stop && pool->generation == seen_generation)
+        {
+            pthread_cond_wait(&pool->cond_work, &pool->mutex);
+        }
+        if (pool->stop)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        pool_drain(pool);
+    }
+    return NULL;
+}
+
+static void pool_drain(thread_pool_t *pool)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        if (pool->fn == NULL || pool->next_task >= pool->n_tasks)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            return;
+        }
+        const unsigned long index = pool->next_task++;
+        pool_task_fn fn = pool->fn;
+        void *arg = pool->arg;
+        pthread_mutex_unlock(&pool->mutex);
+
+        fn(arg, index);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (++pool->tasks_done == pool->n_tasks)
+        {
+            pthread_cond_signal(&pool->cond_done);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
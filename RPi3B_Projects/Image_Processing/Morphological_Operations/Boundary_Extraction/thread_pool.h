@@ -0,0 +1,45 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/* ------ Notes Section
+Persistent worker pool, threads are created once and sleep on a condition variable between jobs.
+pool_run() hands out task indexes 0..n_tasks-1 and returns when all of them are done,
+the calling thread works on the tasks too instead of just waiting.
+*/
+
+// ---- Libraries ----
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "img_common.h"
+
+// ---- Typedefs ----
+
+typedef void (*pool_task_fn)(void *arg, unsigned long index);
+
+typedef struct
+{
+    pthread_t *threads;
+    unsigned long n_threads; // workers + the caller of pool_run()
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_work;
+    pthread_cond_t cond_done;
+
+    pool_task_fn fn;
+    void *arg;
+    unsigned long n_tasks;
+    unsigned long next_task;
+    unsigned long tasks_done;
+    unsigned long generation; // bumped on every pool_run() so sleeping workers notice new work
+    bool stop;
+} thread_pool_t;
+
+// ---- Function Prototypes ----
+
+RETURN_TYPES pool_create(thread_pool_t *pool, unsigned long n_threads); // 0 -> number of online cores
+void pool_run(thread_pool_t *pool, pool_task_fn fn, void *arg, const unsigned long n_tasks);
+void pool_destroy(thread_pool_t *pool);
+unsigned long pool_online_cores(void);
+
+#endif